@@ -0,0 +1,478 @@
+#include "ast.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  uint32_t node;
+  uint32_t token;
+} astValue;
+
+typedef struct {
+  astTree *AST;
+  const parseTree *PT;
+  astValue *values;
+  uint32_t valueCount;
+  uint32_t valueCapacity;
+} astBuilder;
+
+static const astValue noValue = {AST_NONE, PT_NONE};
+
+const char *getAstKindName(astKind kind) {
+  switch (kind) {
+  case AST_PROGRAM:
+    return "PROGRAM";
+  case AST_FUNCTION:
+    return "FUNCTION";
+  case AST_MAIN:
+    return "MAIN";
+  case AST_PARAMS:
+    return "PARAMS";
+  case AST_PARAM:
+    return "PARAM";
+  case AST_TYPE:
+    return "TYPE";
+  case AST_BODY:
+    return "BODY";
+  case AST_RECORD_TYPE:
+    return "RECORD_TYPE";
+  case AST_UNION_TYPE:
+    return "UNION_TYPE";
+  case AST_FIELD:
+    return "FIELD";
+  case AST_DEFINETYPE:
+    return "DEFINETYPE";
+  case AST_DECL:
+    return "DECL";
+  case AST_ASSIGN:
+    return "ASSIGN";
+  case AST_CALL:
+    return "CALL";
+  case AST_WHILE:
+    return "WHILE";
+  case AST_IF:
+    return "IF";
+  case AST_BLOCK:
+    return "BLOCK";
+  case AST_READ:
+    return "READ";
+  case AST_WRITE:
+    return "WRITE";
+  case AST_RETURN:
+    return "RETURN";
+  case AST_IDLIST:
+    return "IDLIST";
+  case AST_BINOP:
+    return "BINOP";
+  case AST_LOGICOP:
+    return "LOGICOP";
+  case AST_RELOP:
+    return "RELOP";
+  case AST_NOT:
+    return "NOT";
+  case AST_FIELD_ACCESS:
+    return "FIELD_ACCESS";
+  case AST_ID:
+    return "ID";
+  case AST_FIELDID:
+    return "FIELDID";
+  case AST_RUID:
+    return "RUID";
+  case AST_NUM:
+    return "NUM";
+  case AST_RNUM:
+    return "RNUM";
+  case AST_LIST:
+    return "LIST";
+  default:
+    return "UNKNOWN";
+  }
+}
+
+static uint32_t newNode(astBuilder *b, astKind kind, int op, uint32_t token,
+                        uint32_t children) {
+  astTree *AST = b->AST;
+  if (AST->nodeCount == AST->nodeCapacity) {
+    uint32_t cap = AST->nodeCapacity ? AST->nodeCapacity * 2 : 256;
+    astNode *p = (astNode *)realloc(AST->nodes, (size_t)cap * sizeof(astNode));
+    if (!p) {
+      fprintf(stderr, "realloc failed for AST nodes\n");
+      exit(1);
+    }
+    AST->nodes = p;
+    AST->nodeCapacity = cap;
+  }
+  uint32_t idx = AST->nodeCount++;
+  astNode *n = &AST->nodes[idx];
+  n->kind = (uint8_t)kind;
+  n->op = (uint8_t)op;
+  n->childCount = 0;
+  n->firstChild = children;
+  n->nextSibling = AST_NONE;
+  n->token = token;
+  for (uint32_t c = children; c != AST_NONE; c = AST->nodes[c].nextSibling)
+    n->childCount++;
+  return idx;
+}
+
+static uint32_t leaf(astBuilder *b, astKind kind, astValue v) {
+  if (v.token == PT_NONE)
+    return AST_NONE;
+  return newNode(b, kind, 0, v.token, AST_NONE);
+}
+
+static int tokType(astBuilder *b, astValue v) {
+  return v.token == PT_NONE ? 0 : (int)b->PT->tokens[v.token].tokenType;
+}
+
+static uint32_t concat(astBuilder *b, uint32_t head, uint32_t rest) {
+  if (head == AST_NONE)
+    return rest;
+  uint32_t tail = head;
+  while (b->AST->nodes[tail].nextSibling != AST_NONE)
+    tail = b->AST->nodes[tail].nextSibling;
+  b->AST->nodes[tail].nextSibling = rest;
+  return head;
+}
+
+static uint32_t foldTail(astBuilder *b, uint32_t left, uint32_t tail) {
+  astNode *N = b->AST->nodes;
+  while (tail != AST_NONE) {
+    uint32_t next = N[tail].nextSibling;
+    uint32_t right = N[tail].firstChild;
+    if (left != AST_NONE) {
+      N[left].nextSibling = right;
+      N[tail].firstChild = left;
+    }
+    N[tail].childCount = (uint16_t)((left != AST_NONE) + (right != AST_NONE));
+    N[tail].nextSibling = AST_NONE;
+    left = tail;
+    tail = next;
+  }
+  return left;
+}
+
+static uint32_t typeNode(astBuilder *b, astValue kw, astValue ruid) {
+  uint32_t token = ruid.token != PT_NONE ? ruid.token : kw.token;
+  if (token == PT_NONE)
+    return AST_NONE;
+  return newNode(b, AST_TYPE, tokType(b, kw), token, AST_NONE);
+}
+
+static astValue node(uint32_t n) {
+  astValue v = {n, PT_NONE};
+  return v;
+}
+
+static astValue reduceRule(astBuilder *b, const GrammarRule *rule,
+                           astValue *v, int n) {
+  TokenType first = rule->rhs[0].type == SYMBOL_TERMINAL
+                        ? rule->rhs[0].symbol.terminal
+                        : TK_EPSILON;
+
+  switch (rule->lhs) {
+  case NT_PROGRAM:
+    return node(newNode(b, AST_PROGRAM, 0, PT_NONE,
+                        concat(b, v[0].node, v[1].node)));
+  case NT_MAINFUNCTION:
+    return node(newNode(b, AST_MAIN, 0, v[0].token, v[1].node));
+  case NT_FUNCTION: {
+    uint32_t kids = concat(b, v[1].node, concat(b, v[2].node, v[4].node));
+    return node(newNode(b, AST_FUNCTION, 0, v[0].token, kids));
+  }
+  case NT_INPUT_PAR:
+    return node(newNode(b, AST_PARAMS, TK_INPUT, v[0].token, v[4].node));
+  case NT_OUTPUT_PAR:
+    if (n == 0)
+      return node(newNode(b, AST_PARAMS, TK_OUTPUT, PT_NONE, AST_NONE));
+    return node(newNode(b, AST_PARAMS, TK_OUTPUT, v[0].token, v[4].node));
+  case NT_PARAMETER_LIST: {
+    uint32_t p = newNode(b, AST_PARAM, 0, v[1].token, v[0].node);
+    return node(concat(b, p, v[2].node));
+  }
+  case NT_PRIMITIVEDATATYPE:
+  case NT_CONSTRUCTEDDATATYPE:
+    if (n == 1)
+      return node(typeNode(b, v[0], noValue));
+    return node(typeNode(b, v[0], v[1]));
+  case NT_FIELDTYPE:
+    if (first == TK_RUID)
+      return node(typeNode(b, v[0], noValue));
+    return v[0];
+  case NT_STMTS: {
+    uint32_t kids = concat(
+        b, v[0].node,
+        concat(b, v[1].node, concat(b, v[2].node, v[3].node)));
+    return node(newNode(b, AST_BODY, 0, PT_NONE, kids));
+  }
+  case NT_TYPEDEFINITION: {
+    astKind kind = first == TK_UNION ? AST_UNION_TYPE : AST_RECORD_TYPE;
+    return node(newNode(b, kind, 0, v[1].token, v[2].node));
+  }
+  case NT_FIELDDEFINITIONS:
+    return node(concat(b, v[0].node, concat(b, v[1].node, v[2].node)));
+  case NT_FIELDDEFINITION:
+    return node(newNode(b, AST_FIELD, 0, v[3].token, v[1].node));
+  case NT_DECLARATION: {
+    int global = tokType(b, v[4]) == TK_GLOBAL ? TK_GLOBAL : 0;
+    return node(newNode(b, AST_DECL, global, v[3].token, v[1].node));
+  }
+  case NT_GLOBAL_OR_NOT:
+    return n == 0 ? noValue : v[1];
+  case NT_ASSIGNMENTSTMT:
+    return node(newNode(b, AST_ASSIGN, 0, v[1].token,
+                        concat(b, v[0].node, v[2].node)));
+  case NT_SINGLEORRECID:
+    if (v[1].node == AST_NONE)
+      return node(leaf(b, AST_ID, v[0]));
+    return node(newNode(b, AST_FIELD_ACCESS, 0, v[0].token, v[1].node));
+  case NT_ONEEXPANSION:
+    return node(leaf(b, AST_FIELDID, v[1]));
+  case NT_FUNCALLSTMT:
+    return node(newNode(b, AST_CALL, 0, v[2].token,
+                        concat(b, v[0].node, v[5].node)));
+  case NT_OUTPUTPARAMETERS:
+    if (n == 0)
+      return node(newNode(b, AST_IDLIST, 0, PT_NONE, AST_NONE));
+    return node(newNode(b, AST_IDLIST, 0, v[0].token, v[1].node));
+  case NT_INPUTPARAMETERS:
+    return node(newNode(b, AST_IDLIST, 0, v[0].token, v[1].node));
+  case NT_ITERATIVESTMT: {
+    uint32_t body = newNode(b, AST_BLOCK, 0, PT_NONE,
+                            concat(b, v[4].node, v[5].node));
+    return node(newNode(b, AST_WHILE, 0, v[0].token,
+                        concat(b, v[2].node, body)));
+  }
+  case NT_CONDITIONALSTMT: {
+    uint32_t then = newNode(b, AST_BLOCK, 0, v[4].token,
+                            concat(b, v[5].node, v[6].node));
+    uint32_t kids = concat(b, v[2].node, concat(b, then, v[7].node));
+    return node(newNode(b, AST_IF, 0, v[0].token, kids));
+  }
+  case NT_ELSEPART:
+    if (first == TK_ENDIF)
+      return noValue;
+    return node(newNode(b, AST_BLOCK, 0, v[0].token,
+                        concat(b, v[1].node, v[2].node)));
+  case NT_IOSTMT:
+    return node(newNode(b, first == TK_READ ? AST_READ : AST_WRITE, 0,
+                        v[0].token, v[2].node));
+  case NT_ARITHMETICEXPRESSION:
+  case NT_TERM:
+    return node(foldTail(b, v[0].node, v[1].node));
+  case NT_EXPPRIME:
+  case NT_TERMPRIME: {
+    if (n == 0)
+      return noValue;
+    uint32_t op = newNode(b, AST_BINOP, tokType(b, v[0]), v[0].token,
+                          v[1].node);
+    b->AST->nodes[op].nextSibling = v[2].node;
+    return node(op);
+  }
+  case NT_FACTOR:
+    return n == 3 ? v[1] : v[0];
+  case NT_BOOLEANEXPRESSION:
+    if (first == TK_OP)
+      return node(newNode(b, AST_LOGICOP, tokType(b, v[3]), v[3].token,
+                          concat(b, v[1].node, v[5].node)));
+    if (first == TK_NOT)
+      return node(newNode(b, AST_NOT, 0, v[0].token, v[2].node));
+    return node(newNode(b, AST_RELOP, tokType(b, v[1]), v[1].token,
+                        concat(b, v[0].node, v[2].node)));
+  case NT_VAR:
+    if (first == TK_NUM)
+      return node(leaf(b, AST_NUM, v[0]));
+    if (first == TK_RNUM)
+      return node(leaf(b, AST_RNUM, v[0]));
+    return v[0];
+  case NT_RETURNSTMT:
+    return node(newNode(b, AST_RETURN, 0, v[0].token, v[1].node));
+  case NT_OPTIONALRETURN:
+    return n == 0 ? noValue : v[1];
+  case NT_IDLIST:
+    return node(concat(b, leaf(b, AST_ID, v[0]), v[1].node));
+  case NT_DEFINETYPESTMT:
+    return node(newNode(b, AST_DEFINETYPE, tokType(b, v[1]), v[2].token,
+                        leaf(b, AST_RUID, v[4])));
+
+  case NT_OTHERFUNCTIONS:
+  case NT_TYPEDEFINITIONS:
+  case NT_MOREFIELDS:
+  case NT_DECLARATIONS:
+  case NT_OTHERSTMTS:
+  case NT_OPTION_SINGLE_CONSTRUCTED:
+  case NT_MOREEXPANSIONS:
+    if (n == 0)
+      return noValue;
+    return node(concat(b, v[0].node, v[1].node));
+  case NT_REMAINING_LIST:
+  case NT_MORE_IDS:
+    return n == 0 ? noValue : v[1];
+  case NT_DATATYPE:
+  case NT_ACTUALORREDEFINED:
+  case NT_STMT:
+  case NT_HIGHPRECEDENCEOP:
+  case NT_LOWPRECEDENCEOP:
+  case NT_LOGICALOP:
+  case NT_RELATIONALOP:
+  case NT_A:
+    return n == 1 ? v[0] : noValue;
+  default: {
+    uint32_t kids = AST_NONE;
+    for (int i = n - 1; i >= 0; i--)
+      kids = concat(b, v[i].node, kids);
+    return node(newNode(b, AST_LIST, 0, PT_NONE, kids));
+  }
+  }
+}
+
+static void pushValue(astBuilder *b, astValue v) {
+  if (b->valueCount == b->valueCapacity) {
+    uint32_t cap = b->valueCapacity ? b->valueCapacity * 2 : 64;
+    astValue *p = (astValue *)realloc(b->values, (size_t)cap * sizeof(astValue));
+    if (!p) {
+      fprintf(stderr, "realloc failed for AST value stack\n");
+      exit(1);
+    }
+    b->values = p;
+    b->valueCapacity = cap;
+  }
+  b->values[b->valueCount++] = v;
+}
+
+static void onMatch(void *ctx, TokenType expected, const tokenInfo *tk) {
+  astBuilder *b = (astBuilder *)ctx;
+  astValue v = {AST_NONE, tk ? addParseToken(b->AST->source, tk) : PT_NONE};
+  (void)expected;
+  pushValue(b, v);
+}
+
+static void onExit(void *ctx, NonTerminal nt, const GrammarRule *rule) {
+  astBuilder *b = (astBuilder *)ctx;
+  (void)nt;
+  if (!rule) {
+    pushValue(b, noValue);
+    return;
+  }
+  int n = 0;
+  for (int i = 0; i < rule->rhsCount; i++)
+    if (!(rule->rhs[i].type == SYMBOL_TERMINAL &&
+          rule->rhs[i].symbol.terminal == TK_EPSILON))
+      n++;
+
+  astValue kids[MAX_RHS];
+  for (int i = 0; i < n; i++)
+    kids[i] = b->values[b->valueCount - n + i];
+  for (int i = n; i < MAX_RHS; i++)
+    kids[i] = noValue;
+  b->valueCount -= n;
+  pushValue(b, reduceRule(b, rule, kids, n));
+}
+
+astTree *buildAST(char *testcaseFile, table *T, grammar *G) {
+  astTree *AST = (astTree *)calloc(1, sizeof(astTree));
+  if (!AST) {
+    fprintf(stderr, "calloc failed for astTree\n");
+    exit(1);
+  }
+  AST->root = AST_NONE;
+  AST->source = (parseTree *)calloc(1, sizeof(parseTree));
+  if (!AST->source) {
+    fprintf(stderr, "calloc failed for parseTree\n");
+    exit(1);
+  }
+
+  astBuilder b = {AST, AST->source, NULL, 0, 0};
+  parseListener listener = {&b, NULL, onExit, onMatch, NULL};
+  if (parseInputSourceCodeStreaming(testcaseFile, T, G, &listener) < 0) {
+    free(b.values);
+    freeAST(AST);
+    return NULL;
+  }
+  if (b.valueCount > 0)
+    AST->root = b.values[b.valueCount - 1].node;
+  free(b.values);
+  return AST;
+}
+
+void printAST(astTree *AST, char *outfile) {
+  if (!AST || AST->root == AST_NONE) {
+    fprintf(stderr, "Warning: empty AST, nothing to print\n");
+    return;
+  }
+
+  FILE *fp = fopen(outfile, "w");
+  if (!fp) {
+    fprintf(stderr, "Error: Cannot open output file %s\n", outfile);
+    return;
+  }
+
+  uint32_t cap = 64, top = 0;
+  uint32_t *stack = (uint32_t *)malloc(cap * 2 * sizeof(uint32_t));
+  if (!stack) {
+    fprintf(stderr, "malloc failed in printAST\n");
+    exit(1);
+  }
+  stack[top * 2] = AST->root;
+  stack[top * 2 + 1] = 0;
+  top++;
+
+  const parseTree *PT = AST->source;
+  while (top > 0) {
+    top--;
+    uint32_t idx = stack[top * 2];
+    uint32_t depth = stack[top * 2 + 1];
+    const astNode *n = &AST->nodes[idx];
+
+    fprintf(fp, "%*s%s", (int)(depth * 2), "", getAstKindName((astKind)n->kind));
+    if (n->op)
+      fprintf(fp, " %s", getTokenName((TokenType)n->op));
+    if (n->token != PT_NONE) {
+      const parseToken *tk = &PT->tokens[n->token];
+      if (tk->tokenType == TK_NUM)
+        fprintf(fp, " %d", tk->value.intValue);
+      else if (tk->tokenType == TK_RNUM)
+        fprintf(fp, " %.2f", tk->value.realValue);
+      else if (n->kind != AST_BINOP && n->kind != AST_LOGICOP &&
+               n->kind != AST_RELOP)
+        fprintf(fp, " %s", PT->lexemes + tk->lexeme);
+      fprintf(fp, " (line %d)", tk->lineNumber);
+    }
+    fputc('\n', fp);
+
+    uint32_t kids = 0;
+    for (uint32_t c = n->firstChild; c != AST_NONE;
+         c = AST->nodes[c].nextSibling)
+      kids++;
+    if (top + kids > cap) {
+      while (top + kids > cap)
+        cap *= 2;
+      uint32_t *p = (uint32_t *)realloc(stack, cap * 2 * sizeof(uint32_t));
+      if (!p) {
+        fprintf(stderr, "realloc failed in printAST\n");
+        exit(1);
+      }
+      stack = p;
+    }
+    top += kids;
+    uint32_t slot = top;
+    for (uint32_t c = n->firstChild; c != AST_NONE;
+         c = AST->nodes[c].nextSibling) {
+      slot--;
+      stack[slot * 2] = c;
+      stack[slot * 2 + 1] = depth + 1;
+    }
+  }
+
+  free(stack);
+  fclose(fp);
+  printf("AST written to %s (%u nodes)\n", outfile, AST->nodeCount);
+}
+
+void freeAST(astTree *AST) {
+  if (!AST)
+    return;
+  freeParseTree(AST->source);
+  free(AST->nodes);
+  free(AST);
+}
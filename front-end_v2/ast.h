@@ -0,0 +1,14 @@
+#ifndef AST_H
+#define AST_H
+#include "astDef.h"
+#include "parser.h"
+
+astTree *buildAST(char *testcaseFile, table *T, grammar *G);
+
+void printAST(astTree *AST, char *outfile);
+
+void freeAST(astTree *AST);
+
+const char *getAstKindName(astKind kind);
+
+#endif
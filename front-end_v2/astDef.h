@@ -0,0 +1,62 @@
+#ifndef ASTDEF_H
+#define ASTDEF_H
+#include "parserDef.h"
+
+#define AST_NONE UINT32_MAX
+
+typedef enum {
+  AST_PROGRAM = 0,
+  AST_FUNCTION,     // token: TK_FUNID; children: PARAMS(in) PARAMS(out) BODY
+  AST_MAIN,         // token: TK_MAIN; children: BODY
+  AST_PARAMS,       // op: TK_INPUT / TK_OUTPUT; children: PARAM*
+  AST_PARAM,        // token: TK_ID; children: TYPE
+  AST_TYPE,         // op: TK_INT / TK_REAL / TK_RECORD / TK_UNION / TK_RUID
+  AST_BODY,         // children: type definitions, DECL*, statements, RETURN
+  AST_RECORD_TYPE,  // token: TK_RUID; children: FIELD*
+  AST_UNION_TYPE,   // token: TK_RUID; children: FIELD*
+  AST_FIELD,        // token: TK_FIELDID; children: TYPE
+  AST_DEFINETYPE,   // op: TK_RECORD / TK_UNION; token: TK_RUID; children: RUID
+  AST_DECL,         // op: TK_GLOBAL or 0; token: TK_ID; children: TYPE
+  AST_ASSIGN,       // token: TK_ASSIGNOP; children: lvalue expr
+  AST_CALL,         // token: TK_FUNID; children: IDLIST(out) IDLIST(in)
+  AST_WHILE,        // children: cond BLOCK
+  AST_IF,           // children: cond BLOCK [BLOCK]
+  AST_BLOCK,        // children: statements
+  AST_READ,         // children: lvalue
+  AST_WRITE,        // children: var
+  AST_RETURN,       // children: ID*
+  AST_IDLIST,       // children: ID*
+  AST_BINOP,        // op: TK_PLUS / TK_MINUS / TK_MUL / TK_DIV
+  AST_LOGICOP,      // op: TK_AND / TK_OR
+  AST_RELOP,        // op: TK_LT ... TK_NE
+  AST_NOT,          // children: cond
+  AST_FIELD_ACCESS, // token: TK_ID; children: FIELDID*
+  AST_ID,
+  AST_FIELDID,
+  AST_RUID,
+  AST_NUM,
+  AST_RNUM,
+  AST_LIST,         // fallback for rules without a dedicated action
+  AST_KIND_COUNT
+} astKind;
+
+/* Nodes are appended bottom-up as rules complete, so children precede
+   their parent in the array. Sibling order is kept through nextSibling. */
+typedef struct {
+  uint8_t kind;
+  uint8_t op;
+  uint16_t childCount;
+  uint32_t firstChild;
+  uint32_t nextSibling;
+  uint32_t token;
+} astNode;
+
+typedef struct {
+  astNode *nodes;
+  uint32_t nodeCount;
+  uint32_t nodeCapacity;
+  uint32_t root;
+  parseTree *source; /* token stream referenced by astNode.token */
+} astTree;
+
+#endif
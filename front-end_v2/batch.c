@@ -0,0 +1,328 @@
+#define _POSIX_C_SOURCE 200809L
+#include "batch.h"
+#include "parserContext.h"
+#include "resultCache.h"
+#include <dirent.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+  batchItem *items;
+  uint32_t count;
+  uint32_t capacity;
+} batchList;
+
+static void addBatchFile(batchList *L, const char *path, long bytes) {
+  if (L->count == L->capacity) {
+    uint32_t cap = L->capacity ? 2 * L->capacity : 256;
+    batchItem *p = (batchItem *)realloc(L->items, cap * sizeof(batchItem));
+    if (!p) {
+      fprintf(stderr, "realloc failed for batch files\n");
+      exit(1);
+    }
+    L->items = p;
+    L->capacity = cap;
+  }
+  batchItem *it = &L->items[L->count++];
+  memset(it, 0, sizeof(*it));
+  it->path = strdup(path);
+  if (!it->path) {
+    fprintf(stderr, "strdup failed for batch file\n");
+    exit(1);
+  }
+  it->bytes = bytes;
+}
+
+static int compareNames(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void addBatchPath(batchList *L, const char *path);
+
+static void addBatchDirectory(batchList *L, const char *path) {
+  DIR *d = opendir(path);
+  if (!d) {
+    fprintf(stderr, "Error: Cannot open directory %s\n", path);
+    return;
+  }
+  char **names = NULL;
+  size_t count = 0, cap = 0;
+  struct dirent *e;
+  while ((e = readdir(d)) != NULL) {
+    if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0)
+      continue;
+    if (count == cap) {
+      cap = cap ? 2 * cap : 64;
+      char **p = (char **)realloc(names, cap * sizeof(char *));
+      if (!p) {
+        fprintf(stderr, "realloc failed for directory entries\n");
+        exit(1);
+      }
+      names = p;
+    }
+    size_t n = strlen(path) + strlen(e->d_name) + 2;
+    names[count] = (char *)malloc(n);
+    if (!names[count]) {
+      fprintf(stderr, "malloc failed for directory entry\n");
+      exit(1);
+    }
+    snprintf(names[count], n, "%s/%s", path, e->d_name);
+    count++;
+  }
+  closedir(d);
+  qsort(names, count, sizeof(char *), compareNames);
+  for (size_t i = 0; i < count; i++) {
+    addBatchPath(L, names[i]);
+    free(names[i]);
+  }
+  free(names);
+}
+
+static void addBatchList(batchList *L, const char *listFile) {
+  FILE *fp = strcmp(listFile, "-") == 0 ? stdin : fopen(listFile, "r");
+  if (!fp) {
+    fprintf(stderr, "Error: Cannot open file list %s\n", listFile);
+    return;
+  }
+  char *line = NULL;
+  size_t cap = 0;
+  ssize_t n;
+  while ((n = getline(&line, &cap, fp)) > 0) {
+    while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r'))
+      line[--n] = '\0';
+    if (n > 0)
+      addBatchPath(L, line);
+  }
+  free(line);
+  if (fp != stdin)
+    fclose(fp);
+}
+
+static void addBatchPath(batchList *L, const char *path) {
+  struct stat sb;
+  if (stat(path, &sb) != 0)
+    addBatchFile(L, path, -1);
+  else if (S_ISDIR(sb.st_mode))
+    addBatchDirectory(L, path);
+  else if (S_ISREG(sb.st_mode))
+    addBatchFile(L, path, (long)sb.st_size);
+}
+
+batchItem *collectBatchFiles(int argc, char **argv, uint32_t *count) {
+  batchList L = {NULL, 0, 0};
+  for (int i = 0; i < argc; i++) {
+    if (argv[i][0] == '@')
+      addBatchList(&L, argv[i] + 1);
+    else
+      addBatchPath(&L, argv[i]);
+  }
+  *count = L.count;
+  return L.items;
+}
+
+void freeBatchFiles(batchItem *items, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++)
+    free(items[i].path);
+  free(items);
+}
+
+typedef struct {
+  const parserShared *S;
+  batchItem *items;
+  batchWorker *workers;
+  uint32_t workerCount;
+  int parse;
+  resultCache *RC;
+} batchPool;
+
+typedef struct {
+  batchPool *P;
+  uint32_t id;
+} batchTask;
+
+static int takeOwn(batchWorker *W, uint32_t *item) {
+  int found = 0;
+  pthread_mutex_lock(&W->queue.lock);
+  if (W->queue.head < W->queue.tail) {
+    *item = W->queue.head++;
+    found = 1;
+  }
+  pthread_mutex_unlock(&W->queue.lock);
+  return found;
+}
+
+/* Moves the upper half of some other worker's block to W and claims its
+   first item. Only one lock is held at a time. */
+static int stealWork(batchPool *P, uint32_t id, uint32_t *item) {
+  for (uint32_t k = 1; k < P->workerCount; k++) {
+    batchWorker *V = &P->workers[(id + k) % P->workerCount];
+    uint32_t lo = 0, hi = 0;
+    pthread_mutex_lock(&V->queue.lock);
+    uint32_t left = V->queue.tail - V->queue.head;
+    if (left > 0) {
+      hi = V->queue.tail;
+      lo = hi - (left + 1) / 2;
+      V->queue.tail = lo;
+    }
+    pthread_mutex_unlock(&V->queue.lock);
+    if (lo == hi)
+      continue;
+    batchWorker *W = &P->workers[id];
+    pthread_mutex_lock(&W->queue.lock);
+    W->queue.head = lo + 1;
+    W->queue.tail = hi;
+    pthread_mutex_unlock(&W->queue.lock);
+    W->steals++;
+    *item = lo;
+    return 1;
+  }
+  return 0;
+}
+
+static void reserveArena(batchWorker *W, uint32_t need) {
+  if (W->arenaSize + need <= W->arenaCapacity)
+    return;
+  uint32_t cap = W->arenaCapacity ? W->arenaCapacity : 4096;
+  while (cap < W->arenaSize + need)
+    cap *= 2;
+  char *p = (char *)realloc(W->arena, cap);
+  if (!p) {
+    fprintf(stderr, "realloc failed for batch report arena\n");
+    exit(1);
+  }
+  W->arena = p;
+  W->arenaCapacity = cap;
+}
+
+static void appendReport(batchWorker *W, const char *fmt, ...) {
+  va_list ap, again;
+  va_start(ap, fmt);
+  va_copy(again, ap);
+  int n = vsnprintf(NULL, 0, fmt, ap);
+  va_end(ap);
+  reserveArena(W, (uint32_t)n + 1);
+  vsnprintf(W->arena + W->arenaSize, (size_t)n + 1, fmt, again);
+  va_end(again);
+  W->arenaSize += (uint32_t)n;
+}
+
+static void processItem(batchPool *P, uint32_t id, batchItem *it) {
+  batchWorker *W = &P->workers[id];
+  it->worker = id;
+  it->report = W->arenaSize;
+  if (it->bytes < 0 || access(it->path, R_OK) != 0) {
+    it->status = -1;
+    appendReport(W, "%s: Error: Cannot open file\n", it->path);
+  } else {
+    if (P->RC)
+      cachedResultForFile(P->RC, P->parse ? RESULT_PARSE : RESULT_CHECK,
+                          W->C, it->path);
+    else if (P->parse)
+      parseWithContext(W->C, it->path);
+    else
+      checkSyntaxWithContext(W->C, it->path);
+    if (P->parse)
+      it->nodes = W->C->tree.nodeCount;
+    it->status = W->C->status;
+    for (int k = 0; k < W->C->diag.count; k++)
+      appendReport(W, "%s: Line %d\tError: %s\n", it->path,
+                   W->C->diag.items[k].lineNumber,
+                   W->C->diag.items[k].message);
+  }
+  it->reportSize = W->arenaSize - it->report;
+  W->files++;
+}
+
+static void *batchWorkerMain(void *arg) {
+  batchTask *task = (batchTask *)arg;
+  batchPool *P = task->P;
+  uint32_t item;
+  while (takeOwn(&P->workers[task->id], &item) ||
+         stealWork(P, task->id, &item))
+    processItem(P, task->id, &P->items[item]);
+  return NULL;
+}
+
+static double wallClock(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+uint32_t runBatch(const parserShared *S, batchItem *items, uint32_t count,
+                  int threads, int parse, resultCache *RC, FILE *out,
+                  batchStats *st) {
+  if (threads <= 0) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = n > 0 ? (int)n : 1;
+  }
+  if ((uint32_t)threads > count)
+    threads = count ? (int)count : 1;
+
+  batchPool P;
+  P.S = S;
+  P.items = items;
+  P.workerCount = (uint32_t)threads;
+  P.parse = parse;
+  P.RC = RC;
+  P.workers = (batchWorker *)calloc(P.workerCount, sizeof(batchWorker));
+  batchTask *tasks = (batchTask *)malloc(P.workerCount * sizeof(batchTask));
+  pthread_t *threadIds = (pthread_t *)malloc(P.workerCount * sizeof(pthread_t));
+  if (!P.workers || !tasks || !threadIds) {
+    fprintf(stderr, "malloc failed for batch workers\n");
+    exit(1);
+  }
+  for (uint32_t w = 0; w < P.workerCount; w++) {
+    batchWorker *W = &P.workers[w];
+    W->C = createParserContext(S);
+    pthread_mutex_init(&W->queue.lock, NULL);
+    W->queue.head = (uint32_t)((uint64_t)count * w / P.workerCount);
+    W->queue.tail = (uint32_t)((uint64_t)count * (w + 1) / P.workerCount);
+    tasks[w].P = &P;
+    tasks[w].id = w;
+  }
+
+  double start = wallClock();
+  uint32_t started = 0;
+  for (uint32_t w = 1; w < P.workerCount; w++)
+    if (pthread_create(&threadIds[started], NULL, batchWorkerMain,
+                       &tasks[w]) == 0)
+      started++;
+  batchWorkerMain(&tasks[0]);
+  for (uint32_t i = 0; i < started; i++)
+    pthread_join(threadIds[i], NULL);
+  double seconds = wallClock() - start;
+
+  memset(st, 0, sizeof(*st));
+  st->files = count;
+  st->seconds = seconds;
+  st->workers = P.workerCount;
+  for (uint32_t i = 0; i < count; i++) {
+    batchItem *it = &items[i];
+    if (it->reportSize)
+      fwrite(P.workers[it->worker].arena + it->report, 1, it->reportSize,
+             out);
+    if (it->status <= 0)
+      st->failed++;
+    if (it->status < 0)
+      st->unreadable++;
+    else
+      st->bytes += (uint64_t)it->bytes;
+    st->nodes += it->nodes;
+  }
+
+  for (uint32_t w = 0; w < P.workerCount; w++) {
+    st->steals += P.workers[w].steals;
+    pthread_mutex_destroy(&P.workers[w].queue.lock);
+    freeParserContext(P.workers[w].C);
+    free(P.workers[w].arena);
+  }
+  free(P.workers);
+  free(tasks);
+  free(threadIds);
+  return st->failed;
+}
@@ -0,0 +1,25 @@
+#ifndef BATCH_H
+#define BATCH_H
+#include "batchDef.h"
+#include <stdio.h>
+
+/* Expands the arguments into a list of files: a directory contributes
+   every regular file below it in name order, "@list" the paths listed one
+   per line in that file ("@-" reads stdin), anything else is taken as a
+   file. Returns NULL with *count = 0 if nothing was found. */
+batchItem *collectBatchFiles(int argc, char **argv, uint32_t *count);
+
+/* Checks (parse == 0) or fully parses every item on `threads` workers
+   (<= 0: one per online CPU), each with its own parserContext and report
+   arena on the shared tables S. Files are handed out in contiguous blocks
+   and idle workers steal half of a busy one's remaining block. Reports
+   are written to out in input order once all files are done. Returns the
+   number of files with errors or unreadable. With a cache RC, files whose
+   result it holds are not parsed again. */
+uint32_t runBatch(const parserShared *S, batchItem *items, uint32_t count,
+                  int threads, int parse, resultCache *RC, FILE *out,
+                  batchStats *st);
+
+void freeBatchFiles(batchItem *items, uint32_t count);
+
+#endif
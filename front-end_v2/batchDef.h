@@ -0,0 +1,48 @@
+#ifndef BATCHDEF_H
+#define BATCHDEF_H
+#include "parserContextDef.h"
+#include "resultCacheDef.h"
+#include <pthread.h>
+
+/* One input file. Its report (diagnostic lines, already prefixed with the
+   path) is [report, report + reportSize) in its worker's arena. */
+typedef struct {
+  char *path;
+  long bytes;
+  int status; /* 1 correct, 0 errors, -1 unreadable */
+  uint32_t nodes;
+  uint32_t worker;
+  uint32_t report;
+  uint32_t reportSize;
+} batchItem;
+
+/* Unclaimed items [head, tail) of a worker. The owner takes from head,
+   thieves take the upper half from tail. */
+typedef struct {
+  pthread_mutex_t lock;
+  uint32_t head;
+  uint32_t tail;
+} batchDeque;
+
+typedef struct {
+  parserContext *C;
+  batchDeque queue;
+  char *arena;
+  uint32_t arenaSize;
+  uint32_t arenaCapacity;
+  uint32_t files;
+  uint32_t steals;
+} batchWorker;
+
+typedef struct {
+  uint32_t files;
+  uint32_t failed;     /* with errors or unreadable */
+  uint32_t unreadable;
+  uint64_t bytes;
+  uint64_t nodes;      /* parse mode: tree nodes built */
+  double seconds;      /* wall time of the pool */
+  uint32_t workers;
+  uint32_t steals;
+} batchStats;
+
+#endif
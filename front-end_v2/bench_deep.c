@@ -0,0 +1,129 @@
+/**
+ * bench_deep.c
+ * Deep-nesting traversal benchmark
+ * CS F363 Compiler Design Project - BITS Pilani
+ *
+ * Writes a synthetic program whose single expression (or while loop) is
+ * nested `depth` levels deep, parses it, builds the Euler-tour index and
+ * runs every treeWalk order and the tree printer over it. None of these
+ * recurse, so the C stack stays flat at any depth.
+ *
+ * Usage: bench_deep [-w] [depth]   (-w nests while loops instead of
+ * parentheses; the default depth is 1000000)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "parser.h"
+#include "treeWalk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEEP_SOURCE "bench_deep_input.txt"
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int writeDeepProgram(const char *path, long depth, int loops) {
+  FILE *fp = fopen(path, "w");
+  if (!fp) {
+    fprintf(stderr, "Error: Cannot open output file %s\n", path);
+    return -1;
+  }
+  fprintf(fp, "_main\n\ttype int : b2;\n\tb2 <--- 1;\n");
+  if (loops) {
+    for (long i = 0; i < depth; i++)
+      fputs("while (b2 <= b2)\n", fp);
+    fputs("b2 <--- b2;\n", fp);
+    for (long i = 0; i < depth; i++)
+      fputs("endwhile\n", fp);
+  } else {
+    fputs("\tb2 <--- ", fp);
+    for (long i = 0; i < depth; i++)
+      fputc('(', fp);
+    fputs("b2", fp);
+    for (long i = 0; i < depth; i++)
+      fputc(')', fp);
+    fputs(";\n", fp);
+  }
+  fprintf(fp, "\treturn;\nend\n");
+  return fclose(fp);
+}
+
+static double timeWalk(const parseTree *PT, walkOrder order, uint32_t *n) {
+  double t0 = now();
+  treeWalker W;
+  treeWalkBegin(&W, PT, 0, order, NULL);
+  uint32_t count = 0;
+  while (treeWalkNext(&W) != PT_NONE)
+    count++;
+  *n = count;
+  return now() - t0;
+}
+
+int main(int argc, char *argv[]) {
+  int loops = 0;
+  int arg = 1;
+  if (arg < argc && strcmp(argv[arg], "-w") == 0) {
+    loops = 1;
+    arg++;
+  }
+  long depth = arg < argc ? atol(argv[arg]) : 1000000;
+  if (depth < 1) {
+    fprintf(stderr, "Usage: %s [-w] [depth]\n", argv[0]);
+    return 1;
+  }
+
+  if (writeDeepProgram(DEEP_SOURCE, depth, loops) != 0)
+    return 1;
+
+  grammar *G = initializeGrammar();
+  FirstAndFollow F = computeFirstAndFollowSets(G);
+  table T;
+  createParseTable(&F, &T, G);
+
+  double t0 = now();
+  parseTree *PT = parseInputSourceCode(DEEP_SOURCE, &T, G);
+  double tParse = now() - t0;
+  if (!PT) {
+    free(G);
+    return 1;
+  }
+
+  t0 = now();
+  treeIndex *I = indexParseTree(PT);
+  double tIndex = now() - t0;
+  uint32_t maxDepth = 0, deepest = 0;
+  for (uint32_t i = 0; i < I->count; i++)
+    if (I->depth[i] > maxDepth) {
+      maxDepth = I->depth[i];
+      deepest = i;
+    }
+
+  printf("%s nesting %ld: %u nodes, tree depth %u\n",
+         loops ? "while" : "parenthesis", depth, PT->nodeCount, maxDepth);
+  printf("  parse                 %8.3f s\n", tParse);
+  printf("  Euler-tour index      %8.3f s  (root is ancestor of deepest: %s)\n",
+         tIndex, parseTreeIsAncestor(PT, 0, deepest) ? "yes" : "no");
+
+  static const char *names[] = {"preorder", "postorder", "inorder"};
+  for (int o = 0; o < 3; o++) {
+    uint32_t n;
+    double t = timeWalk(PT, (walkOrder)o, &n);
+    printf("  %-9s walk        %8.3f s  (%u nodes)\n", names[o], t, n);
+  }
+
+  t0 = now();
+  printParseTree(PT, "/dev/null");
+  printf("  printParseTree        %8.3f s\n", now() - t0);
+
+  freeTreeIndex(I);
+  freeParseTree(PT);
+  free(G);
+  remove(DEEP_SOURCE);
+  return 0;
+}
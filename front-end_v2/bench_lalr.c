@@ -0,0 +1,265 @@
+/**
+ * bench_lalr.c
+ * LL(1) vs LALR(1) engine benchmark
+ * CS F363 Compiler Design Project - BITS Pilani
+ *
+ * Runs both engines over each input without building a tree: recognize
+ * only (checkSyntax vs parseInputSourceCodeLALR) and with a listener that
+ * counts events (parseInputSourceCodeStreaming vs the LALR driver's
+ * shift/reduce callbacks). Reports the best time per byte of each, the
+ * events per token, and the growth of the peak RSS of a forked child that
+ * runs the engine once. Verdicts of the two engines must agree.
+ *
+ * Usage: bench_lalr [-n reps] [-g functions] [file...]   (-g first writes a
+ * synthetic program with that many functions and benchmarks it as well)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "lalr.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SYNTHETIC_SOURCE "bench_lalr_input.txt"
+
+typedef struct {
+  long events;
+  long tokens;
+} benchCounts;
+
+typedef struct {
+  const lalrTable *LT;
+  const compactTable *CT;
+  table *T;
+  grammar *G;
+} engines;
+
+static void countEnter(void *ctx, NonTerminal nt, const GrammarRule *rule) {
+  (void)nt;
+  (void)rule;
+  ((benchCounts *)ctx)->events++;
+}
+
+static void countMatch(void *ctx, TokenType expected, const tokenInfo *tk) {
+  (void)expected;
+  benchCounts *c = (benchCounts *)ctx;
+  c->events++;
+  if (tk)
+    c->tokens++;
+}
+
+static void countError(void *ctx, int line, const char *message) {
+  (void)ctx;
+  (void)line;
+  (void)message;
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static long fileSize(const char *path) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp)
+    return -1;
+  fseek(fp, 0, SEEK_END);
+  long n = ftell(fp);
+  fclose(fp);
+  return n;
+}
+
+static int writeSyntheticProgram(const char *path, long functions) {
+  FILE *fp = fopen(path, "w");
+  if (!fp) {
+    fprintf(stderr, "Error: Cannot open output file %s\n", path);
+    return -1;
+  }
+  for (long i = 0; i < functions; i++)
+    fprintf(fp,
+            "_fn%ld input parameter list [int b2, real c3]\n"
+            "output parameter list [real d4];\n"
+            "\ttype int : b5;\n"
+            "\ttype real : c6;\n"
+            "\tb5 <--- b2 * 3 + (b2 - 1) / 2;\n"
+            "\twhile (b5 <= 100)\n"
+            "\t\tc6 <--- c3 + 1.50;\n"
+            "\t\tb5 <--- b5 + 1;\n"
+            "\tendwhile\n"
+            "\tif ((b5 > 10) &&& (c6 != 2.00)) then\n"
+            "\t\twrite(b5);\n"
+            "\telse\n"
+            "\t\tread(c6);\n"
+            "\tendif\n"
+            "\td4 <--- c6;\n"
+            "\treturn [d4];\n"
+            "end\n\n",
+            i);
+  fprintf(fp, "_main\n\ttype int : b2;\n\tb2 <--- 1;\n\twrite(b2);\n"
+              "\treturn;\nend\n");
+  return fclose(fp);
+}
+
+enum { RUN_LL_CHECK, RUN_LALR_CHECK, RUN_LL_EVENTS, RUN_LALR_EVENTS };
+
+static int runEngine(const engines *E, int which, char *file,
+                     benchCounts *counts) {
+  parseDiagnostics D = {NULL, 0, 0};
+  parseListener L = {counts, NULL, NULL, countMatch, countError};
+  int ok;
+  switch (which) {
+  case RUN_LL_CHECK:
+    ok = checkSyntax(file, E->CT, &D);
+    break;
+  case RUN_LALR_CHECK:
+    ok = parseInputSourceCodeLALR(file, E->LT, NULL, &D);
+    break;
+  case RUN_LL_EVENTS:
+    L.enterNonTerminal = countEnter;
+    ok = parseInputSourceCodeStreaming(file, E->T, E->G, &L);
+    break;
+  default:
+    L.exitNonTerminal = countEnter;
+    ok = parseInputSourceCodeLALR(file, E->LT, &L, NULL);
+    break;
+  }
+  freeDiagnostics(&D);
+  return ok;
+}
+
+/* KB the peak RSS of a child grows by while it runs the engine once. */
+static long peakGrowth(const engines *E, int which, char *file) {
+  int fd[2];
+  if (pipe(fd) != 0)
+    return -1;
+  pid_t pid = fork();
+  if (pid == 0) {
+    struct rusage before, after;
+    getrusage(RUSAGE_SELF, &before);
+    benchCounts counts = {0, 0};
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, 2);
+    runEngine(E, which, file, &counts);
+    getrusage(RUSAGE_SELF, &after);
+    long kb = after.ru_maxrss - before.ru_maxrss;
+    if (write(fd[1], &kb, sizeof(kb)) != (ssize_t)sizeof(kb))
+      _exit(1);
+    _exit(0);
+  }
+  close(fd[1]);
+  long kb = -1;
+  if (pid < 0 || read(fd[0], &kb, sizeof(kb)) != (ssize_t)sizeof(kb))
+    kb = -1;
+  close(fd[0]);
+  if (pid > 0)
+    waitpid(pid, NULL, 0);
+  return kb;
+}
+
+int main(int argc, char *argv[]) {
+  int reps = 20;
+  long functions = 0;
+  int first = 1;
+  while (first + 1 < argc && argv[first][0] == '-') {
+    if (strcmp(argv[first], "-n") == 0)
+      reps = atoi(argv[first + 1]);
+    else if (strcmp(argv[first], "-g") == 0)
+      functions = atol(argv[first + 1]);
+    else
+      break;
+    first += 2;
+  }
+  if ((first >= argc && functions <= 0) || reps < 1) {
+    fprintf(stderr, "Usage: %s [-n reps] [-g functions] [file...]\n", argv[0]);
+    return 1;
+  }
+
+  grammar *G = initializeGrammar();
+  FirstAndFollow F = computeFirstAndFollowSets(G);
+  table T;
+  createParseTable(&F, &T, G);
+  compactTable CT;
+  createCompactTable(&T, G, &CT);
+
+  double t0 = now();
+  lalrTable *LT = createLalrTable(G);
+  double built = now() - t0;
+  engines E = {LT, &CT, &T, G};
+
+  printf("LL(1): compact table %zu bytes\n", sizeof(compactTable));
+  printf("LALR(1): %u states, %u kernel items, %u shift/reduce and %u "
+         "reduce/reduce conflicts, %zu table bytes, built in %.2f ms\n\n",
+         LT->stateCount, LT->kernelItems, LT->srConflicts, LT->rrConflicts,
+         lalrTableBytes(LT), built * 1e3);
+
+  int fileCount = argc - first + (functions > 0);
+  char **files = (char **)malloc((size_t)fileCount * sizeof(char *));
+  if (!files) {
+    fprintf(stderr, "malloc failed for file list\n");
+    return 1;
+  }
+  for (int f = first; f < argc; f++)
+    files[f - first] = argv[f];
+  if (functions > 0) {
+    if (writeSyntheticProgram(SYNTHETIC_SOURCE, functions) != 0)
+      return 1;
+    files[fileCount - 1] = SYNTHETIC_SOURCE;
+  }
+
+  printf("%-32s  %8s  %10s  %10s  %10s  %10s  %9s  %9s  %7s  %7s  %s\n",
+         "file", "bytes", "LL ns/B", "LALR ns/B", "LL ev ns/B", "LALR ev",
+         "LL ev/tk", "LALR ev/tk", "LL +KB", "LALR +KB", "verdict");
+
+  int mismatches = 0;
+  for (int f = 0; f < fileCount; f++) {
+    long bytes = fileSize(files[f]);
+    if (bytes <= 0) {
+      fprintf(stderr, "Error: Cannot read %s\n", files[f]);
+      continue;
+    }
+
+    double best[4] = {1e30, 1e30, 1e30, 1e30};
+    benchCounts counts[4];
+    int verdict[4];
+    for (int r = 0; r < reps; r++)
+      for (int w = 0; w < 4; w++) {
+        benchCounts c = {0, 0};
+        double a = now();
+        verdict[w] = runEngine(&E, w, files[f], &c);
+        double b = now();
+        if (b - a < best[w])
+          best[w] = b - a;
+        counts[w] = c;
+      }
+
+    int same = verdict[RUN_LL_CHECK] == verdict[RUN_LALR_CHECK];
+    if (!same)
+      mismatches++;
+    double perByte = 1e9 / (double)bytes;
+    long llTokens = counts[RUN_LL_EVENTS].tokens;
+    long lrTokens = counts[RUN_LALR_EVENTS].tokens;
+    printf("%-32s  %8ld  %10.2f  %10.2f  %10.2f  %10.2f  %9.2f  %9.2f  %7ld  "
+           "%7ld  %s\n",
+           files[f], bytes, best[RUN_LL_CHECK] * perByte,
+           best[RUN_LALR_CHECK] * perByte, best[RUN_LL_EVENTS] * perByte,
+           best[RUN_LALR_EVENTS] * perByte,
+           llTokens ? (double)counts[RUN_LL_EVENTS].events / llTokens : 0.0,
+           lrTokens ? (double)counts[RUN_LALR_EVENTS].events / lrTokens : 0.0,
+           peakGrowth(&E, RUN_LL_EVENTS, files[f]),
+           peakGrowth(&E, RUN_LALR_EVENTS, files[f]),
+           same ? (verdict[RUN_LL_CHECK] ? "correct" : "errors") : "DIFFERENT");
+  }
+
+  free(files);
+  freeLalrTable(LT);
+  free(G);
+  if (functions > 0)
+    remove(SYNTHETIC_SOURCE);
+  return mismatches ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+/**
+ * bench_parser.c
+ * Parser throughput benchmark
+ * CS F363 Compiler Design Project - BITS Pilani
+ *
+ * Times the recognize-only check (checkSyntax), the same check with the
+ * lexer fused into the LL(1) loop (checkSyntaxFused) and the event-stream
+ * parse (parseInputSourceCodeStreaming) on each input and reports cost per
+ * byte.
+ * The first file is the baseline for the "x clean" column, so pass a clean
+ * input first (make bench uses bench_cases/clean.txt).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "parser.h"
+#include "fusedParser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+  int errors;
+} benchCounts;
+
+static void countError(void *ctx, int line, const char *message) {
+  (void)line;
+  (void)message;
+  ((benchCounts *)ctx)->errors++;
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static long fileSize(const char *path) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp)
+    return -1;
+  fseek(fp, 0, SEEK_END);
+  long n = ftell(fp);
+  fclose(fp);
+  return n;
+}
+
+int main(int argc, char *argv[]) {
+  int reps = 20;
+  int first = 1;
+  if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+    reps = atoi(argv[2]);
+    first = 3;
+  }
+  if (first >= argc || reps < 1) {
+    fprintf(stderr, "Usage: %s [-n reps] <clean_file> [file...]\n", argv[0]);
+    return 1;
+  }
+
+  grammar *G = initializeGrammar();
+  FirstAndFollow F = computeFirstAndFollowSets(G);
+  table T;
+  createParseTable(&F, &T, G);
+  compactTable CT;
+  createCompactTable(&T, G, &CT);
+
+  printf("%-32s  %8s  %6s  %12s  %12s  %12s  %8s\n", "file", "bytes",
+         "errors", "check ns/B", "fused ns/B", "stream ns/B", "x clean");
+
+  double baseline = 0;
+  parseDiagnostics D = {NULL, 0, 0};
+  for (int f = first; f < argc; f++) {
+    long bytes = fileSize(argv[f]);
+    if (bytes <= 0) {
+      fprintf(stderr, "Error: Cannot read %s\n", argv[f]);
+      continue;
+    }
+
+    double bestCheck = 1e30, bestFused = 1e30, bestStream = 1e30;
+    benchCounts counts = {0};
+    for (int r = 0; r < reps; r++) {
+      D.count = 0;
+      double t0 = now();
+      checkSyntax(argv[f], &CT, &D);
+      double t1 = now();
+      D.count = 0;
+      checkSyntaxFused(argv[f], &CT, &D);
+      double t2 = now();
+
+      counts.errors = 0;
+      parseListener L = {&counts, NULL, NULL, NULL, countError};
+      parseInputSourceCodeStreaming(argv[f], &T, G, &L);
+      double t3 = now();
+
+      if (t1 - t0 < bestCheck)
+        bestCheck = t1 - t0;
+      if (t2 - t1 < bestFused)
+        bestFused = t2 - t1;
+      if (t3 - t2 < bestStream)
+        bestStream = t3 - t2;
+    }
+
+    double checkNs = bestCheck * 1e9 / (double)bytes;
+    double fusedNs = bestFused * 1e9 / (double)bytes;
+    double streamNs = bestStream * 1e9 / (double)bytes;
+    if (f == first)
+      baseline = streamNs;
+    printf("%-32s  %8ld  %6d  %12.2f  %12.2f  %12.2f  %8.2f\n", argv[f], bytes,
+           counts.errors, checkNs, fusedNs, streamNs, streamNs / baseline);
+  }
+
+  freeDiagnostics(&D);
+  free(G);
+  return 0;
+}
@@ -0,0 +1,125 @@
+/**
+ * bench_rd.c
+ * Table-driven vs generated recursive-descent parser benchmark
+ * CS F363 Compiler Design Project - BITS Pilani
+ *
+ * Builds the full parse tree of each input with parseInputSourceCode and
+ * with parseInputSourceCodeRD, checks that the trees are identical, and
+ * reports the best time per byte of each engine.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "rdParser.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static long fileSize(const char *path) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp)
+    return -1;
+  fseek(fp, 0, SEEK_END);
+  long n = ftell(fp);
+  fclose(fp);
+  return n;
+}
+
+static int sameTree(const parseTree *a, const parseTree *b) {
+  return a->nodeCount == b->nodeCount && a->tokenCount == b->tokenCount &&
+         memcmp(a->nodes, b->nodes, a->nodeCount * sizeof(parseTreeNode)) ==
+             0 &&
+         memcmp(a->tokens, b->tokens, a->tokenCount * sizeof(parseToken)) ==
+             0;
+}
+
+/* Both engines print their verdict and errors; keep them off the table. */
+static int silence(void) {
+  fflush(stdout);
+  fflush(stderr);
+  int saved[2] = {dup(1), dup(2)};
+  int null = open("/dev/null", O_WRONLY);
+  dup2(null, 1);
+  dup2(null, 2);
+  close(null);
+  return saved[0] | (saved[1] << 16);
+}
+
+static void restore(int saved) {
+  fflush(stdout);
+  fflush(stderr);
+  dup2(saved & 0xffff, 1);
+  dup2(saved >> 16, 2);
+  close(saved & 0xffff);
+  close(saved >> 16);
+}
+
+int main(int argc, char *argv[]) {
+  int reps = 20;
+  int first = 1;
+  if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+    reps = atoi(argv[2]);
+    first = 3;
+  }
+  if (first >= argc || reps < 1) {
+    fprintf(stderr, "Usage: %s [-n reps] <file> [file...]\n", argv[0]);
+    return 1;
+  }
+
+  grammar *G = initializeGrammar();
+  FirstAndFollow F = computeFirstAndFollowSets(G);
+  table T;
+  createParseTable(&F, &T, G);
+
+  printf("%-32s  %8s  %12s  %12s  %8s  %s\n", "file", "bytes", "table ns/B",
+         "rd ns/B", "speedup", "tree");
+
+  int mismatches = 0;
+  for (int f = first; f < argc; f++) {
+    long bytes = fileSize(argv[f]);
+    if (bytes <= 0) {
+      fprintf(stderr, "Error: Cannot read %s\n", argv[f]);
+      continue;
+    }
+
+    double bestTable = 1e30, bestRD = 1e30;
+    int same = 1;
+    for (int r = 0; r < reps; r++) {
+      int saved = silence();
+      double t0 = now();
+      parseTree *a = parseInputSourceCode(argv[f], &T, G);
+      double t1 = now();
+      parseTree *b = parseInputSourceCodeRD(argv[f]);
+      double t2 = now();
+      restore(saved);
+
+      if (r == 0)
+        same = a && b && sameTree(a, b);
+      if (a)
+        freeParseTree(a);
+      if (b)
+        freeParseTree(b);
+      if (t1 - t0 < bestTable)
+        bestTable = t1 - t0;
+      if (t2 - t1 < bestRD)
+        bestRD = t2 - t1;
+    }
+
+    if (!same)
+      mismatches++;
+    printf("%-32s  %8ld  %12.2f  %12.2f  %8.2f  %s\n", argv[f], bytes,
+           bestTable * 1e9 / (double)bytes, bestRD * 1e9 / (double)bytes,
+           bestTable / bestRD, same ? "same" : "DIFFERENT");
+  }
+
+  free(G);
+  return mismatches ? 1 : 0;
+}
@@ -1,7 +1,22 @@
 #include "lexer.h"
 #include "parser.h"
+#include "ast.h"
+#include "treeFile.h"
+#include "grammarFile.h"
+#include "rdParser.h"
+#include "parserContext.h"
+#include "treeDag.h"
+#include "xrefIndex.h"
+#include "fusedParser.h"
+#include "lalr.h"
+#include "sdt.h"
+#include "batch.h"
+#include "server.h"
+#include "resultCache.h"
+#include "util.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 void printImplementationStatus(void);
@@ -10,9 +25,103 @@ void optionCommentRemoval(char *sourceFile);
 void optionPrintTokens(char *sourceFile);
 void optionParsing(char *sourceFile, char *parseTreeFile);
 void optionTiming(char *sourceFile);
+void optionAST(char *sourceFile, char *astFile);
+void optionStreaming(char *sourceFile);
+void optionSyntaxCheck(char *sourceFile);
+void optionParallelParsing(char *sourceFile, char *parseTreeFile);
+void optionBinaryTree(char *sourceFile, char *treeFile);
+void optionRecursiveDescent(char *sourceFile, char *parseTreeFile);
+void optionPipelinedParsing(char *sourceFile, char *parseTreeFile);
+void optionIncrementalParsing(char *sourceFile, char *parseTreeFile);
+void optionFlatExpressions(char *sourceFile, char *parseTreeFile);
+void optionBoundedParsing(char *sourceFile, char *parseTreeFile);
+void optionParseDag(char *sourceFile, char *dagFile);
+void optionFusedParsing(char *sourceFile, char *parseTreeFile);
+void optionLalrParsing(char *sourceFile);
+void optionTranslate(char *sourceFile, char *codeFile);
+int runReadTree(int argc, char **argv);
+int runSyntaxCheck(int fileCount, char **files);
+int runBatchCheck(int argc, char **argv);
+int runServe(int argc, char **argv);
+int runClient(int argc, char **argv);
+int runCacheStats(int argc, char **argv);
+int runDumpGrammar(int argc, char **argv);
+int runXrefBuild(int argc, char **argv);
+int runXrefFind(int argc, char **argv);
+
+/* Set by --grammar: parse with this BNF file instead of the built-in rules. */
+static const char *grammarPath = NULL;
+static int grammarCacheHit = 0;
+
+/* Set by --cache / --cache-size: keep check, parse and lex results in this
+   directory, capped at cacheLimit bytes (0: the default). */
+static const char *cachePath = NULL;
+static uint64_t cacheLimit = 0;
+
+static resultCache *openCache(const parserShared *S)
+{
+  return cachePath ? openResultCache(cachePath, cacheLimit, S) : NULL;
+}
+
+static void printCacheSummary(const resultCache *RC)
+{
+  if (!RC)
+    return;
+  unsigned long hits = atomic_load(&RC->hits);
+  unsigned long misses = atomic_load(&RC->misses);
+  printf("Cache: %lu hit(s), %lu miss(es), %lu stored (%.1f%% hits)\n", hits,
+         misses, atomic_load(&RC->stores),
+         hits + misses ? 100.0 * hits / (hits + misses) : 0.0);
+}
+
+static grammar *prepareGrammar(FirstAndFollow *F, table *T)
+{
+  if (!grammarPath)
+  {
+    grammar *G = initializeGrammar();
+    *F = computeFirstAndFollowSets(G);
+    createParseTable(F, T, G);
+    return G;
+  }
+  return loadGrammar(grammarPath, NULL, F, T, &grammarCacheHit);
+}
 
 int main(int argc, char *argv[])
 {
+  while (argc >= 3 && (strcmp(argv[1], "--grammar") == 0 ||
+                       strcmp(argv[1], "--cache") == 0 ||
+                       strcmp(argv[1], "--cache-size") == 0))
+  {
+    if (strcmp(argv[1], "--grammar") == 0)
+      grammarPath = argv[2];
+    else if (strcmp(argv[1], "--cache") == 0)
+      cachePath = argv[2];
+    else
+      cacheLimit = strtoull(argv[2], NULL, 10) << 20;
+    argv[2] = argv[0];
+    argc -= 2;
+    argv += 2;
+  }
+
+  if (argc >= 2 && strcmp(argv[1], "--dump-grammar") == 0)
+    return runDumpGrammar(argc - 2, argv + 2);
+  if (argc >= 2 && strcmp(argv[1], "--check") == 0)
+    return runSyntaxCheck(argc - 2, argv + 2);
+  if (argc >= 2 && strcmp(argv[1], "--batch") == 0)
+    return runBatchCheck(argc - 2, argv + 2);
+  if (argc >= 2 && strcmp(argv[1], "--serve") == 0)
+    return runServe(argc - 2, argv + 2);
+  if (argc >= 2 && strcmp(argv[1], "--client") == 0)
+    return runClient(argc - 2, argv + 2);
+  if (argc >= 2 && strcmp(argv[1], "--cache-stats") == 0)
+    return runCacheStats(argc - 2, argv + 2);
+  if (argc >= 2 && strcmp(argv[1], "--read-tree") == 0)
+    return runReadTree(argc - 2, argv + 2);
+  if (argc >= 2 && strcmp(argv[1], "--xref") == 0)
+    return runXrefBuild(argc - 2, argv + 2);
+  if (argc >= 2 && strcmp(argv[1], "--xref-find") == 0)
+    return runXrefFind(argc - 2, argv + 2);
+
   printImplementationStatus();
 
   if (argc < 3)
@@ -20,6 +129,21 @@ int main(int argc, char *argv[])
     fprintf(stderr, "Usage: %s <source_file.txt> <parsetree_output.txt>\n",
             argv[0]);
     fprintf(stderr, "Example: ./stage1exe testcase.txt parsetreeOutFile.txt\n");
+    fprintf(stderr, "       %s --check <source_file.txt>...\n", argv[0]);
+    fprintf(stderr, "       %s --batch [-j threads] [-p] [-q] <file|dir|@list>...\n",
+            argv[0]);
+    fprintf(stderr, "       %s --serve <socket>\n", argv[0]);
+    fprintf(stderr, "       %s --client <socket> check <file>... | parse <file> <out>"
+                    " | lex <file> | stats | shutdown\n", argv[0]);
+    fprintf(stderr, "       %s --read-tree [--verify] <tree.bin> <parsetree_output.txt>\n",
+            argv[0]);
+    fprintf(stderr, "       %s --dump-grammar <grammar.bnf>\n", argv[0]);
+    fprintf(stderr, "       %s --xref <index.xref> <source_file.txt>...\n",
+            argv[0]);
+    fprintf(stderr, "       %s --xref-find <index.xref> <name>\n", argv[0]);
+    fprintf(stderr, "       %s --cache-stats <dir>\n", argv[0]);
+    fprintf(stderr, "Any form may be preceded by --grammar <grammar.bnf>;\n");
+    fprintf(stderr, "--check, --batch and --serve also by --cache <dir> [--cache-size <MB>].\n");
     return 1;
   }
 
@@ -90,8 +214,78 @@ int main(int argc, char *argv[])
       optionTiming(sourceFile);
       break;
 
+    case 5:
+      printf(" ABSTRACT SYNTAX TREE \n");
+      optionAST(sourceFile, parseTreeFile);
+      break;
+
+    case 6:
+      printf(" EVENT STREAM PARSE \n");
+      optionStreaming(sourceFile);
+      break;
+
+    case 7:
+      printf(" SYNTAX CHECK ONLY \n");
+      optionSyntaxCheck(sourceFile);
+      break;
+
+    case 8:
+      printf(" PARALLEL SYNTAX ANALYSIS \n");
+      optionParallelParsing(sourceFile, parseTreeFile);
+      break;
+
+    case 9:
+      printf(" BINARY PARSE TREE \n");
+      optionBinaryTree(sourceFile, parseTreeFile);
+      break;
+
+    case 10:
+      printf(" RECURSIVE-DESCENT SYNTAX ANALYSIS \n");
+      optionRecursiveDescent(sourceFile, parseTreeFile);
+      break;
+
+    case 11:
+      printf(" PIPELINED SYNTAX ANALYSIS \n");
+      optionPipelinedParsing(sourceFile, parseTreeFile);
+      break;
+
+    case 12:
+      printf(" INCREMENTAL SYNTAX ANALYSIS \n");
+      optionIncrementalParsing(sourceFile, parseTreeFile);
+      break;
+
+    case 13:
+      printf(" SYNTAX ANALYSIS WITH FLAT EXPRESSIONS \n");
+      optionFlatExpressions(sourceFile, parseTreeFile);
+      break;
+
+    case 14:
+      printf(" BOUNDED-MEMORY SYNTAX ANALYSIS \n");
+      optionBoundedParsing(sourceFile, parseTreeFile);
+      break;
+
+    case 15:
+      printf(" HASH-CONSED PARSE DAG \n");
+      optionParseDag(sourceFile, parseTreeFile);
+      break;
+
+    case 16:
+      printf(" FUSED LEXER-PARSER SYNTAX ANALYSIS \n");
+      optionFusedParsing(sourceFile, parseTreeFile);
+      break;
+
+    case 17:
+      printf(" LALR(1) SYNTAX ANALYSIS \n");
+      optionLalrParsing(sourceFile);
+      break;
+
+    case 18:
+      printf(" SINGLE-PASS TRANSLATION \n");
+      optionTranslate(sourceFile, parseTreeFile);
+      break;
+
     default:
-      printf("Invalid option. Please choose 0-4.\n");
+      printf("Invalid option. Please choose 0-18.\n");
       break;
     }
 
@@ -133,6 +327,20 @@ void printMenu(void)
   printf("2 : Print token list (lexical analysis)\n");
   printf("3 : Parse and verify syntax (produces parse tree file)\n");
   printf("4 : Print total time taken by lexer and parser\n");
+  printf("5 : Build abstract syntax tree (writes AST to output file)\n");
+  printf("6 : Stream parse events without building a tree\n");
+  printf("7 : Check syntax only (no tree, no output file)\n");
+  printf("8 : Parse functions in parallel (produces parse tree file)\n");
+  printf("9 : Write parse tree in binary, mmap-able format to output file\n");
+  printf("10: Parse with the generated recursive-descent engine (produces parse tree file)\n");
+  printf("11: Parse with the lexer on its own thread (produces parse tree file)\n");
+  printf("12: Re-parse after each edit, reusing unchanged functions (produces parse tree file)\n");
+  printf("13: Parse expressions by precedence climbing into flat operator nodes (produces parse tree file)\n");
+  printf("14: Parse and write the tree one function at a time in bounded memory (produces parse tree file)\n");
+  printf("15: Build a parse DAG with repeated subtrees stored once (writes DAG to output file)\n");
+  printf("16: Parse with the lexer DFA fused into the LL(1) loop (produces parse tree file)\n");
+  printf("17: Check syntax with a generated LALR(1) shift-reduce parser (no tree)\n");
+  printf("18: Type-check and emit three-address code during the parse (writes code to output file)\n");
 }
 
 void optionCommentRemoval(char *sourceFile)
@@ -212,23 +420,39 @@ void optionPrintTokens(char *sourceFile)
 
 void optionParsing(char *sourceFile, char *parseTreeFile)
 {
-  printf("Initializing grammar...\n");
-  grammar *G = initializeGrammar();
-  printf("Grammar initialized with %d rules.\n", G->ruleCount);
+  FirstAndFollow F;
+  table T;
+  grammar *G;
+  if (grammarPath)
+  {
+    printf("Loading grammar from %s...\n", grammarPath);
+    G = prepareGrammar(&F, &T);
+    if (!G)
+      return;
+    printf("Grammar loaded with %d rules (%s).\n", G->ruleCount,
+           grammarCacheHit ? "compiled table read from cache"
+                           : "FIRST/FOLLOW and table computed, cache written");
+    printf("Parse table ready.\n\n");
+  }
+  else
+  {
+    printf("Initializing grammar...\n");
+    G = initializeGrammar();
+    printf("Grammar initialized with %d rules.\n", G->ruleCount);
 
-  printf("Computing FIRST and FOLLOW sets...\n");
-  FirstAndFollow F = computeFirstAndFollowSets(G);
-  printf("FIRST and FOLLOW sets computed.\n");
+    printf("Computing FIRST and FOLLOW sets...\n");
+    F = computeFirstAndFollowSets(G);
+    printf("FIRST and FOLLOW sets computed.\n");
 
-  printf("Building predictive parse table...\n");
-  table T;
-  createParseTable(&F, &T, G);
-  printf("Parse table ready.\n\n");
+    printf("Building predictive parse table...\n");
+    createParseTable(&F, &T, G);
+    printf("Parse table ready.\n\n");
+  }
 
   printf("Parsing: %s\n", sourceFile);
   parseTree *PT = parseInputSourceCode(sourceFile, &T, G);
 
-  if (PT && PT->root)
+  if (PT && PT->nodeCount > 0)
   {
     printParseTree(PT, parseTreeFile);
     freeParseTree(PT);
@@ -248,10 +472,11 @@ void optionTiming(char *sourceFile)
 
   start_time = clock();
 
-  grammar *G = initializeGrammar();
-  FirstAndFollow F = computeFirstAndFollowSets(G);
+  FirstAndFollow F;
   table T;
-  createParseTable(&F, &T, G);
+  grammar *G = prepareGrammar(&F, &T);
+  if (!G)
+    return;
 
   parseTree *PT = parseInputSourceCode(sourceFile, &T, G);
 
@@ -269,3 +494,795 @@ void optionTiming(char *sourceFile)
     freeParseTree(PT);
   free(G);
 }
+
+void optionAST(char *sourceFile, char *astFile)
+{
+  FirstAndFollow F;
+  table T;
+  grammar *G = prepareGrammar(&F, &T);
+  if (!G)
+    return;
+
+  printf("Building AST: %s\n", sourceFile);
+  astTree *AST = buildAST(sourceFile, &T, G);
+
+  if (AST && AST->root != AST_NONE)
+    printAST(AST, astFile);
+  else
+    fprintf(stderr, "Parsing failed – no AST generated.\n");
+
+  freeAST(AST);
+  free(G);
+}
+
+typedef struct
+{
+  long enters;
+  long exits;
+  long matches;
+  long missing;
+  int errors;
+  int depth;
+  int maxDepth;
+} streamStats;
+
+static void streamEnter(void *ctx, NonTerminal nt, const GrammarRule *rule)
+{
+  streamStats *st = (streamStats *)ctx;
+  (void)nt;
+  (void)rule;
+  st->enters++;
+  if (++st->depth > st->maxDepth)
+    st->maxDepth = st->depth;
+}
+
+static void streamExit(void *ctx, NonTerminal nt, const GrammarRule *rule)
+{
+  streamStats *st = (streamStats *)ctx;
+  (void)nt;
+  (void)rule;
+  st->exits++;
+  st->depth--;
+}
+
+static void streamMatch(void *ctx, TokenType expected, const tokenInfo *tk)
+{
+  streamStats *st = (streamStats *)ctx;
+  (void)expected;
+  if (tk)
+    st->matches++;
+  else
+    st->missing++;
+}
+
+static void streamError(void *ctx, int line, const char *message)
+{
+  streamStats *st = (streamStats *)ctx;
+  st->errors++;
+  fprintf(stderr, "Line %d\tError: %s\n", line, message);
+}
+
+void optionStreaming(char *sourceFile)
+{
+  FirstAndFollow F;
+  table T;
+  grammar *G = prepareGrammar(&F, &T);
+  if (!G)
+    return;
+
+  streamStats st = {0, 0, 0, 0, 0, 0, 0};
+  parseListener listener = {&st, streamEnter, streamExit, streamMatch,
+                            streamError};
+  int ok = parseInputSourceCodeStreaming(sourceFile, &T, G, &listener);
+
+  if (ok >= 0)
+  {
+    printf("Nonterminals entered : %ld\n", st.enters);
+    printf("Nonterminals exited  : %ld\n", st.exits);
+    printf("Terminals matched    : %ld\n", st.matches);
+    printf("Terminals missing    : %ld\n", st.missing);
+    printf("Maximum nesting depth: %d\n", st.maxDepth);
+    printf("Errors reported      : %d\n", st.errors);
+    printf("%s\n", ok ? "Input source code is syntactically correct..........."
+                      : "Input source code has syntax errors.");
+  }
+
+  free(G);
+}
+
+void optionSyntaxCheck(char *sourceFile)
+{
+  FirstAndFollow F;
+  table T;
+  grammar *G = prepareGrammar(&F, &T);
+  if (!G)
+    return;
+  compactTable CT;
+  createCompactTable(&T, G, &CT);
+
+  parseDiagnostics D = {NULL, 0, 0};
+  int ok = checkSyntaxFused(sourceFile, &CT, &D);
+  printDiagnostics(&D, stderr, NULL);
+  if (ok > 0)
+    printf("Input source code is syntactically correct...........\n");
+  else if (ok == 0)
+    printf("Input source code has %d error(s).\n", D.count);
+
+  freeDiagnostics(&D);
+  free(G);
+}
+
+void optionParallelParsing(char *sourceFile, char *parseTreeFile)
+{
+  FirstAndFollow F;
+  table T;
+  grammar *G = prepareGrammar(&F, &T);
+  if (!G)
+    return;
+
+  parseTree *PT = parseInputSourceCodeParallel(sourceFile, &T, G, 0);
+
+  if (PT && PT->nodeCount > 0)
+  {
+    printParseTreeParallel(PT, parseTreeFile, 0);
+    freeParseTree(PT);
+  }
+  else
+  {
+    fprintf(stderr, "Parsing failed – no parse tree generated.\n");
+  }
+
+  free(G);
+}
+
+void optionBinaryTree(char *sourceFile, char *treeFile)
+{
+  FirstAndFollow F;
+  table T;
+  grammar *G = prepareGrammar(&F, &T);
+  if (!G)
+    return;
+
+  parseTree *PT = parseInputSourceCode(sourceFile, &T, G);
+
+  if (PT && PT->nodeCount > 0)
+  {
+    if (writeTreeFile(PT, treeFile) == 0)
+      printf("Binary parse tree written to %s (%u nodes, %u tokens)\n",
+             treeFile, PT->nodeCount, PT->tokenCount);
+    freeParseTree(PT);
+  }
+  else
+  {
+    fprintf(stderr, "Parsing failed – no parse tree generated.\n");
+  }
+
+  free(G);
+}
+
+void optionRecursiveDescent(char *sourceFile, char *parseTreeFile)
+{
+  if (grammarPath)
+    printf("Note: the recursive-descent engine is generated from the built-in grammar; %s is not used.\n",
+           grammarPath);
+
+  parseTree *PT = parseInputSourceCodeRD(sourceFile);
+
+  if (PT && PT->nodeCount > 0)
+  {
+    printParseTree(PT, parseTreeFile);
+    freeParseTree(PT);
+  }
+  else
+  {
+    fprintf(stderr, "Parsing failed – no parse tree generated.\n");
+  }
+}
+
+void optionPipelinedParsing(char *sourceFile, char *parseTreeFile)
+{
+  FirstAndFollow F;
+  table T;
+  grammar *G = prepareGrammar(&F, &T);
+  if (!G)
+    return;
+
+  parseTree *PT = parseInputSourceCodePipelined(sourceFile, &T, G);
+
+  if (PT && PT->nodeCount > 0)
+  {
+    printParseTree(PT, parseTreeFile);
+    freeParseTree(PT);
+  }
+  else
+  {
+    fprintf(stderr, "Parsing failed – no parse tree generated.\n");
+  }
+
+  free(G);
+}
+
+void optionIncrementalParsing(char *sourceFile, char *parseTreeFile)
+{
+  FirstAndFollow F;
+  table T;
+  grammar *G = prepareGrammar(&F, &T);
+  if (!G)
+    return;
+
+  subtreeCache *C = createSubtreeCache();
+  char line[64];
+  do
+  {
+    clock_t start = clock();
+    parseTree *PT = parseInputSourceCodeIncremental(sourceFile, &T, G, C);
+    clock_t end = clock();
+
+    if (PT && PT->nodeCount > 0)
+    {
+      printParseTree(PT, parseTreeFile);
+      freeParseTree(PT);
+      printf("Functions reused: %u, re-parsed: %u (%.6f s)\n", C->hits,
+             C->misses, (double)(end - start) / CLOCKS_PER_SEC);
+    }
+    else
+    {
+      fprintf(stderr, "Parsing failed – no parse tree generated.\n");
+    }
+
+    printf("Edit %s and press Enter to re-parse, or q to stop: ", sourceFile);
+    fflush(stdout);
+  } while (fgets(line, sizeof(line), stdin) && line[0] != 'q');
+
+  freeSubtreeCache(C);
+  free(G);
+}
+
+void optionFlatExpressions(char *sourceFile, char *parseTreeFile)
+{
+  FirstAndFollow F;
+  table T;
+  grammar *G = prepareGrammar(&F, &T);
+  if (!G)
+    return;
+
+  clock_t start = clock();
+  parseTree *PT = parseInputSourceCodeFlat(sourceFile, &T, G);
+  clock_t end = clock();
+
+  if (PT && PT->nodeCount > 0)
+  {
+    printParseTree(PT, parseTreeFile);
+    printf("Parse tree nodes: %u in %.6f s\n", PT->nodeCount,
+           (double)(end - start) / CLOCKS_PER_SEC);
+    freeParseTree(PT);
+  }
+  else
+  {
+    fprintf(stderr, "Parsing failed – no parse tree generated.\n");
+  }
+
+  free(G);
+}
+
+void optionBoundedParsing(char *sourceFile, char *parseTreeFile)
+{
+  FirstAndFollow F;
+  table T;
+  grammar *G = prepareGrammar(&F, &T);
+  if (!G)
+    return;
+
+  printParseTreeBounded(sourceFile, &T, G, parseTreeFile);
+  free(G);
+}
+
+void optionParseDag(char *sourceFile, char *dagFile)
+{
+  FirstAndFollow F;
+  table T;
+  grammar *G = prepareGrammar(&F, &T);
+  if (!G)
+    return;
+
+  parseDag *D = buildParseDag(sourceFile, &T, G);
+  if (D && D->root != DAG_NONE)
+  {
+    printParseDag(D, dagFile, 10);
+    dagStats S = getDagStats(D);
+    printf("Tree nodes: %llu, DAG nodes: %u (%.2fx), shared subtrees: %u, %zu bytes\n",
+           (unsigned long long)S.treeNodes, S.dagNodes, S.ratio,
+           S.sharedNodes, S.dagBytes);
+  }
+  else
+  {
+    fprintf(stderr, "Parsing failed – no parse DAG generated.\n");
+  }
+  freeParseDag(D);
+  free(G);
+}
+
+void optionFusedParsing(char *sourceFile, char *parseTreeFile)
+{
+  FirstAndFollow F;
+  table T;
+  grammar *G = prepareGrammar(&F, &T);
+  if (!G)
+    return;
+
+  parseTree *PT = parseInputSourceCodeFused(sourceFile, &T, G);
+
+  if (PT && PT->nodeCount > 0)
+  {
+    printParseTree(PT, parseTreeFile);
+    freeParseTree(PT);
+  }
+  else
+  {
+    fprintf(stderr, "Parsing failed – no parse tree generated.\n");
+  }
+
+  free(G);
+}
+
+static void lalrReduce(void *ctx, NonTerminal nt, const GrammarRule *rule)
+{
+  (void)nt;
+  (void)rule;
+  ((streamStats *)ctx)->exits++;
+}
+
+void optionLalrParsing(char *sourceFile)
+{
+  FirstAndFollow F;
+  table T;
+  grammar *G = prepareGrammar(&F, &T);
+  if (!G)
+    return;
+
+  clock_t start = clock();
+  lalrTable *LT = createLalrTable(G);
+  clock_t built = clock();
+  printf("LALR(1) states: %u (%u kernel items), %u shift/reduce and %u "
+         "reduce/reduce conflicts, %zu table bytes, built in %.6f s\n",
+         LT->stateCount, LT->kernelItems, LT->srConflicts, LT->rrConflicts,
+         lalrTableBytes(LT), (double)(built - start) / CLOCKS_PER_SEC);
+
+  streamStats st = {0, 0, 0, 0, 0, 0, 0};
+  parseListener listener = {&st, NULL, lalrReduce, streamMatch, streamError};
+  start = clock();
+  int ok = parseInputSourceCodeLALR(sourceFile, LT, &listener, NULL);
+  clock_t end = clock();
+
+  if (ok >= 0)
+  {
+    printf("Shifts               : %ld\n", st.matches);
+    printf("Reductions           : %ld\n", st.exits);
+    printf("Errors reported      : %d\n", st.errors);
+    printf("Parse time           : %.6f s\n",
+           (double)(end - start) / CLOCKS_PER_SEC);
+    printf("%s\n", ok ? "Input source code is syntactically correct..........."
+                      : "Input source code has syntax errors.");
+  }
+
+  freeLalrTable(LT);
+  free(G);
+}
+
+void optionTranslate(char *sourceFile, char *codeFile)
+{
+  FirstAndFollow F;
+  table T;
+  grammar *G = prepareGrammar(&F, &T);
+  if (!G)
+    return;
+
+  FILE *out = fopen(codeFile, "w");
+  if (!out)
+  {
+    fprintf(stderr, "Error: Cannot open output file %s\n", codeFile);
+    free(G);
+    return;
+  }
+
+  sdtStats st;
+  clock_t start = clock();
+  int ok = translateStraightLine(sourceFile, &T, G, out, &st);
+  clock_t end = clock();
+  fclose(out);
+
+  if (ok >= 0)
+  {
+    printf("Functions            : %u\n", st.functions);
+    printf("Statements           : %u\n", st.statements);
+    printf("Instructions         : %u (%u temporaries, %u labels)\n",
+           st.instructions, st.temporaries, st.labels);
+    printf("Syntax errors        : %u\n", st.syntaxErrors);
+    printf("Type errors          : %u\n", st.typeErrors);
+    printf("Deepest stack        : %u frames\n", st.maxFrames);
+    printf("Translation time     : %.6f s\n",
+           (double)(end - start) / CLOCKS_PER_SEC);
+    printf("%s\n", ok ? "Three-address code written to the output file."
+                      : "Input source code has errors.");
+  }
+
+  free(G);
+}
+
+int runSyntaxCheck(int fileCount, char **files)
+{
+  if (fileCount < 1)
+  {
+    fprintf(stderr, "Usage: stage1exe --check <source_file.txt>...\n");
+    return 2;
+  }
+
+  parserShared *S = createParserShared(grammarPath);
+  if (!S)
+    return 1;
+  parserContext *C = createParserContext(S);
+  resultCache *RC = openCache(S);
+
+  int failed = 0;
+  for (int i = 0; i < fileCount; i++)
+  {
+    int ok = RC ? cachedResultForFile(RC, RESULT_CHECK, C, files[i])
+                : checkSyntaxWithContext(C, files[i]);
+    printDiagnostics(&C->diag, stderr, files[i]);
+    if (ok <= 0)
+      failed++;
+  }
+  freeParserContext(C);
+
+  printf("%d file(s) checked, %d with errors\n", fileCount, failed);
+  printCacheSummary(RC);
+  closeResultCache(RC);
+  freeParserShared(S);
+  return failed ? 1 : 0;
+}
+
+int runBatchCheck(int argc, char **argv)
+{
+  int threads = 0, parse = 0, quiet = 0, first = 0;
+  while (first < argc && argv[first][0] == '-' && argv[first][1] != '\0')
+  {
+    if (strcmp(argv[first], "-j") == 0 && first + 1 < argc)
+      threads = atoi(argv[++first]);
+    else if (strcmp(argv[first], "-p") == 0)
+      parse = 1;
+    else if (strcmp(argv[first], "-q") == 0)
+      quiet = 1;
+    else
+      break;
+    first++;
+  }
+
+  uint32_t count = 0;
+  batchItem *items = collectBatchFiles(argc - first, argv + first, &count);
+  if (count == 0)
+  {
+    fprintf(stderr, "Usage: stage1exe --batch [-j threads] [-p] [-q] <file|dir|@list>...\n");
+    freeBatchFiles(items, count);
+    return 2;
+  }
+
+  parserShared *S = createParserShared(grammarPath);
+  if (!S)
+  {
+    freeBatchFiles(items, count);
+    return 1;
+  }
+
+  FILE *out = quiet ? fopen("/dev/null", "w") : stderr;
+  resultCache *RC = openCache(S);
+  batchStats st;
+  runBatch(S, items, count, threads, parse, RC, out ? out : stderr, &st);
+  if (quiet && out)
+    fclose(out);
+
+  double mb = (double)st.bytes / (1024.0 * 1024.0);
+  printf("%u file(s) %s, %u with errors (%u unreadable)\n", st.files,
+         parse ? "parsed" : "checked", st.failed, st.unreadable);
+  if (parse)
+    printf("Parse tree nodes: %llu\n", (unsigned long long)st.nodes);
+  printf("%.2f MB in %.3f s on %u worker(s), %u steal(s): %.0f files/s, %.2f MB/s\n",
+         mb, st.seconds, st.workers, st.steals,
+         st.seconds > 0 ? st.files / st.seconds : 0.0,
+         st.seconds > 0 ? mb / st.seconds : 0.0);
+  printCacheSummary(RC);
+  closeResultCache(RC);
+
+  freeBatchFiles(items, count);
+  freeParserShared(S);
+  return st.failed ? 1 : 0;
+}
+
+int runServe(int argc, char **argv)
+{
+  if (argc != 1)
+  {
+    fprintf(stderr, "Usage: stage1exe --serve <socket>\n");
+    return 2;
+  }
+
+  parserShared *S = createParserShared(grammarPath);
+  if (!S)
+    return 1;
+  printf("Listening on %s\n", argv[0]);
+  fflush(stdout);
+  resultCache *RC = openCache(S);
+  int rc = runServer(argv[0], S, RC);
+  closeResultCache(RC);
+  freeParserShared(S);
+  return rc == 0 ? 0 : 1;
+}
+
+static int clientRequest(int fd, serverOp op, const char *path,
+                         serverResponse *R)
+{
+  size_t size = 0;
+  char *text = NULL;
+  if (path && !(text = readWholeFile(path, &size)))
+  {
+    fprintf(stderr, "Error: Cannot open file %s\n", path);
+    return -1;
+  }
+  int rc = callServer(fd, op, text, size, R);
+  free(text);
+  if (rc != 0)
+    fprintf(stderr, "Error: Lost connection to the server\n");
+  return rc;
+}
+
+static void printClientDiagnostics(const serverResponse *R, const char *path)
+{
+  const char *line = R->diag;
+  while (*line)
+  {
+    const char *end = strchr(line, '\n');
+    int len = end ? (int)(end - line) : (int)strlen(line);
+    fprintf(stderr, "%s: %.*s\n", path, len, line);
+    line += len + (end ? 1 : 0);
+  }
+}
+
+int runClient(int argc, char **argv)
+{
+  const char *op = argc >= 2 ? argv[1] : "";
+  int ok = (strcmp(op, "check") == 0 && argc >= 3) ||
+           (strcmp(op, "parse") == 0 && argc == 4) ||
+           (strcmp(op, "lex") == 0 && argc == 3) ||
+           ((strcmp(op, "stats") == 0 || strcmp(op, "shutdown") == 0) &&
+            argc == 2);
+  if (!ok)
+  {
+    fprintf(stderr, "Usage: stage1exe --client <socket> check <file>... | parse <file> <out>"
+                    " | lex <file> | stats | shutdown\n");
+    return 2;
+  }
+
+  int fd = connectServer(argv[0]);
+  if (fd < 0)
+  {
+    fprintf(stderr, "Error: Cannot connect to %s\n", argv[0]);
+    return 1;
+  }
+
+  serverResponse R;
+  int result = 0;
+  if (strcmp(op, "check") == 0)
+  {
+    int failed = 0, files = argc - 2;
+    double seconds = 0;
+    for (int i = 2; i < argc; i++)
+    {
+      if (clientRequest(fd, SERVER_CHECK, argv[i], &R) != 0)
+      {
+        failed++;
+        continue;
+      }
+      printClientDiagnostics(&R, argv[i]);
+      seconds += R.seconds;
+      if (R.header.status <= 0)
+        failed++;
+      freeServerResponse(&R);
+    }
+    printf("%d file(s) checked, %d with errors\n", files, failed);
+    printf("Average round trip   : %.3f ms\n", seconds * 1e3 / files);
+    result = failed ? 1 : 0;
+  }
+  else if (strcmp(op, "parse") == 0 || strcmp(op, "lex") == 0)
+  {
+    int parse = op[0] == 'p';
+    if (clientRequest(fd, parse ? SERVER_PARSE : SERVER_LEX, argv[2], &R) != 0)
+    {
+      disconnectServer(fd);
+      return 1;
+    }
+    printClientDiagnostics(&R, argv[2]);
+    treeFile *TF = openTreeImage(R.data, (size_t)R.header.dataLength);
+    R.data = NULL;
+    const char *problem = TF ? verifyTreeFile(TF) : NULL;
+    if (problem)
+      fprintf(stderr, "Error: tree image: %s\n", problem);
+    if (!TF || problem)
+      result = 1;
+    else if (parse)
+    {
+      printParseTree((parseTree *)treeFileTree(TF), argv[3]);
+      printf("%s\n", R.header.status > 0 ? "Input source code is syntactically correct..........."
+                                          : "Input source code has syntax errors.");
+    }
+    else
+    {
+      const parseTree *PT = treeFileTree(TF);
+      printf("%-10s  %-30s  %-22s\n", "Line", "Lexeme", "Token");
+      for (uint32_t i = 0; i < PT->tokenCount; i++)
+        printf("%-10d  %-30s  %-22s\n", PT->tokens[i].lineNumber,
+               PT->lexemes + PT->tokens[i].lexeme,
+               getTokenName(PT->tokens[i].tokenType));
+      printf("Total tokens listed: %u\n", PT->tokenCount);
+      if (R.header.errors > 0)
+        printf("Total lexical errors: %u  (details on stderr)\n", R.header.errors);
+    }
+    if (TF)
+      closeTreeFile(TF);
+    result = result || R.header.status <= 0;
+    freeServerResponse(&R);
+  }
+  else
+  {
+    if (clientRequest(fd, op[1] == 't' ? SERVER_STATS : SERVER_SHUTDOWN, NULL,
+                      &R) != 0)
+    {
+      disconnectServer(fd);
+      return 1;
+    }
+    if (R.header.dataLength)
+      fwrite(R.data, 1, (size_t)R.header.dataLength, stdout);
+    else
+      printf("Server on %s is shutting down\n", argv[0]);
+    freeServerResponse(&R);
+  }
+  disconnectServer(fd);
+  return result;
+}
+
+int runCacheStats(int argc, char **argv)
+{
+  if (argc != 1)
+  {
+    fprintf(stderr, "Usage: stage1exe --cache-stats <dir>\n");
+    return 2;
+  }
+
+  resultCacheStats st;
+  if (readResultCacheStats(argv[0], &st) != 0)
+  {
+    fprintf(stderr, "Error: %s is not a result cache\n", argv[0]);
+    return 1;
+  }
+  uint64_t lookups = st.hits + st.misses;
+  printf("Hits                 : %llu\n", (unsigned long long)st.hits);
+  printf("Misses               : %llu\n", (unsigned long long)st.misses);
+  printf("Hit rate             : %.1f%%\n",
+         lookups ? 100.0 * st.hits / lookups : 0.0);
+  printf("Stored               : %llu\n", (unsigned long long)st.stores);
+  printf("Evicted              : %llu\n", (unsigned long long)st.evictions);
+  printf("Entries              : %llu\n", (unsigned long long)st.entries);
+  printf("Size                 : %.2f MB of %.2f MB\n",
+         st.bytes / (1024.0 * 1024.0), st.maxBytes / (1024.0 * 1024.0));
+  return 0;
+}
+
+int runReadTree(int argc, char **argv)
+{
+  int verify = argc > 0 && strcmp(argv[0], "--verify") == 0;
+  argc -= verify;
+  argv += verify;
+  if (argc != 2)
+  {
+    fprintf(stderr, "Usage: stage1exe --read-tree [--verify] <tree.bin> <parsetree_output.txt>\n");
+    return 2;
+  }
+
+  clock_t start = clock();
+  treeFile *TF = openTreeFile(argv[0]);
+  clock_t end = clock();
+  if (!TF)
+    return 1;
+
+  const char *problem = verify ? verifyTreeFile(TF) : NULL;
+  if (problem)
+  {
+    fprintf(stderr, "Error: %s: %s\n", argv[0], problem);
+    closeTreeFile(TF);
+    return 1;
+  }
+
+  const parseTree *PT = treeFileTree(TF);
+  printf("Mapped %s: %u nodes, %u tokens in %.6f s\n", argv[0], PT->nodeCount,
+         PT->tokenCount, (double)(end - start) / CLOCKS_PER_SEC);
+  printParseTree((parseTree *)PT, argv[1]);
+  closeTreeFile(TF);
+  return 0;
+}
+
+int runDumpGrammar(int argc, char **argv)
+{
+  if (argc != 1)
+  {
+    fprintf(stderr, "Usage: stage1exe [--grammar <in.bnf>] --dump-grammar <out.bnf>\n");
+    return 2;
+  }
+
+  FirstAndFollow F;
+  table T;
+  grammar *G = prepareGrammar(&F, &T);
+  if (!G)
+    return 1;
+  int rc = writeGrammarFile(G, argv[0]);
+  if (rc == 0)
+    printf("%d rules written to %s\n", G->ruleCount, argv[0]);
+  free(G);
+  return rc == 0 ? 0 : 1;
+}
+
+int runXrefBuild(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: stage1exe --xref <index.xref> <source_file.txt>...\n");
+    return 2;
+  }
+
+  parserShared *S = createParserShared(grammarPath);
+  if (!S)
+    return 1;
+  parserContext *C = createParserContext(S);
+  xrefBuilder *B = createXrefBuilder();
+
+  int failed = 0;
+  for (int i = 1; i < argc; i++)
+  {
+    parseTree *PT = parseWithContext(C, argv[i]);
+    if (!PT)
+    {
+      failed++;
+      continue;
+    }
+    printDiagnostics(&C->diag, stderr, argv[i]);
+    xrefAddTree(B, argv[i], PT);
+  }
+  int rc = writeXrefIndex(B, argv[0]);
+  if (rc == 0)
+    printf("%u occurrences of %u names from %d file(s) written to %s\n",
+           B->recordCount, B->nameCount, argc - 1 - failed, argv[0]);
+  freeXrefBuilder(B);
+  freeParserContext(C);
+  freeParserShared(S);
+  return rc == 0 && failed == 0 ? 0 : 1;
+}
+
+int runXrefFind(int argc, char **argv)
+{
+  if (argc != 2)
+  {
+    fprintf(stderr, "Usage: stage1exe --xref-find <index.xref> <name>\n");
+    return 2;
+  }
+
+  xrefIndex *X = openXrefIndex(argv[0]);
+  if (!X)
+    return 1;
+  const xrefEntry *E;
+  uint32_t n = xrefLookup(X, argv[1], &E);
+  for (uint32_t i = 0; i < n; i++)
+    printf("%s:%u: %s %s (node %u)\n", xrefFileName(X, E[i].file), E[i].line,
+           E[i].kind == XREF_DEF ? "def" : "use",
+           getTokenName((TokenType)E[i].tokenType), E[i].node);
+  if (n == 0)
+    printf("%s not found\n", argv[1]);
+  closeXrefIndex(X);
+  return n > 0 ? 0 : 1;
+}
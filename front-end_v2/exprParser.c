@@ -0,0 +1,304 @@
+#include "exprParser.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static uint32_t newNode(exprScratch *S, SymbolType type, int id,
+                        uint32_t token) {
+  S->nodes = growArray(S->nodes, &S->nodeCapacity, S->nodeCount + 1,
+                       sizeof(exprNode), "expression nodes");
+  exprNode *n = &S->nodes[S->nodeCount];
+  n->symbolType = (uint8_t)type;
+  n->symbolId = (uint8_t)id;
+  n->token = token;
+  n->parent = n->first = n->last = n->next = PT_NONE;
+  return S->nodeCount++;
+}
+
+static void addChild(exprScratch *S, uint32_t parent, uint32_t child) {
+  exprNode *p = &S->nodes[parent];
+  S->nodes[child].parent = parent;
+  if (p->first == PT_NONE)
+    p->first = child;
+  else
+    S->nodes[p->last].next = child;
+  p->last = child;
+}
+
+static void pushOperand(exprScratch *S, uint32_t node) {
+  S->operands = growArray(S->operands, &S->operandCapacity,
+                          S->operandCount + 1, sizeof(uint32_t),
+                          "expression operands");
+  S->operands[S->operandCount++] = node;
+}
+
+static void pushFrame(exprScratch *S, uint32_t node, int prec, int stage) {
+  S->frames = growArray(S->frames, &S->frameCapacity, S->frameCount + 1,
+                        sizeof(exprFrame), "expression frames");
+  exprFrame *f = &S->frames[S->frameCount++];
+  f->node = node;
+  f->prec = prec;
+  f->stage = stage;
+  f->anchor = f->pending = 0;
+}
+
+static uint32_t take(parserState *ps) {
+  uint32_t token = ps->curIndex;
+  if (ps->quiet)
+    ps->quiet--;
+  nextMeaningfulToken(ps);
+  return token;
+}
+
+/* Where the LL(1) driver would expand A: if the table has no entry for
+   the lookahead, report and skip exactly as runParser does. Returns
+   nonzero if A can be expanded, 0 if it is given up as empty. */
+static int checkpoint(parserState *ps, const table *T, NonTerminal A,
+                      uint64_t anchor) {
+  if (T->entries[A][ps->curType].isValid)
+    return 1;
+  reportNoRule(ps, ps->curLine, ps->curType, ps->curLexeme, A);
+  uint64_t stop = T->firstMask[A] | T->followMask[A] | anchor;
+  while (ps->curType != TK_EOF && !(stop & TERMINAL_BIT(ps->curType)))
+    nextMeaningfulToken(ps);
+  return T->entries[A][ps->curType].isValid;
+}
+
+/* Terminal match with runParser's recovery; PT_NONE if t is missing.
+   anchor and pending are those of the stack entry below t. */
+static uint32_t expect(parserState *ps, TokenType t, uint64_t anchor,
+                       uint64_t pending) {
+  return recoverTerminal(ps, t, anchor, pending) ? take(ps) : PT_NONE;
+}
+
+/* <var> at a lookahead that can start it. */
+static uint32_t parseVar(parserState *ps, const table *T, exprScratch *S,
+                         uint64_t anchor, uint64_t pending) {
+  if (ps->curType != TK_ID) {
+    TokenType t = ps->curType;
+    return newNode(S, SYMBOL_TERMINAL, t, take(ps));
+  }
+  uint32_t id = newNode(S, SYMBOL_TERMINAL, TK_ID, take(ps));
+  NonTerminal more = NT_OPTION_SINGLE_CONSTRUCTED;
+  uint32_t rec = PT_NONE;
+  while (checkpoint(ps, T, more, anchor) && ps->curType == TK_DOT) {
+    if (rec == PT_NONE) {
+      rec = newNode(S, SYMBOL_NON_TERMINAL, NT_SINGLEORRECID, PT_NONE);
+      addChild(S, rec, id);
+    }
+    take(ps);
+    uint32_t field = newNode(S, SYMBOL_TERMINAL, TK_FIELDID, PT_NONE);
+    S->nodes[field].token = expect(
+        ps, TK_FIELDID, anchor | T->firstMask[NT_MOREEXPANSIONS], pending);
+    addChild(S, rec, field);
+    more = NT_MOREEXPANSIONS;
+  }
+  return rec != PT_NONE ? rec : id;
+}
+
+static void reduceOperator(exprScratch *S) {
+  uint32_t op = S->frames[--S->frameCount].node;
+  uint32_t right = S->operands[--S->operandCount];
+  uint32_t left = S->operands[S->operandCount - 1];
+  addChild(S, op, left);
+  addChild(S, op, right);
+  S->operands[S->operandCount - 1] = op;
+}
+
+/* Shunting-yard form of precedence climbing: frames hold pending
+   operators (prec 1: + -, prec 2: * /) and open parentheses (prec 0).
+   `want` is the nonterminal the LL(1) driver would expand for the next
+   operand, so checkpoints report the same stack top. */
+static uint32_t parseArithmetic(parserState *ps, const table *T,
+                                exprScratch *S, uint64_t anchor,
+                                uint64_t pending) {
+  const uint64_t rest = T->firstMask[NT_TERMPRIME] | T->firstMask[NT_EXPPRIME];
+  uint32_t depth = 0;
+  NonTerminal want = NT_ARITHMETICEXPRESSION;
+  for (;;) {
+    uint64_t a = anchor | (depth ? TERMINAL_BIT(TK_CL) : 0);
+    uint64_t p = pending | (depth ? TERMINAL_BIT(TK_CL) : 0);
+    if (!checkpoint(ps, T, want, a)) {
+      pushOperand(S, newNode(S, SYMBOL_NON_TERMINAL, want, PT_NONE));
+    } else if (ps->curType == TK_OP) {
+      take(ps);
+      pushFrame(S, PT_NONE, 0, 0);
+      depth++;
+      want = NT_ARITHMETICEXPRESSION;
+      continue;
+    } else {
+      pushOperand(S, parseVar(ps, T, S, a | rest, p));
+    }
+
+    for (;;) {
+      a = anchor | (depth ? TERMINAL_BIT(TK_CL) : 0);
+      int prec = 0;
+      checkpoint(ps, T, NT_TERMPRIME, a);
+      if (ps->curType == TK_MUL || ps->curType == TK_DIV) {
+        prec = 2;
+      } else {
+        checkpoint(ps, T, NT_EXPPRIME, a);
+        if (ps->curType == TK_PLUS || ps->curType == TK_MINUS)
+          prec = 1;
+      }
+      if (prec) {
+        while (S->frameCount > 0 && S->frames[S->frameCount - 1].prec >= prec)
+          reduceOperator(S);
+        TokenType t = ps->curType;
+        pushFrame(S, newNode(S, SYMBOL_TERMINAL, t, take(ps)), prec, 0);
+        want = prec == 2 ? NT_FACTOR : NT_TERM;
+        break;
+      }
+      while (S->frameCount > 0 && S->frames[S->frameCount - 1].prec > 0)
+        reduceOperator(S);
+      if (depth == 0)
+        return S->operands[--S->operandCount];
+      depth--;
+      expect(ps, TK_CL, anchor | (depth ? TERMINAL_BIT(TK_CL) : 0) | rest,
+             pending | (depth ? TERMINAL_BIT(TK_CL) : 0));
+      S->frameCount--;
+    }
+  }
+}
+
+#define BOOL_LOGIC_LEFT 0
+#define BOOL_LOGIC_RIGHT 1
+#define BOOL_NOT 2
+
+/* Frames are the open `(b) op (b)` and `~(b)` forms; every nesting level
+   is parenthesized, so no precedence is involved. Each frame keeps the
+   masks of its enclosing expression so that recovery inside it stops on
+   the same tokens as the LL(1) stack would. */
+static uint32_t parseBoolean(parserState *ps, const table *T, exprScratch *S,
+                             uint64_t anchor, uint64_t pending) {
+  const uint64_t cl = TERMINAL_BIT(TK_CL), op = TERMINAL_BIT(TK_OP);
+  uint64_t a = anchor, p = pending;
+  for (;;) {
+    uint32_t r;
+    if (!checkpoint(ps, T, NT_BOOLEANEXPRESSION, a)) {
+      r = newNode(S, SYMBOL_NON_TERMINAL, NT_BOOLEANEXPRESSION, PT_NONE);
+    } else if (ps->curType == TK_OP) {
+      take(ps);
+      pushFrame(S, PT_NONE, 0, BOOL_LOGIC_LEFT);
+      S->frames[S->frameCount - 1].anchor = a;
+      S->frames[S->frameCount - 1].pending = p;
+      a |= cl | op | T->firstMask[NT_LOGICALOP] |
+           T->firstMask[NT_BOOLEANEXPRESSION];
+      p |= cl | op;
+      continue;
+    } else if (ps->curType == TK_NOT) {
+      uint32_t n = newNode(S, SYMBOL_TERMINAL, TK_NOT, take(ps));
+      expect(ps, TK_OP, a | cl | T->firstMask[NT_BOOLEANEXPRESSION], p | cl);
+      pushFrame(S, n, 0, BOOL_NOT);
+      S->frames[S->frameCount - 1].anchor = a;
+      S->frames[S->frameCount - 1].pending = p;
+      a |= cl;
+      p |= cl;
+      continue;
+    } else {
+      uint64_t varFirst = T->firstMask[NT_VAR];
+      uint32_t left = parseVar(
+          ps, T, S, a | T->firstMask[NT_RELATIONALOP] | varFirst, p);
+      if (checkpoint(ps, T, NT_RELATIONALOP, a | varFirst)) {
+        TokenType t = ps->curType;
+        r = newNode(S, SYMBOL_TERMINAL, t, take(ps));
+      } else {
+        r = newNode(S, SYMBOL_NON_TERMINAL, NT_RELATIONALOP, PT_NONE);
+      }
+      uint32_t right = checkpoint(ps, T, NT_VAR, a)
+                           ? parseVar(ps, T, S, a, p)
+                           : newNode(S, SYMBOL_NON_TERMINAL, NT_VAR, PT_NONE);
+      addChild(S, r, left);
+      addChild(S, r, right);
+    }
+
+    int reopened = 0;
+    while (S->frameCount > 0 && !reopened) {
+      exprFrame *f = &S->frames[S->frameCount - 1];
+      a = f->anchor;
+      p = f->pending;
+      if (f->stage == BOOL_LOGIC_LEFT) {
+        expect(ps, TK_CL,
+               a | op | cl | T->firstMask[NT_LOGICALOP] |
+                   T->firstMask[NT_BOOLEANEXPRESSION],
+               p | op | cl);
+        uint32_t lop;
+        if (checkpoint(ps, T, NT_LOGICALOP,
+                       a | op | cl | T->firstMask[NT_BOOLEANEXPRESSION])) {
+          TokenType t = ps->curType;
+          lop = newNode(S, SYMBOL_TERMINAL, t, take(ps));
+        } else {
+          lop = newNode(S, SYMBOL_NON_TERMINAL, NT_LOGICALOP, PT_NONE);
+        }
+        addChild(S, lop, r);
+        expect(ps, TK_OP, a | cl | T->firstMask[NT_BOOLEANEXPRESSION], p | cl);
+        f->node = lop;
+        f->stage = BOOL_LOGIC_RIGHT;
+        a |= cl;
+        p |= cl;
+        reopened = 1;
+      } else {
+        expect(ps, TK_CL, a, p);
+        addChild(S, f->node, r);
+        r = f->node;
+        S->frameCount--;
+      }
+    }
+    if (!reopened)
+      return r;
+  }
+}
+
+void parseFlatExpression(parserState *ps, const table *T, NonTerminal nt,
+                         uint32_t parent, uint64_t anchor, uint64_t pending) {
+  if (!ps->expr) {
+    ps->expr = (exprScratch *)calloc(1, sizeof(exprScratch));
+    if (!ps->expr) {
+      fprintf(stderr, "calloc failed for exprScratch\n");
+      exit(1);
+    }
+  }
+  exprScratch *S = ps->expr;
+  S->nodeCount = S->operandCount = S->frameCount = 0;
+
+  uint32_t root = nt == NT_BOOLEANEXPRESSION
+                      ? parseBoolean(ps, T, S, anchor, pending)
+                      : parseArithmetic(ps, T, S, anchor, pending);
+
+  /* Copy out in preorder, walking the first/next/parent links. */
+  parseTree *PT = ps->PT;
+  S->operands = growArray(S->operands, &S->operandCapacity, S->nodeCount,
+                          sizeof(uint32_t), "expression operands");
+  uint32_t *out = S->operands; /* tree index of each scratch node */
+  uint32_t n = root;
+  for (;;) {
+    const exprNode *e = &S->nodes[n];
+    GrammarSymbol sym;
+    sym.type = (SymbolType)e->symbolType;
+    if (sym.type == SYMBOL_TERMINAL)
+      sym.symbol.terminal = (TokenType)e->symbolId;
+    else
+      sym.symbol.nonTerminal = (NonTerminal)e->symbolId;
+    out[n] =
+        createNode(PT, sym, e->parent == PT_NONE ? parent : out[e->parent]);
+    PT->nodes[out[n]].token = e->token;
+    if (e->first != PT_NONE) {
+      n = e->first;
+      continue;
+    }
+    while (n != root && S->nodes[n].next == PT_NONE)
+      n = S->nodes[n].parent;
+    if (n == root)
+      break;
+    n = S->nodes[n].next;
+  }
+}
+
+void freeExprScratch(exprScratch *S) {
+  if (!S)
+    return;
+  free(S->nodes);
+  free(S->operands);
+  free(S->frames);
+  free(S);
+}
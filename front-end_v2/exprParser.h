@@ -0,0 +1,19 @@
+#ifndef EXPRPARSER_H
+#define EXPRPARSER_H
+#include "exprParserDef.h"
+#include "parser.h"
+
+/* Parses the <arithmeticExpression> or <booleanExpression> at the
+   lookahead by precedence climbing and adds it under `parent` as flat
+   operator nodes: each operator token (or <relationalOp>/<logicalOp> left
+   empty by error recovery) has its operands as children, variables are
+   TK_ID / TK_NUM / TK_RNUM leaves or a <singleOrRecId> over the TK_ID and
+   TK_FIELDID tokens, and parentheses are dropped. Errors are reported in
+   the LL(1) driver's wording; anchor and pending are those of the parse
+   stack below the expression. Runs without recursion. */
+void parseFlatExpression(parserState *ps, const table *T, NonTerminal nt,
+                         uint32_t parent, uint64_t anchor, uint64_t pending);
+
+void freeExprScratch(exprScratch *S);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef EXPRPARSERDEF_H
+#define EXPRPARSERDEF_H
+#include "parserDef.h"
+
+/* Expression node built before it is copied into the parse tree in
+   preorder. Children are linked through first/next. */
+typedef struct {
+  uint8_t symbolType;
+  uint8_t symbolId;
+  uint32_t token;
+  uint32_t parent;
+  uint32_t first;
+  uint32_t last;
+  uint32_t next;
+} exprNode;
+
+/* Pending operator (or open parenthesis, prec 0) of an arithmetic
+   expression, or an open `(b) op (b)` / `~(b)` of a boolean one, with
+   the recovery masks in effect outside it. */
+typedef struct {
+  uint32_t node;
+  int prec;
+  int stage;
+  uint64_t anchor;
+  uint64_t pending;
+} exprFrame;
+
+/* Working storage of the flat expression parser, reused by every
+   expression of one parse. */
+typedef struct exprScratch {
+  exprNode *nodes;
+  uint32_t nodeCount;
+  uint32_t nodeCapacity;
+  uint32_t *operands;
+  uint32_t operandCount;
+  uint32_t operandCapacity;
+  exprFrame *frames;
+  uint32_t frameCount;
+  uint32_t frameCapacity;
+} exprScratch;
+
+#endif
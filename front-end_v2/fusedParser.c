@@ -0,0 +1,179 @@
+#include "fusedParser.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Messages are formed in a tokenInfo, as scanNextToken forms them. */
+static void lexicalError(parserState *ps, const lexSpan *tk) {
+  tokenInfo t;
+  spanToken(tk, &t);
+  reportError(ps, t.lineNumber, "%s", t.errorMsg[0] ? t.errorMsg : t.lexeme);
+}
+
+/* nextMeaningfulToken: the next token that is neither a comment nor a
+   lexical error. */
+static inline int nextSpan(lexCursor *S, lexSpan *tk, parserState *ps) {
+  for (;;) {
+    tk->type = scanSpan(S, tk);
+    if (tk->type == TK_ERROR)
+      lexicalError(ps, tk);
+    else if (tk->type != TK_COMMENT)
+      return tk->type;
+  }
+}
+
+int checkSyntaxFused(char *testcaseFile, const compactTable *CT,
+                     parseDiagnostics *D) {
+  size_t size;
+  char *text = readWholeFile(testcaseFile, &size);
+  if (!text) {
+    fprintf(stderr, "Error: Cannot open %s\n", testcaseFile);
+    return -1;
+  }
+  int ok = checkSyntaxBuffer(text, size, CT, D);
+  free(text);
+  return ok;
+}
+
+static GrammarSymbol packedSymbol(uint8_t sym) {
+  GrammarSymbol s;
+  if (sym >= CT_NT_BASE) {
+    s.type = SYMBOL_NON_TERMINAL;
+    s.symbol.nonTerminal = (NonTerminal)(sym - CT_NT_BASE);
+  } else {
+    s.type = SYMBOL_TERMINAL;
+    s.symbol.terminal = (TokenType)sym;
+  }
+  return s;
+}
+
+/* The only place a lexeme and value are materialized on the hot path. */
+static uint32_t attachToken(parseTree *PT, const lexSpan *tk) {
+  tokenInfo t;
+  spanToken(tk, &t);
+  return addParseToken(PT, &t);
+}
+
+/* The LL(1) loop of runParser over CT, shared by the check-only and the
+   tree-building entry points; PT is NULL for the former. */
+static int fusedParse(const char *text, size_t size, const compactTable *CT,
+                      parseTree *PT, parseDiagnostics *D) {
+  lexCursor C = {text, text + size, 1, 0};
+
+  /* checkSyntax drops diagnostics when D is NULL; reportError would print
+     them, so collect into a scratch list instead. */
+  parseDiagnostics scratch = {NULL, 0, 0};
+  parserState ps;
+  initParserState(&ps, PT, NULL);
+  ps.diag = D || PT ? D : &scratch;
+
+  compactStack S;
+  initCompactStack(&S, CT, PT != NULL);
+  lexSpan tk;
+  char lexeme[MAX_LEXEME_LENGTH];
+  int a = nextSpan(&C, &tk, &ps);
+
+  while (S.count > 0) {
+    uint32_t sp = --S.count;
+    int X = S.symbol[sp];
+
+    if (X == TK_EOF) {
+      if (a != TK_EOF && tk.line != ps.lastErrorLine)
+        reportError(&ps, tk.line, "Unexpected token %s encountered at end",
+                    getTokenName((TokenType)a));
+      break;
+    }
+
+    uint32_t tn =
+        PT ? createNode(PT, packedSymbol((uint8_t)X), S.parent[sp]) : PT_NONE;
+
+    if (X < CT_NT_BASE) {
+      if (X != a) {
+        spanLexeme(&tk, lexeme);
+        reportMismatch(&ps, tk.line, (TokenType)a, lexeme, (TokenType)X);
+        while (recoveryDeletes(a, X, S.anchor[sp - 1], S.pending[sp - 1]))
+          a = nextSpan(&C, &tk, &ps);
+      }
+      if (X == a) {
+        if (PT)
+          PT->nodes[tn].token = attachToken(PT, &tk);
+        if (ps.quiet)
+          ps.quiet--;
+        a = nextSpan(&C, &tk, &ps);
+      }
+      continue;
+    }
+
+    int A = X - CT_NT_BASE;
+    int r = CT->rule[A][a];
+    if (r < 0) {
+      spanLexeme(&tk, lexeme);
+      reportNoRule(&ps, tk.line, (TokenType)a, lexeme, (NonTerminal)A);
+      uint64_t stop = CT->first[X] | CT->follow[A] | S.anchor[sp - 1];
+      while (a != TK_EOF && !(stop & TERMINAL_BIT(a)))
+        a = nextSpan(&C, &tk, &ps);
+      r = CT->rule[A][a];
+      if (r < 0)
+        continue;
+    }
+    if (PT && CT->rhsCount[r] == 0)
+      createNode(PT, packedSymbol(TK_EPSILON), tn);
+    pushCompactRule(&S, CT, r, tn);
+  }
+
+  while (PT && S.count > 0) {
+    uint32_t sp = --S.count;
+    if (S.symbol[sp] != TK_EOF)
+      createNode(PT, packedSymbol(S.symbol[sp]), S.parent[sp]);
+  }
+  freeCompactStack(&S);
+  freeDiagnostics(&scratch);
+  if (PT)
+    computeSubtreeEnds(PT);
+  return ps.errorCount == 0;
+}
+
+int checkSyntaxBuffer(const char *text, size_t size, const compactTable *CT,
+                      parseDiagnostics *D) {
+  return fusedParse(text, size, CT, NULL, D);
+}
+
+int parseBufferIntoTree(const char *text, size_t size, const compactTable *CT,
+                        parseTree *PT, parseDiagnostics *D) {
+  return fusedParse(text, size, CT, PT, D);
+}
+
+parseTree *parseInputSourceCodeFused(char *testcaseFile, table *T,
+                                     grammar *G) {
+  size_t size;
+  char *text = readWholeFile(testcaseFile, &size);
+  if (!text) {
+    fprintf(stderr, "Error: Cannot open %s\n", testcaseFile);
+    return NULL;
+  }
+  parseTree *PT = (parseTree *)calloc(1, sizeof(parseTree));
+  if (!PT) {
+    fprintf(stderr, "calloc failed for parseTree\n");
+    exit(1);
+  }
+  compactTable CT;
+  createCompactTable(T, G, &CT);
+  if (parseBufferIntoTree(text, size, &CT, PT, NULL) > 0)
+    printf("Input source code is syntactically correct...........\n");
+  free(text);
+  return PT;
+}
+
+int lexBuffer(const char *text, size_t size, parseTree *stream,
+              parseDiagnostics *D) {
+  lexCursor S = {text, text + size, 1, 0};
+  parseDiagnostics scratch = {NULL, 0, 0};
+  parserState ps;
+  initParserState(&ps, stream, NULL);
+  ps.diag = D ? D : &scratch;
+  lexSpan tk;
+  while (nextSpan(&S, &tk, &ps) != TK_EOF)
+    attachToken(stream, &tk);
+  freeDiagnostics(&scratch);
+  return ps.errorCount == 0;
+}
@@ -0,0 +1,37 @@
+#ifndef FUSEDPARSER_H
+#define FUSEDPARSER_H
+#include "parser.h"
+
+/* Fused lexer-parser engine. The whole file is read into memory and the
+   LL(1) loop calls the lexer DFA (scanSpan) that yields only the token
+   type, line and span; no tokenInfo is filled in. Lexemes and values
+   are copied out only for diagnostics and for terminals attached to tree
+   nodes. Tokens, errors and recovery are those of scanNextToken and
+   runParser. */
+
+/* Same result and diagnostics as checkSyntax. */
+int checkSyntaxFused(char *testcaseFile, const compactTable *CT,
+                     parseDiagnostics *D);
+
+/* Same tree and diagnostics as parseInputSourceCode. The token stream
+   holds only the matched terminals, not every token read. */
+parseTree *parseInputSourceCodeFused(char *testcaseFile, table *T,
+                                     grammar *G);
+
+/* The same engines over a source already in memory (text[0, size), need
+   not be NUL-terminated), for callers that never had a file. Errors go to
+   D (printed when D is NULL for parseBufferIntoTree, dropped for the
+   others). Return 1 if the input is correct, 0 on errors. */
+int checkSyntaxBuffer(const char *text, size_t size, const compactTable *CT,
+                      parseDiagnostics *D);
+
+/* Appends the tree to PT (normally empty), as parseIntoTree does. */
+int parseBufferIntoTree(const char *text, size_t size, const compactTable *CT,
+                        parseTree *PT, parseDiagnostics *D);
+
+/* Appends every token but comments to stream->tokens; lexical errors are
+   reported, not stored. */
+int lexBuffer(const char *text, size_t size, parseTree *stream,
+              parseDiagnostics *D);
+
+#endif
@@ -0,0 +1,256 @@
+/**
+ * gen_rd_parser.c
+ * Recursive-descent parser generator
+ * CS F363 Compiler Design Project - BITS Pilani
+ *
+ * Emits rdParser.c: one function per nonterminal that switches on the
+ * lookahead and calls the functions for its right-hand side directly. The
+ * generated code follows runParser step for step (node order, error
+ * messages and recovery sets), so both engines produce the same tree.
+ *
+ * Usage: gen_rd_parser [--grammar grammar.bnf] <out.c>
+ */
+
+#include "parser.h"
+#include "grammarFile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *functionName(NonTerminal nt) {
+  static char buf[64];
+  const char *name = getNonTerminalName(nt);
+  size_t len = strlen(name) - 2; /* strip < > */
+  snprintf(buf, sizeof(buf), "rd_%.*s", (int)len, name + 1);
+  return buf;
+}
+
+static uint64_t symbolFirst(const table *T, GrammarSymbol sym) {
+  if (sym.type == SYMBOL_NON_TERMINAL)
+    return T->firstMask[sym.symbol.nonTerminal];
+  return sym.symbol.terminal == TK_EPSILON ? 0
+                                           : TERMINAL_BIT(sym.symbol.terminal);
+}
+
+static uint64_t symbolPending(GrammarSymbol sym) {
+  if (sym.type != SYMBOL_TERMINAL || sym.symbol.terminal == TK_EPSILON)
+    return 0;
+  return TERMINAL_BIT(sym.symbol.terminal);
+}
+
+static void emitPrologue(FILE *out) {
+  fprintf(out,
+          "/* Generated by gen_rd_parser - do not edit. */\n"
+          "#include \"rdParser.h\"\n"
+          "\n"
+          "static uint32_t rdNode(parserState *ps, SymbolType type, int id,\n"
+          "                       uint32_t parent) {\n"
+          "  GrammarSymbol sym;\n"
+          "  sym.type = type;\n"
+          "  if (type == SYMBOL_TERMINAL)\n"
+          "    sym.symbol.terminal = (TokenType)id;\n"
+          "  else\n"
+          "    sym.symbol.nonTerminal = (NonTerminal)id;\n"
+          "  return createNode(ps->PT, sym, parent);\n"
+          "}\n"
+          "\n"
+          "static void rdMatch(parserState *ps, uint32_t parent, TokenType t,\n"
+          "                    uint64_t anchor, uint64_t pending) {\n"
+          "  uint32_t tn = rdNode(ps, SYMBOL_TERMINAL, (int)t, parent);\n"
+          "  if (recoverTerminal(ps, t, anchor, pending)) {\n"
+          "    ps->PT->nodes[tn].token = ps->curIndex;\n"
+          "    if (ps->quiet)\n"
+          "      ps->quiet--;\n"
+          "    nextMeaningfulToken(ps);\n"
+          "  }\n"
+          "}\n"
+          "\n"
+          "/* No production for the lookahead: report, skip to `stop`, and say\n"
+          "   whether the nonterminal can now be expanded (`valid`). */\n"
+          "static int rdRecover(parserState *ps, NonTerminal nt, uint64_t "
+          "valid,\n"
+          "                     uint64_t stop) {\n"
+          "  reportNoRule(ps, ps->curLine, ps->curType, ps->curLexeme, nt);\n"
+          "  while (ps->curType != TK_EOF && !(stop & "
+          "TERMINAL_BIT(ps->curType)))\n"
+          "    nextMeaningfulToken(ps);\n"
+          "  return (valid & TERMINAL_BIT(ps->curType)) != 0;\n"
+          "}\n"
+          "\n");
+}
+
+static void emitMask(FILE *out, uint64_t mask, const char *rest) {
+  if (mask)
+    fprintf(out, "0x%llxULL | %s", (unsigned long long)mask, rest);
+  else
+    fprintf(out, "%s", rest);
+}
+
+static void emitSymbol(FILE *out, const table *T, const GrammarRule *rule,
+                       int i, NonTerminal self, int *tail) {
+  uint64_t anchor = 0, pending = 0;
+  for (int j = i + 1; j < rule->rhsCount; j++) {
+    anchor |= symbolFirst(T, rule->rhs[j]);
+    pending |= symbolPending(rule->rhs[j]);
+  }
+  GrammarSymbol sym = rule->rhs[i];
+
+  if (sym.type == SYMBOL_TERMINAL && sym.symbol.terminal == TK_EPSILON) {
+    fprintf(out, "    rdNode(ps, SYMBOL_TERMINAL, TK_EPSILON, tn);\n");
+  } else if (sym.type == SYMBOL_TERMINAL) {
+    fprintf(out, "    rdMatch(ps, tn, %s, ", getTokenName(sym.symbol.terminal));
+    emitMask(out, anchor, "anchor, ");
+    emitMask(out, pending, "pending);\n");
+  } else if (i == rule->rhsCount - 1 && sym.symbol.nonTerminal == self) {
+    fprintf(out, "    parent = tn;\n    goto tail;\n");
+    *tail = 1;
+  } else {
+    fprintf(out, "    %s(ps, tn, ", functionName(sym.symbol.nonTerminal));
+    emitMask(out, anchor, "anchor, ");
+    emitMask(out, pending, "pending);\n");
+  }
+}
+
+static void emitNonTerminal(FILE *out, const table *T, const grammar *G,
+                            NonTerminal A) {
+  const char *fn = functionName(A);
+  fprintf(out, "/* %s */\n", getNonTerminalName(A));
+  fprintf(out,
+          "static void %s(parserState *ps, uint32_t parent, uint64_t anchor,\n"
+          "                uint64_t pending) {\n",
+          fn);
+
+  int selfTail = 0;
+  for (int r = 0; r < G->ruleCount; r++) {
+    const GrammarRule *rule = &G->rules[r];
+    if (rule->lhs == A && rule->rhsCount > 0 &&
+        rule->rhs[rule->rhsCount - 1].type == SYMBOL_NON_TERMINAL &&
+        rule->rhs[rule->rhsCount - 1].symbol.nonTerminal == A)
+      selfTail = 1;
+  }
+  if (selfTail)
+    fprintf(out, "tail:;\n");
+  fprintf(out, "  uint32_t tn = rdNode(ps, SYMBOL_NON_TERMINAL, %d, parent);\n",
+          (int)A);
+  fprintf(out, "dispatch:\n  switch (ps->curType) {\n");
+
+  uint64_t valid = 0;
+  for (int r = 0; r < G->ruleCount; r++) {
+    const GrammarRule *rule = &G->rules[r];
+    if (rule->lhs != A)
+      continue;
+    int any = 0;
+    for (int t = 0; t < TABLE_TERMINALS; t++) {
+      const ParseTableEntry *e = &T->entries[A][t];
+      if (!e->isValid || e->ruleNumber != rule->ruleNumber)
+        continue;
+      fprintf(out, "  case %s:\n", getTokenName((TokenType)t));
+      valid |= TERMINAL_BIT(t);
+      any = 1;
+    }
+    if (!any)
+      continue;
+    int tail = 0;
+    for (int i = 0; i < rule->rhsCount; i++)
+      emitSymbol(out, T, rule, i, A, &tail);
+    if (!tail)
+      fprintf(out, "    return;\n");
+  }
+
+  fprintf(out,
+          "  default:\n"
+          "    if (rdRecover(ps, %d, 0x%llxULL, 0x%llxULL | anchor))\n"
+          "      goto dispatch;\n"
+          "    return;\n"
+          "  }\n"
+          "}\n\n",
+          (int)A, (unsigned long long)valid,
+          (unsigned long long)(T->firstMask[A] | T->followMask[A]));
+}
+
+static void emitEntry(FILE *out, const grammar *G) {
+  fprintf(out,
+          "parseTree *parseInputSourceCodeRD(char *testcaseFile) {\n"
+          "  FILE *fp = fopen(testcaseFile, \"r\");\n"
+          "  if (!fp) {\n"
+          "    fprintf(stderr, \"Error: Cannot open %%s\\n\", testcaseFile);\n"
+          "    return NULL;\n"
+          "  }\n"
+          "  parseTree *PT = (parseTree *)calloc(1, sizeof(parseTree));\n"
+          "  if (!PT) {\n"
+          "    fprintf(stderr, \"calloc failed for parseTree\\n\");\n"
+          "    exit(1);\n"
+          "  }\n"
+          "\n"
+          "  parserState ps;\n"
+          "  initParserState(&ps, PT, NULL);\n"
+          "  ps.tb = initializeTwinBuffer(fp);\n"
+          "  nextMeaningfulToken(&ps);\n"
+          "  %s(&ps, PT_NONE, TERMINAL_BIT(TK_EOF), TERMINAL_BIT(TK_EOF));\n"
+          "  if (ps.curType != TK_EOF && ps.curLine != ps.lastErrorLine)\n"
+          "    reportError(&ps, ps.curLine,\n"
+          "                \"Unexpected token %%s encountered at end\",\n"
+          "                getTokenName(ps.curType));\n"
+          "  freeTwinBuffer(ps.tb);\n"
+          "  computeSubtreeEnds(PT);\n"
+          "\n"
+          "  if (ps.syntaxOK && ps.errorCount == 0)\n"
+          "    printf(\"Input source code is syntactically "
+          "correct...........\\n\");\n"
+          "  return PT;\n"
+          "}\n",
+          functionName(G->startSymbol));
+}
+
+int main(int argc, char *argv[]) {
+  const char *bnf = NULL;
+  if (argc == 4 && strcmp(argv[1], "--grammar") == 0) {
+    bnf = argv[2];
+    argv += 2;
+    argc -= 2;
+  }
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s [--grammar grammar.bnf] <out.c>\n", argv[0]);
+    return 2;
+  }
+
+  FirstAndFollow F;
+  table T;
+  grammar *G;
+  if (bnf) {
+    G = loadGrammar(bnf, NULL, &F, &T, NULL);
+    if (!G)
+      return 1;
+  } else {
+    G = initializeGrammar();
+    F = computeFirstAndFollowSets(G);
+    createParseTable(&F, &T, G);
+  }
+
+  FILE *out = fopen(argv[1], "w");
+  if (!out) {
+    fprintf(stderr, "Error: Cannot open output file %s\n", argv[1]);
+    free(G);
+    return 1;
+  }
+
+  emitPrologue(out);
+  int used[NT_COUNT] = {0};
+  for (int r = 0; r < G->ruleCount; r++)
+    used[G->rules[r].lhs] = 1;
+  for (int nt = 0; nt < (int)NT_COUNT; nt++)
+    if (used[nt])
+      fprintf(out,
+              "static void %s(parserState *ps, uint32_t parent, uint64_t "
+              "anchor,\n                uint64_t pending);\n",
+              functionName((NonTerminal)nt));
+  fprintf(out, "\n");
+  for (int nt = 0; nt < (int)NT_COUNT; nt++)
+    if (used[nt])
+      emitNonTerminal(out, &T, G, (NonTerminal)nt);
+  emitEntry(out, G);
+
+  int rc = fclose(out) == 0 ? 0 : 1;
+  free(G);
+  return rc;
+}
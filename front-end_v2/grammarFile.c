@@ -0,0 +1,321 @@
+#define _POSIX_C_SOURCE 200809L
+#include "grammarFile.h"
+#include "util.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define GRAMMAR_ARROW "===>"
+#define GRAMMAR_EPSILON "eps"
+
+/* The cache stores NonTerminal and TokenType values, so it is only valid
+   for a build with the same enums: hash every name in enum order. */
+static uint64_t buildFingerprint(void) {
+  uint64_t h = FNV1A_BASIS;
+  for (int nt = 0; nt < (int)NT_COUNT; nt++) {
+    const char *name = getNonTerminalName((NonTerminal)nt);
+    h = fnv1a(name, strlen(name) + 1, h);
+  }
+  for (int t = 0; t <= TK_EPSILON; t++) {
+    const char *name = getTokenName((TokenType)t);
+    h = fnv1a(name, strlen(name) + 1, h);
+  }
+  return h;
+}
+
+static int isEpsilon(GrammarSymbol sym) {
+  return sym.type == SYMBOL_TERMINAL && sym.symbol.terminal == TK_EPSILON;
+}
+
+static int lookupSymbol(const char *name, GrammarSymbol *sym) {
+  if (strcmp(name, GRAMMAR_EPSILON) == 0) {
+    sym->type = SYMBOL_TERMINAL;
+    sym->symbol.terminal = TK_EPSILON;
+    return 1;
+  }
+  if (name[0] == '<') {
+    for (int nt = 0; nt < (int)NT_COUNT; nt++)
+      if (strcmp(name, getNonTerminalName((NonTerminal)nt)) == 0) {
+        sym->type = SYMBOL_NON_TERMINAL;
+        sym->symbol.nonTerminal = (NonTerminal)nt;
+        return 1;
+      }
+    return 0;
+  }
+  for (int t = 0; t < TK_EPSILON; t++)
+    if (strcmp(name, getTokenName((TokenType)t)) == 0) {
+      sym->type = SYMBOL_TERMINAL;
+      sym->symbol.terminal = (TokenType)t;
+      return 1;
+    }
+  return 0;
+}
+
+static int grammarError(const char *path, int line, const char *what,
+                        const char *name) {
+  fprintf(stderr, "Error: %s:%d: %s%s%s\n", path, line, what,
+          name ? " " : "", name ? name : "");
+  return 0;
+}
+
+/* Parses one line into G; `lhs` carries the current left-hand side across
+   continuation lines that start with '|'. */
+static int parseGrammarLine(const char *path, int lineNo, char *line,
+                            grammar *G, int *lhs) {
+  char *save = NULL;
+  char *tok = strtok_r(line, " \t\r", &save);
+  if (!tok || tok[0] == '#')
+    return 1;
+
+  GrammarSymbol sym;
+  if (strcmp(tok, "|") != 0) {
+    if (tok[0] != '<' || !lookupSymbol(tok, &sym))
+      return grammarError(path, lineNo, "unknown nonterminal", tok);
+    tok = strtok_r(NULL, " \t\r", &save);
+    if (!tok || strcmp(tok, GRAMMAR_ARROW) != 0)
+      return grammarError(path, lineNo, "expected " GRAMMAR_ARROW, NULL);
+    *lhs = (int)sym.symbol.nonTerminal;
+  } else if (*lhs < 0) {
+    return grammarError(path, lineNo, "'|' without a rule to continue", NULL);
+  }
+
+  int open = 0;
+  for (;;) {
+    if (!open) {
+      if (G->ruleCount >= MAX_RULES)
+        return grammarError(path, lineNo, "too many rules", NULL);
+      GrammarRule *r = &G->rules[G->ruleCount];
+      r->lhs = (NonTerminal)*lhs;
+      r->rhsCount = 0;
+      r->ruleNumber = G->ruleCount + 1;
+      open = 1;
+    }
+    tok = strtok_r(NULL, " \t\r", &save);
+    GrammarRule *r = &G->rules[G->ruleCount];
+    if (!tok || tok[0] == '#' || strcmp(tok, "|") == 0) {
+      if (r->rhsCount == 0)
+        return grammarError(path, lineNo, "empty alternative (use eps)",
+                            NULL);
+      G->ruleCount++;
+      open = 0;
+      if (!tok || tok[0] == '#')
+        return 1;
+      continue;
+    }
+    if (!lookupSymbol(tok, &sym))
+      return grammarError(path, lineNo, "unknown symbol", tok);
+    if (r->rhsCount >= MAX_RHS)
+      return grammarError(path, lineNo, "too many symbols in rule", NULL);
+    if (r->rhsCount > 0 && (isEpsilon(sym) || isEpsilon(r->rhs[0])))
+      return grammarError(path, lineNo, "eps must be an alternative on its own",
+                          NULL);
+    r->rhs[r->rhsCount++] = sym;
+  }
+}
+
+static grammar *parseGrammarText(const char *path, char *text) {
+  grammar *G = (grammar *)malloc(sizeof(grammar));
+  if (!G) {
+    fprintf(stderr, "malloc failed for grammar\n");
+    exit(1);
+  }
+  G->ruleCount = 0;
+  int lhs = -1, lineNo = 0;
+  for (char *line = text; line; ) {
+    char *next = strchr(line, '\n');
+    if (next)
+      *next++ = '\0';
+    lineNo++;
+    if (!parseGrammarLine(path, lineNo, line, G, &lhs)) {
+      free(G);
+      return NULL;
+    }
+    line = next;
+  }
+  if (G->ruleCount == 0) {
+    grammarError(path, lineNo, "no rules", NULL);
+    free(G);
+    return NULL;
+  }
+  G->startSymbol = G->rules[0].lhs;
+  return G;
+}
+
+grammar *readGrammarFile(const char *path) {
+  size_t size;
+  char *text = readWholeFile(path, &size);
+  if (!text) {
+    fprintf(stderr, "Error: Cannot open grammar file %s\n", path);
+    return NULL;
+  }
+  grammar *G = parseGrammarText(path, text);
+  free(text);
+  return G;
+}
+
+static void printSymbol(FILE *fp, const GrammarSymbol *sym) {
+  if (sym->type == SYMBOL_NON_TERMINAL)
+    fprintf(fp, " %s", getNonTerminalName(sym->symbol.nonTerminal));
+  else if (sym->symbol.terminal == TK_EPSILON)
+    fprintf(fp, " %s", GRAMMAR_EPSILON);
+  else
+    fprintf(fp, " %s", getTokenName(sym->symbol.terminal));
+}
+
+int writeGrammarFile(const grammar *G, const char *path) {
+  FILE *fp = fopen(path, "w");
+  if (!fp) {
+    fprintf(stderr, "Error: Cannot open output file %s\n", path);
+    return -1;
+  }
+  for (int i = 0; i < G->ruleCount; i++) {
+    const GrammarRule *r = &G->rules[i];
+    if (i > 0 && G->rules[i - 1].lhs == r->lhs) {
+      int pad = (int)strlen(getNonTerminalName(r->lhs)) + 1;
+      fprintf(fp, "%*s|", pad + (int)strlen(GRAMMAR_ARROW) - 1, "");
+    } else {
+      fprintf(fp, "%s%s %s", i > 0 ? "\n" : "", getNonTerminalName(r->lhs),
+              GRAMMAR_ARROW);
+    }
+    for (int j = 0; j < r->rhsCount; j++)
+      printSymbol(fp, &r->rhs[j]);
+    fputc('\n', fp);
+  }
+  return fclose(fp) == 0 ? 0 : -1;
+}
+
+static void fillCacheHeader(grammarCacheHeader *H, uint64_t hash) {
+  memset(H, 0, sizeof(*H));
+  memcpy(H->magic, GRAMMAR_CACHE_MAGIC, sizeof(H->magic));
+  H->version = GRAMMAR_CACHE_VERSION;
+  H->grammarSize = sizeof(grammar);
+  H->firstFollowSize = sizeof(FirstAndFollow);
+  H->tableSize = sizeof(table);
+  H->sourceHash = hash;
+  H->buildHash = buildFingerprint();
+}
+
+static grammar *readGrammarCache(const char *cachePath, uint64_t hash,
+                                 FirstAndFollow *F, table *T) {
+  FILE *fp = fopen(cachePath, "rb");
+  if (!fp)
+    return NULL;
+  grammarCacheHeader want, got;
+  fillCacheHeader(&want, hash);
+  grammar *G = (grammar *)malloc(sizeof(grammar));
+  if (!G) {
+    fprintf(stderr, "malloc failed for grammar\n");
+    exit(1);
+  }
+  int ok = fread(&got, sizeof(got), 1, fp) == 1 &&
+           memcmp(&got, &want, sizeof(got)) == 0 &&
+           fread(G, sizeof(grammar), 1, fp) == 1 &&
+           fread(F, sizeof(FirstAndFollow), 1, fp) == 1 &&
+           fread(T, sizeof(table), 1, fp) == 1 && fgetc(fp) == EOF &&
+           G->ruleCount > 0 && G->ruleCount <= MAX_RULES;
+  fclose(fp);
+
+  for (int i = 0; ok && i < MAX_NT; i++)
+    for (int j = 0; j < TABLE_TERMINALS; j++) {
+      ParseTableEntry *e = &T->entries[i][j];
+      if (!e->isValid) {
+        e->rule = NULL;
+      } else if (e->ruleNumber >= 1 && e->ruleNumber <= G->ruleCount) {
+        e->rule = &G->rules[e->ruleNumber - 1];
+      } else {
+        ok = 0;
+        break;
+      }
+    }
+  if (!ok) {
+    free(G);
+    return NULL;
+  }
+  return G;
+}
+
+static void writeGrammarCache(const char *cachePath, uint64_t hash,
+                              const grammar *G, const FirstAndFollow *F,
+                              const table *T) {
+  table *stored = (table *)malloc(sizeof(table));
+  if (!stored) {
+    fprintf(stderr, "malloc failed for grammar cache\n");
+    exit(1);
+  }
+  memcpy(stored, T, sizeof(table));
+  for (int i = 0; i < MAX_NT; i++)
+    for (int j = 0; j < TABLE_TERMINALS; j++)
+      stored->entries[i][j].rule = NULL;
+
+  grammarCacheHeader H;
+  fillCacheHeader(&H, hash);
+
+  /* Write to a name of this process's own and rename, so concurrent cold
+     starts never share a temporary file and a reader sees either the old
+     cache or a complete new one. */
+  static atomic_uint tempCounter;
+  size_t len = strlen(cachePath) + 48;
+  char *tmp = (char *)malloc(len);
+  if (!tmp) {
+    fprintf(stderr, "malloc failed for grammar cache\n");
+    exit(1);
+  }
+  snprintf(tmp, len, "%s.tmp.%ld.%u", cachePath, (long)getpid(),
+           atomic_fetch_add(&tempCounter, 1));
+
+  FILE *fp = fopen(tmp, "wb");
+  int ok = fp && fwrite(&H, sizeof(H), 1, fp) == 1 &&
+           fwrite(G, sizeof(grammar), 1, fp) == 1 &&
+           fwrite(F, sizeof(FirstAndFollow), 1, fp) == 1 &&
+           fwrite(stored, sizeof(table), 1, fp) == 1;
+  if (fp && fclose(fp) != 0)
+    ok = 0;
+  if (!ok || rename(tmp, cachePath) != 0) {
+    fprintf(stderr, "Warning: could not write grammar cache %s\n", cachePath);
+    remove(tmp);
+  }
+  free(tmp);
+  free(stored);
+}
+
+grammar *loadGrammar(const char *path, const char *cachePath,
+                     FirstAndFollow *F, table *T, int *cacheHit) {
+  size_t size;
+  char *text = readWholeFile(path, &size);
+  if (!text) {
+    fprintf(stderr, "Error: Cannot open grammar file %s\n", path);
+    return NULL;
+  }
+  uint64_t hash = fnv1a(text, size, FNV1A_BASIS);
+
+  char *defaultCache = NULL;
+  if (!cachePath) {
+    size_t len = strlen(path);
+    defaultCache = (char *)malloc(len + 7);
+    if (!defaultCache) {
+      fprintf(stderr, "malloc failed for grammar cache path\n");
+      exit(1);
+    }
+    memcpy(defaultCache, path, len);
+    memcpy(defaultCache + len, ".cache", 7);
+    cachePath = defaultCache;
+  }
+
+  grammar *G = readGrammarCache(cachePath, hash, F, T);
+  if (cacheHit)
+    *cacheHit = G != NULL;
+  if (!G) {
+    G = parseGrammarText(path, text);
+    if (G) {
+      *F = computeFirstAndFollowSets(G);
+      createParseTable(F, T, G);
+      writeGrammarCache(cachePath, hash, G, F, T);
+    }
+  }
+
+  free(defaultCache);
+  free(text);
+  return G;
+}
@@ -0,0 +1,24 @@
+#ifndef GRAMMARFILE_H
+#define GRAMMARFILE_H
+#include "grammarFileDef.h"
+#include "parser.h"
+
+/* Parses a BNF grammar file, e.g.
+     <otherFunctions> ===> <function> <otherFunctions> | eps
+   Symbols are the names printed by getNonTerminalName / getTokenName; the
+   first rule's left-hand side is the start symbol. Returns NULL after
+   printing the offending line on error. */
+grammar *readGrammarFile(const char *path);
+
+/* Writes G in the format readGrammarFile accepts. Returns 0 on success. */
+int writeGrammarFile(const grammar *G, const char *path);
+
+/* Loads a grammar file through its compiled cache (cachePath, or
+   path + ".cache" when NULL). On a hash match the grammar, FIRST/FOLLOW
+   sets and parse table are read back without recomputation; otherwise they
+   are built and the cache is rewritten. *cacheHit reports which happened
+   and may be NULL. */
+grammar *loadGrammar(const char *path, const char *cachePath,
+                     FirstAndFollow *F, table *T, int *cacheHit);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef GRAMMARFILEDEF_H
+#define GRAMMARFILEDEF_H
+#include "parserDef.h"
+
+#define GRAMMAR_CACHE_MAGIC "LL1CACHE"
+#define GRAMMAR_CACHE_VERSION 3
+
+/* Compiled grammar cache: this header, then the grammar, FirstAndFollow
+   and table structs as laid out in memory (table rule pointers are stored
+   as NULL and rebuilt from ruleNumber). The cache is only used when the
+   hash of the grammar text, the hash of the build's NonTerminal/TokenType
+   names and all three struct sizes match. */
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t grammarSize;
+  uint32_t firstFollowSize;
+  uint32_t tableSize;
+  uint64_t sourceHash;
+  uint64_t buildHash;
+} grammarCacheHeader;
+
+#endif
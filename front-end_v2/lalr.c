@@ -0,0 +1,535 @@
+#include "lalr.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Productions are those of G shifted up by one, after production 0, the
+   augmented S' -> start. Symbols use the packed byte encoding (terminals
+   as TokenType, nonterminal A as CT_NT_BASE + A). An LR(0) item is
+   production * 16 + dot. */
+#define ITEM(p, d) ((uint32_t)(p) * 16 + (uint32_t)(d))
+#define ITEM_PROD(i) ((i) >> 4)
+#define ITEM_DOT(i) ((i) & 15)
+#define SYMBOLS (CT_NT_BASE + NT_COUNT)
+#define AUGMENTED NT_COUNT
+/* The '#' lookahead of the propagation pass; no TokenType uses bit 63. */
+#define PROPAGATE TERMINAL_BIT(63)
+
+typedef struct {
+  int prodCount;
+  int lhs[MAX_RULES + 1];
+  uint8_t len[MAX_RULES + 1];
+  uint8_t rhs[MAX_RULES + 1][MAX_RHS];
+  int prodStart[NT_COUNT + 1]; /* productions of A, listed in byLhs */
+  int byLhs[MAX_RULES + 1];
+  uint64_t first[NT_COUNT];
+  uint8_t nullable[NT_COUNT];
+
+  uint32_t *kernel; /* kernel items of state s: [kernelStart[s], [s + 1]) */
+  uint32_t *kernelStart;
+  uint32_t kernelCount, kernelCapacity;
+  uint32_t stateCount, stateCapacity;
+  int16_t (*trans)[SYMBOLS];
+  uint32_t *slots; /* kernel hash -> state + 1 */
+  uint32_t slotCount;
+
+  /* closure scratch, indexed by item */
+  uint64_t *mask;
+  uint8_t *queued;
+  uint32_t *touched, touchedCount;
+  uint32_t *work;
+  uint32_t *items; /* copy of the kernel being closed */
+  uint64_t *itemLa;
+} lalrBuilder;
+
+static void *allocZeroed(size_t count, size_t size, const char *what) {
+  void *p = calloc(count ? count : 1, size);
+  if (!p) {
+    fprintf(stderr, "calloc failed for %s\n", what);
+    exit(1);
+  }
+  return p;
+}
+
+static void loadProductions(lalrBuilder *B, const grammar *G) {
+  B->prodCount = G->ruleCount + 1;
+  B->lhs[0] = AUGMENTED;
+  B->len[0] = 1;
+  B->rhs[0][0] = (uint8_t)(CT_NT_BASE + G->startSymbol);
+  for (int r = 0; r < G->ruleCount; r++) {
+    const GrammarRule *rule = &G->rules[r];
+    int n = 0;
+    for (int i = 0; i < rule->rhsCount; i++) {
+      GrammarSymbol s = rule->rhs[i];
+      if (s.type == SYMBOL_NON_TERMINAL)
+        B->rhs[r + 1][n++] = (uint8_t)(CT_NT_BASE + s.symbol.nonTerminal);
+      else if (s.symbol.terminal != TK_EPSILON)
+        B->rhs[r + 1][n++] = (uint8_t)s.symbol.terminal;
+    }
+    B->lhs[r + 1] = rule->lhs;
+    B->len[r + 1] = (uint8_t)n;
+  }
+
+  int count[NT_COUNT + 1] = {0};
+  for (int p = 1; p < B->prodCount; p++)
+    count[B->lhs[p]]++;
+  B->prodStart[0] = 0;
+  for (int A = 0; A < (int)NT_COUNT; A++)
+    B->prodStart[A + 1] = B->prodStart[A] + count[A];
+  int fill[NT_COUNT];
+  memcpy(fill, B->prodStart, sizeof(fill));
+  for (int p = 1; p < B->prodCount; p++)
+    B->byLhs[fill[B->lhs[p]]++] = p;
+
+  for (int changed = 1; changed;) {
+    changed = 0;
+    for (int p = 1; p < B->prodCount; p++) {
+      int A = B->lhs[p];
+      uint64_t f = 0;
+      int nullable = 1;
+      for (int i = 0; i < B->len[p] && nullable; i++) {
+        int s = B->rhs[p][i];
+        if (s < CT_NT_BASE) {
+          f |= TERMINAL_BIT(s);
+          nullable = 0;
+        } else {
+          f |= B->first[s - CT_NT_BASE];
+          nullable = B->nullable[s - CT_NT_BASE];
+        }
+      }
+      if ((B->first[A] | f) != B->first[A] || (nullable && !B->nullable[A])) {
+        B->first[A] |= f;
+        B->nullable[A] |= (uint8_t)nullable;
+        changed = 1;
+      }
+    }
+  }
+}
+
+/* FIRST of what follows the dot's symbol in item i, plus `inherited` if
+   all of it can derive epsilon. */
+static uint64_t firstAfter(const lalrBuilder *B, uint32_t i,
+                           uint64_t inherited) {
+  int p = (int)ITEM_PROD(i);
+  uint64_t f = 0;
+  for (int k = (int)ITEM_DOT(i) + 1; k < B->len[p]; k++) {
+    int s = B->rhs[p][k];
+    if (s < CT_NT_BASE)
+      return f | TERMINAL_BIT(s);
+    f |= B->first[s - CT_NT_BASE];
+    if (!B->nullable[s - CT_NT_BASE])
+      return f;
+  }
+  return f | inherited;
+}
+
+static void addToClosure(lalrBuilder *B, uint32_t item, uint64_t la,
+                         uint32_t *top) {
+  if ((B->mask[item] | la) == B->mask[item])
+    return;
+  if (!B->mask[item])
+    B->touched[B->touchedCount++] = item;
+  B->mask[item] |= la;
+  if (!B->queued[item]) {
+    B->queued[item] = 1;
+    B->work[(*top)++] = item;
+  }
+}
+
+/* LR(1) closure of items[0..n) with lookaheads la[0..n) into B->mask; the
+   items reached are B->touched. An LR(0) closure passes any nonzero la. */
+static void closure(lalrBuilder *B, const uint32_t *items, const uint64_t *la,
+                    uint32_t n) {
+  for (uint32_t k = 0; k < B->touchedCount; k++)
+    B->mask[B->touched[k]] = 0;
+  B->touchedCount = 0;
+  uint32_t top = 0;
+  for (uint32_t k = 0; k < n; k++)
+    addToClosure(B, items[k], la[k], &top);
+
+  while (top > 0) {
+    uint32_t i = B->work[--top];
+    B->queued[i] = 0;
+    int p = (int)ITEM_PROD(i), d = (int)ITEM_DOT(i);
+    if (d == B->len[p] || B->rhs[p][d] < CT_NT_BASE)
+      continue;
+    int A = B->rhs[p][d] - CT_NT_BASE;
+    uint64_t la = firstAfter(B, i, B->mask[i]);
+    for (int k = B->prodStart[A]; k < B->prodStart[A + 1]; k++)
+      addToClosure(B, ITEM(B->byLhs[k], 0), la, &top);
+  }
+}
+
+static uint64_t hashKernel(const uint32_t *items, uint32_t n) {
+  return fnv1a(items, n * sizeof(uint32_t), FNV1A_BASIS);
+}
+
+static void rehashStates(lalrBuilder *B, uint32_t slotCount) {
+  free(B->slots);
+  B->slots = (uint32_t *)allocZeroed(slotCount, sizeof(uint32_t), "LALR states");
+  B->slotCount = slotCount;
+  for (uint32_t s = 0; s < B->stateCount; s++) {
+    uint32_t n = B->kernelStart[s + 1] - B->kernelStart[s];
+    uint64_t h = hashKernel(B->kernel + B->kernelStart[s], n);
+    uint32_t slot = (uint32_t)(h & (slotCount - 1));
+    while (B->slots[slot])
+      slot = (slot + 1) & (slotCount - 1);
+    B->slots[slot] = s + 1;
+  }
+}
+
+/* State with the given sorted kernel, created if new. */
+static uint32_t internState(lalrBuilder *B, const uint32_t *items, uint32_t n) {
+  uint64_t h = hashKernel(items, n);
+  uint32_t slot = (uint32_t)(h & (B->slotCount - 1));
+  for (; B->slots[slot]; slot = (slot + 1) & (B->slotCount - 1)) {
+    uint32_t s = B->slots[slot] - 1;
+    uint32_t m = B->kernelStart[s + 1] - B->kernelStart[s];
+    if (m == n && memcmp(B->kernel + B->kernelStart[s], items,
+                         n * sizeof(uint32_t)) == 0)
+      return s;
+  }
+
+  uint32_t s = B->stateCount++;
+  B->kernelStart = growArray(B->kernelStart, &B->stateCapacity,
+                             B->stateCount + 1, sizeof(uint32_t),
+                             "LALR states");
+  B->kernel = growArray(B->kernel, &B->kernelCapacity, B->kernelCount + n,
+                        sizeof(uint32_t), "LALR kernels");
+  memcpy(B->kernel + B->kernelCount, items, n * sizeof(uint32_t));
+  B->kernelStart[s] = B->kernelCount;
+  B->kernelCount += n;
+  B->kernelStart[s + 1] = B->kernelCount;
+  B->slots[slot] = s + 1;
+  if (2 * (B->stateCount + 1) > B->slotCount)
+    rehashStates(B, B->slotCount * 2);
+  return s;
+}
+
+static void buildStates(lalrBuilder *B) {
+  uint32_t itemCount = (uint32_t)B->prodCount * 16;
+  uint32_t *next = (uint32_t *)allocZeroed(itemCount, sizeof(uint32_t),
+                                           "LALR goto items");
+  uint32_t count[SYMBOLS], at[SYMBOLS];
+  uint32_t trans = 0;
+  uint32_t start = ITEM(0, 0);
+  uint64_t mark = PROPAGATE;
+  internState(B, &start, 1);
+
+  for (uint32_t s = 0; s < B->stateCount; s++) {
+    B->trans = growArray(B->trans, &trans, s + 1, sizeof(*B->trans),
+                         "LALR transitions");
+    memset(B->trans[s], -1, sizeof(B->trans[s]));
+
+    uint32_t n = B->kernelStart[s + 1] - B->kernelStart[s];
+    for (uint32_t k = 0; k < n; k++)
+      B->itemLa[k] = mark;
+    memcpy(B->items, B->kernel + B->kernelStart[s], n * sizeof(uint32_t));
+    closure(B, B->items, B->itemLa, n);
+
+    /* Bucket the advanced items by the symbol they move over. */
+    memset(count, 0, sizeof(count));
+    for (uint32_t k = 0; k < B->touchedCount; k++) {
+      uint32_t i = B->touched[k];
+      int p = (int)ITEM_PROD(i), d = (int)ITEM_DOT(i);
+      if (d < B->len[p])
+        count[B->rhs[p][d]]++;
+    }
+    uint32_t sum = 0;
+    for (int X = 0; X < SYMBOLS; X++) {
+      at[X] = sum;
+      sum += count[X];
+    }
+    for (uint32_t k = 0; k < B->touchedCount; k++) {
+      uint32_t i = B->touched[k];
+      int p = (int)ITEM_PROD(i), d = (int)ITEM_DOT(i);
+      if (d < B->len[p])
+        next[at[B->rhs[p][d]]++] = i + 1;
+    }
+    for (int X = 0, from = 0; X < SYMBOLS; X++) {
+      uint32_t *items = next + from;
+      uint32_t m = count[X];
+      from += (int)m;
+      if (!m)
+        continue;
+      for (uint32_t a = 1; a < m; a++)
+        for (uint32_t b = a; b > 0 && items[b - 1] > items[b]; b--) {
+          uint32_t t = items[b];
+          items[b] = items[b - 1];
+          items[b - 1] = t;
+        }
+      B->trans[s][X] = (int16_t)internState(B, items, m);
+    }
+  }
+  free(next);
+}
+
+static uint32_t kernelIndex(const lalrBuilder *B, uint32_t s, uint32_t item) {
+  uint32_t lo = B->kernelStart[s], hi = B->kernelStart[s + 1];
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (B->kernel[mid] < item)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* Lookaheads of every kernel item: those generated spontaneously by the
+   closure of each kernel item, then spread along propagation links until
+   nothing changes. */
+static uint64_t *computeLookaheads(lalrBuilder *B) {
+  uint64_t *la = (uint64_t *)allocZeroed(B->kernelCount, sizeof(uint64_t),
+                                         "LALR lookaheads");
+  uint32_t *from = NULL, *to = NULL, links = 0, fromCap = 0, toCap = 0;
+  la[kernelIndex(B, 0, ITEM(0, 0))] = TERMINAL_BIT(TK_EOF);
+
+  uint64_t mark = PROPAGATE;
+  for (uint32_t s = 0; s < B->stateCount; s++) {
+    for (uint32_t k = B->kernelStart[s]; k < B->kernelStart[s + 1]; k++) {
+      uint32_t item = B->kernel[k];
+      closure(B, &item, &mark, 1);
+      for (uint32_t t = 0; t < B->touchedCount; t++) {
+        uint32_t i = B->touched[t];
+        int p = (int)ITEM_PROD(i), d = (int)ITEM_DOT(i);
+        if (d == B->len[p])
+          continue;
+        uint32_t target = kernelIndex(B, (uint32_t)B->trans[s][B->rhs[p][d]],
+                                      i + 1);
+        la[target] |= B->mask[i] & ~PROPAGATE;
+        if (B->mask[i] & PROPAGATE) {
+          from = growArray(from, &fromCap, links + 1, sizeof(uint32_t),
+                           "LALR links");
+          to = growArray(to, &toCap, links + 1, sizeof(uint32_t),
+                         "LALR links");
+          from[links] = k;
+          to[links++] = target;
+        }
+      }
+    }
+  }
+
+  for (int changed = 1; changed;) {
+    changed = 0;
+    for (uint32_t l = 0; l < links; l++)
+      if ((la[to[l]] | la[from[l]]) != la[to[l]]) {
+        la[to[l]] |= la[from[l]];
+        changed = 1;
+      }
+  }
+  free(from);
+  free(to);
+  return la;
+}
+
+static void setReduce(lalrTable *LT, uint32_t s, int t, int rule) {
+  int16_t *cell = &LT->action[s][t];
+  if (*cell == 0) {
+    *cell = (int16_t)(-rule - 1);
+  } else if (*cell > 0 || *cell == LALR_ACCEPT) {
+    LT->srConflicts++;
+  } else {
+    LT->rrConflicts++;
+    if (rule < -*cell - 1)
+      *cell = (int16_t)(-rule - 1);
+  }
+}
+
+static void fillTables(lalrBuilder *B, lalrTable *LT, const uint64_t *la) {
+  for (uint32_t s = 0; s < B->stateCount; s++) {
+    uint32_t n = B->kernelStart[s + 1] - B->kernelStart[s];
+    closure(B, B->kernel + B->kernelStart[s], la + B->kernelStart[s], n);
+
+    for (int t = 0; t < LALR_TERMINALS; t++)
+      if (B->trans[s][t] >= 0)
+        LT->action[s][t] = (int16_t)(B->trans[s][t] + 1);
+    for (int A = 0; A < (int)NT_COUNT; A++)
+      LT->go[s][A] = B->trans[s][CT_NT_BASE + A];
+
+    for (uint32_t k = 0; k < B->touchedCount; k++) {
+      uint32_t i = B->touched[k];
+      int p = (int)ITEM_PROD(i);
+      if ((int)ITEM_DOT(i) != B->len[p])
+        continue;
+      if (p == 0) {
+        LT->action[s][TK_EOF] = LALR_ACCEPT;
+        continue;
+      }
+      uint64_t m = B->mask[i];
+      for (int t = 0; t < LALR_TERMINALS; t++)
+        if (m & TERMINAL_BIT(t))
+          setReduce(LT, s, t, p - 1);
+    }
+  }
+}
+
+lalrTable *createLalrTable(const grammar *G) {
+  lalrBuilder *B = (lalrBuilder *)allocZeroed(1, sizeof(lalrBuilder),
+                                              "LALR builder");
+  loadProductions(B, G);
+  uint32_t itemCount = (uint32_t)B->prodCount * 16;
+  B->mask = (uint64_t *)allocZeroed(itemCount, sizeof(uint64_t), "LALR items");
+  B->queued = (uint8_t *)allocZeroed(itemCount, 1, "LALR items");
+  B->touched = (uint32_t *)allocZeroed(itemCount, sizeof(uint32_t),
+                                       "LALR items");
+  B->work = (uint32_t *)allocZeroed(itemCount, sizeof(uint32_t), "LALR items");
+  B->items = (uint32_t *)allocZeroed(itemCount, sizeof(uint32_t), "LALR items");
+  B->itemLa = (uint64_t *)allocZeroed(itemCount, sizeof(uint64_t), "LALR items");
+  B->slotCount = 256;
+  B->slots = (uint32_t *)allocZeroed(B->slotCount, sizeof(uint32_t),
+                                     "LALR states");
+
+  buildStates(B);
+  if (B->stateCount >= INT16_MAX) {
+    fprintf(stderr, "Error: %u LALR states do not fit the 16-bit tables\n",
+            B->stateCount);
+    exit(1);
+  }
+  uint64_t *la = computeLookaheads(B);
+
+  lalrTable *LT = (lalrTable *)allocZeroed(1, sizeof(lalrTable), "lalrTable");
+  LT->G = G;
+  LT->stateCount = B->stateCount;
+  LT->kernelItems = B->kernelCount;
+  LT->action = allocZeroed(B->stateCount, sizeof(*LT->action), "LALR ACTION");
+  LT->go = allocZeroed(B->stateCount, sizeof(*LT->go), "LALR GOTO");
+  for (int r = 0; r < G->ruleCount; r++) {
+    LT->length[r] = B->len[r + 1];
+    LT->lhs[r] = (uint8_t)B->lhs[r + 1];
+  }
+  fillTables(B, LT, la);
+
+  free(la);
+  free(B->kernel);
+  free(B->kernelStart);
+  free(B->trans);
+  free(B->slots);
+  free(B->mask);
+  free(B->queued);
+  free(B->touched);
+  free(B->work);
+  free(B->items);
+  free(B->itemLa);
+  free(B);
+  return LT;
+}
+
+size_t lalrTableBytes(const lalrTable *LT) {
+  return (size_t)LT->stateCount * (sizeof(*LT->action) + sizeof(*LT->go));
+}
+
+/* "TK_A, TK_B, ..." for the terminals state s has an action on. */
+static void expectedTokens(const lalrTable *LT, uint32_t s, char *out,
+                           size_t size) {
+  size_t used = 0;
+  int listed = 0;
+  out[0] = '\0';
+  for (int t = 0; t < LALR_TERMINALS && used < size; t++) {
+    if (!LT->action[s][t])
+      continue;
+    if (listed == 4) {
+      snprintf(out + used, size - used, ", ...");
+      return;
+    }
+    used += (size_t)snprintf(out + used, size - used, "%s%s",
+                             listed ? ", " : "", getTokenName((TokenType)t));
+    listed++;
+  }
+}
+
+int parseInputSourceCodeLALR(char *testcaseFile, const lalrTable *LT,
+                             parseListener *listener, parseDiagnostics *D) {
+  FILE *fp = fopen(testcaseFile, "r");
+  if (!fp) {
+    fprintf(stderr, "Error: Cannot open %s\n", testcaseFile);
+    return -1;
+  }
+  parserState ps;
+  initParserState(&ps, NULL, listener);
+  ps.diag = D;
+  ps.tb = initializeTwinBuffer(fp);
+
+  uint32_t cap = 0, sp = 0;
+  uint16_t *stack = growArray(NULL, &cap, 2, sizeof(uint16_t), "LALR stack");
+  stack[sp++] = 0;
+
+  int accepted = 0;
+  int progress = 1; /* a token was shifted since the last error */
+  nextMeaningfulToken(&ps);
+
+  for (;;) {
+    uint32_t s = stack[sp - 1];
+    int act = LT->action[s][ps.curType];
+
+    if (act > 0) {
+      stack = growArray(stack, &cap, sp + 1, sizeof(uint16_t), "LALR stack");
+      stack[sp++] = (uint16_t)(act - 1);
+      if (listener && listener->matchTerminal)
+        listener->matchTerminal(listener->ctx, ps.curType, &ps.lexed);
+      nextMeaningfulToken(&ps);
+      progress = 1;
+      continue;
+    }
+    if (act == LALR_ACCEPT) {
+      accepted = 1;
+      break;
+    }
+    if (act < 0) {
+      int r = -act - 1;
+      sp -= LT->length[r];
+      int g = LT->go[stack[sp - 1]][LT->lhs[r]];
+      if (g < 0)
+        break;
+      stack = growArray(stack, &cap, sp + 1, sizeof(uint16_t), "LALR stack");
+      stack[sp++] = (uint16_t)g;
+      if (listener && listener->exitNonTerminal)
+        listener->exitNonTerminal(listener->ctx, (NonTerminal)LT->lhs[r],
+                                  &LT->G->rules[r]);
+      continue;
+    }
+
+    if (ps.curLine != ps.lastErrorLine) {
+      char expected[256];
+      expectedTokens(LT, s, expected, sizeof(expected));
+      reportError(&ps, ps.curLine,
+                  "Invalid token %s encountered with value %s, expected %s",
+                  getTokenName(ps.curType), ps.curLexeme, expected);
+      ps.lastErrorLine = ps.curLine;
+    }
+    ps.syntaxOK = 0;
+    /* Failing again before any shift: the lookahead itself is the
+       problem, so drop it before resynchronizing. */
+    if (!progress) {
+      if (ps.curType == TK_EOF)
+        break;
+      nextMeaningfulToken(&ps);
+    }
+    progress = 0;
+    uint32_t k = sp;
+    for (;;) {
+      while (k > 0 && !LT->action[stack[k - 1]][ps.curType])
+        k--;
+      if (k > 0 || ps.curType == TK_EOF)
+        break;
+      nextMeaningfulToken(&ps);
+      k = sp;
+    }
+    if (k == 0)
+      break;
+    sp = k;
+  }
+
+  free(stack);
+  freeTwinBuffer(ps.tb);
+  return accepted && ps.syntaxOK && ps.errorCount == 0;
+}
+
+void freeLalrTable(lalrTable *LT) {
+  if (!LT)
+    return;
+  free(LT->action);
+  free(LT->go);
+  free(LT);
+}
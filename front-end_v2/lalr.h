@@ -0,0 +1,29 @@
+#ifndef LALR_H
+#define LALR_H
+#include "lalrDef.h"
+#include "parser.h"
+
+/* Builds LALR(1) ACTION/GOTO tables for G (LR(0) item sets with
+   lookaheads spread by the spontaneous/propagated method). G must outlive
+   the table. */
+lalrTable *createLalrTable(const grammar *G);
+
+/* Bytes held by the ACTION and GOTO tables. */
+size_t lalrTableBytes(const lalrTable *LT);
+
+/* Bottom-up parse of testcaseFile without a tree. Each shift calls
+   listener->matchTerminal and each reduction listener->exitNonTerminal with
+   the rule, so on error-free input a builder sees every subtree exactly
+   once, children first; enterNonTerminal is never called. Errors go to D,
+   listener->error or stderr as in the LL(1) parser, at most one per line;
+   recovery pops to the nearest state that accepts the lookahead, or drops
+   tokens until one does. Popped states and dropped tokens get no event, so
+   after an error a builder's values no longer line up with the stack.
+   Returns 1 if the input is correct, 0 on errors, -1 if the file cannot be
+   opened. */
+int parseInputSourceCodeLALR(char *testcaseFile, const lalrTable *LT,
+                             parseListener *listener, parseDiagnostics *D);
+
+void freeLalrTable(lalrTable *LT);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef LALRDEF_H
+#define LALRDEF_H
+#include "parserDef.h"
+
+/* Terminal columns: every TokenType is below 64 (see TERMINAL_BIT). */
+#define LALR_TERMINALS 64
+
+/* ACTION entries: 0 is an error, v > 0 shifts to state v - 1, v < 0
+   reduces by G->rules[-v - 1], LALR_ACCEPT accepts. */
+#define LALR_ACCEPT INT16_MIN
+
+typedef struct {
+  const grammar *G;
+  uint32_t stateCount;
+  int16_t (*action)[LALR_TERMINALS];
+  int16_t (*go)[NT_COUNT]; /* -1 where there is no transition */
+  uint8_t length[MAX_RULES]; /* RHS length without epsilons, by rule index */
+  uint8_t lhs[MAX_RULES];
+  uint32_t kernelItems;
+  uint32_t srConflicts; /* resolved as shift */
+  uint32_t rrConflicts; /* resolved for the earlier rule */
+} lalrTable;
+
+#endif
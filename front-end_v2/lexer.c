@@ -1,4 +1,5 @@
-#include "lexerDef.h"
+#include "lexer.h"
+#include "util.h"
 
 static KeywordEntry keywordTable[] = {{"with", TK_WITH},
                                       {"parameters", TK_PARAMETERS},
@@ -29,12 +30,23 @@ static KeywordEntry keywordTable[] = {{"with", TK_WITH},
                                       {"else", TK_ELSE},
                                       {NULL, TK_ERROR}};
 
-static inline int isDIG(char c) { return c >= '0' && c <= '9'; }
-static inline int isD27(char c) { return c >= '2' && c <= '7'; }
-static inline int isLOW(char c) { return c >= 'a' && c <= 'z'; }
-static inline int isBD(char c) { return c == 'b' || c == 'c' || c == 'd'; }
-static inline int isLET(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
-static inline int isWS(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+/* A half is filled when forward enters it (half 1 also when a token in
+   half 0 runs up to it), so the text behind forward is still intact for
+   retract() and getLexeme(). */
+static void loadHalf(twinBuffer *tb, int half) {
+  char *base = tb->buffer + half * BUFFER_SIZE;
+  size_t n = fread(base, 1, BUFFER_SIZE, tb->fp);
+  if (n < BUFFER_SIZE)
+    base[n] = (char)EOF;
+  if (half == 0) {
+    tb->eof1 = n < BUFFER_SIZE;
+    tb->size1 = (int)n;
+  } else {
+    tb->eof2 = n < BUFFER_SIZE;
+    tb->size2 = (int)n;
+  }
+  tb->currentBuffer = half;
+}
 
 twinBuffer *initializeTwinBuffer(FILE *fp) {
   twinBuffer *tb = (twinBuffer *)malloc(sizeof(twinBuffer));
@@ -47,51 +59,51 @@ twinBuffer *initializeTwinBuffer(FILE *fp) {
   tb->lexemeBegin = 0;
   tb->eof1 = 0;
   tb->eof2 = 0;
+  tb->size1 = 0;
+  tb->size2 = 0;
   tb->lineNumber = 1;
+  tb->currentBuffer = 0;
+  tb->scratch = NULL;
+  tb->scratchCap = 0;
   memset(tb->buffer, 0, sizeof(tb->buffer));
-  size_t n = fread(tb->buffer, 1, BUFFER_SIZE, fp);
-  if (n < BUFFER_SIZE) {
-    tb->buffer[n] = (char)EOF;
-    tb->eof1 = 1;
-  }
-  n = fread(tb->buffer + BUFFER_SIZE, 1, BUFFER_SIZE, fp);
-  if (n < BUFFER_SIZE) {
-    tb->buffer[BUFFER_SIZE + n] = (char)EOF;
-    tb->eof2 = 1;
-  }
+  loadHalf(tb, 0);
   return tb;
 }
 
+/* The end of the text that follows forward without a wrap, and whether
+   the input ends there. Half 1 follows half 0 once it has been loaded. */
+static int contiguousEnd(const twinBuffer *tb, int *last) {
+  if (tb->forward < BUFFER_SIZE && tb->currentBuffer == 0) {
+    *last = tb->eof1;
+    return tb->size1;
+  }
+  *last = tb->eof2;
+  return BUFFER_SIZE + tb->size2;
+}
+
+static int atEOF(const twinBuffer *tb) {
+  int last;
+  int end = contiguousEnd(tb, &last);
+  return last && tb->forward == end;
+}
+
 char getNextChar(twinBuffer *tb) {
+  if (atEOF(tb))
+    return (char)EOF;
   char c = tb->buffer[tb->forward];
-  if ((unsigned char)c == (unsigned char)EOF) {
-    if ((tb->forward < BUFFER_SIZE && tb->eof1) ||
-        (tb->forward >= BUFFER_SIZE && tb->eof2))
-      return (char)EOF;
-  }
   tb->forward++;
-  if (tb->forward == BUFFER_SIZE && !tb->eof1) {
-    size_t n = fread(tb->buffer, 1, BUFFER_SIZE, tb->fp);
-    if (n < BUFFER_SIZE) {
-      tb->buffer[n] = (char)EOF;
-      tb->eof1 = 1;
-    }
+  if (tb->forward == BUFFER_SIZE && tb->currentBuffer == 0) {
+    loadHalf(tb, 1);
   }
   else if (tb->forward == TWIN_BUFFER_SIZE) {
-    if (!tb->eof2) {
-      size_t n = fread(tb->buffer + BUFFER_SIZE, 1, BUFFER_SIZE, tb->fp);
-      if (n < BUFFER_SIZE) {
-        tb->buffer[BUFFER_SIZE + n] = (char)EOF;
-        tb->eof2 = 1;
-      }
-    }
+    if (tb->currentBuffer == 1)
+      loadHalf(tb, 0);
     tb->forward = 0;
   }
   if (c == '\n')
     tb->lineNumber++;
   return c;
 }
-
 void retract(twinBuffer *tb, int n) {
   for (int i = 0; i < n; i++) {
     if (tb->forward > 0)
@@ -118,6 +130,7 @@ void freeTwinBuffer(twinBuffer *tb) {
   if (tb) {
     if (tb->fp)
       fclose(tb->fp);
+    free(tb->scratch);
     free(tb);
   }
 }
@@ -129,415 +142,120 @@ TokenType lookupKeyword(const char *lexeme) {
   return TK_FIELDID;
 }
 
-tokenInfo getNextToken(twinBuffer *tb) {
-  tokenInfo token;
-  memset(&token, 0, sizeof(token));
-  char c;
-  restart:
-  tb->lexemeBegin = tb->forward;
-  int startLine = tb->lineNumber;
-  c = getNextChar(tb);
-  if ((unsigned char)c == (unsigned char)EOF) {
-    token.tokenType = TK_EOF;
-    token.lineNumber = startLine;
-    strcpy(token.lexeme, "EOF");
-    return token;
-  }
-  if (isWS(c)) {
-    while (isWS(c))
-      c = getNextChar(tb);
-    if ((unsigned char)c != (unsigned char)EOF)
-      retract(tb, 1);
-    goto restart;
-  }
-  if (c == '%') {
-    while (c != '\n' && (unsigned char)c != (unsigned char)EOF)
-      c = getNextChar(tb);
-    if (c == '\n')
-      retract(tb, 1);
-    token.tokenType = TK_COMMENT;
-    token.lineNumber = startLine;
-    strcpy(token.lexeme, "%");
-    return token;
-  }
-  if (isDIG(c)) {
-    while (isDIG(c = getNextChar(tb)))
-      ;
-    if ((unsigned char)c == (unsigned char)EOF || !isDIG(c)) {
-      if (c == '.') {
-        char c2 = getNextChar(tb);
-        if (isDIG(c2)) {
-          char c3 = getNextChar(tb);
-          if (isDIG(c3)) {
-            char c4 = getNextChar(tb);
-            if (c4 == 'E') {
-              char c5 = getNextChar(tb);
-              int hasSign = (c5 == '+' || c5 == '-');
-              if (hasSign)
-                c5 = getNextChar(tb);
-              if (isDIG(c5)) {
-                char c6 = getNextChar(tb);
-                if (isDIG(c6)) {
-                  getLexeme(tb, token.lexeme);
-                  token.tokenType = TK_RNUM;
-                  token.value.realValue = atof(token.lexeme);
-                  token.hasValue = 1;
-                  token.lineNumber = startLine;
-                  return token;
-                } else {
-                  retract(tb, 1);
-                  getLexeme(tb, token.lexeme);
-                  token.tokenType = TK_ERROR;
-                  token.errorType = ERR_UNKNOWN_PATTERN;
-                  snprintf(token.errorMsg, sizeof(token.errorMsg),
-                           "Unknown pattern <%s>", token.lexeme);
-                  token.lineNumber = startLine;
-                  return token;
-                }
-              } else {
-                retract(tb, 1);
-                getLexeme(tb, token.lexeme);
-                token.tokenType = TK_ERROR;
-                token.value.realValue = atof(token.lexeme);
-                token.hasValue = 1;
-                token.lineNumber = startLine;
-                return token;
-              }
-            } else {
-              retract(tb, 1);
-              getLexeme(tb, token.lexeme);
-              token.tokenType = TK_RNUM;
-              token.value.realValue = atof(token.lexeme);
-              token.hasValue = 1;
-              token.lineNumber = startLine;
-              return token;
-            }
-          } else {
-            retract(tb, 1);
-            getLexeme(tb, token.lexeme);
-            token.tokenType = TK_ERROR;
-            token.errorType = ERR_UNKNOWN_PATTERN;
-            snprintf(token.errorMsg, sizeof(token.errorMsg),
-                     "Unknown pattern <%s>", token.lexeme);
-            token.lineNumber = startLine;
-            return token;
-          }
-        } else {
-          retract(tb, 1);
-          getLexeme(tb, token.lexeme);
-          token.tokenType = TK_ERROR;
-          token.errorType = ERR_UNKNOWN_PATTERN;
-          snprintf(token.errorMsg, sizeof(token.errorMsg),
-                   "Unknown pattern <%s>", token.lexeme);
-          token.lineNumber = startLine;
-          return token;
-        }
-      } else {
-        if ((unsigned char)c != (unsigned char)EOF)
-          retract(tb, 1);
-        getLexeme(tb, token.lexeme);
-        token.tokenType = TK_NUM;
-        token.value.intValue = atoi(token.lexeme);
-        token.hasValue = 1;
-        token.lineNumber = startLine;
-        return token;
-      }
-    }
-  }
-  if (c == '_') {
-    c = getNextChar(tb);
-    if (!isLET(c)) {
-      retract(tb, 1);
-      token.tokenType = TK_ERROR;
-      token.errorType = ERR_UNKNOWN_SYMBOL;
-      snprintf(token.errorMsg, sizeof(token.errorMsg), "Unknown Symbol <_>");
-      strcpy(token.lexeme, "_");
-      token.lineNumber = startLine;
-      return token;
-    }
-    while (isLET(c))
-      c = getNextChar(tb);
-    while (isDIG(c))
-      c = getNextChar(tb);
-    if ((unsigned char)c != (unsigned char)EOF)
-      retract(tb, 1);
-    getLexeme(tb, token.lexeme);
-    if (strcmp(token.lexeme, "_main") == 0) {
-      token.tokenType = TK_MAIN;
-    } else if ((int)strlen(token.lexeme) <= 30) {
-      token.tokenType = TK_FUNID;
-    } else {
-      token.tokenType = TK_ERROR;
-      token.errorType = ERR_FUNID_TOO_LONG;
-      snprintf(token.errorMsg, sizeof(token.errorMsg),"Function identifier exceeds max length of 30 characters.");
-    }
-    token.lineNumber = startLine;
-    return token;
-  }
-  if (c == '#') {
-    c = getNextChar(tb);
-    if (!isLOW(c)) {
-      retract(tb, 1);
-      token.tokenType = TK_ERROR;
-      token.errorType = ERR_UNKNOWN_SYMBOL;
-      snprintf(token.errorMsg, sizeof(token.errorMsg), "Unknown Symbol <#>");
-      strcpy(token.lexeme, "#");
-      token.lineNumber = startLine;
-      return token;
-    }
-    while (isLOW(c))
-      c = getNextChar(tb);
-    if ((unsigned char)c != (unsigned char)EOF)
-      retract(tb, 1);
-    getLexeme(tb, token.lexeme);
-    token.tokenType = TK_RUID;
-    token.lineNumber = startLine;
-    return token;
-  }
-  if (isBD(c)) {
-    c = getNextChar(tb);
-    if (isD27(c)) { 
-        c = getNextChar(tb);
-        while (isBD(c))
-            c = getNextChar(tb);
-        while (isD27(c))
-            c = getNextChar(tb);
-        if ((unsigned char)c != (unsigned char)EOF)
-            retract(tb, 1);
-        getLexeme(tb, token.lexeme);
-        int len = (int)strlen(token.lexeme);
-        if (len >= 2 && len <= 20) {
-            token.tokenType = TK_ID;
-        } else {
-            token.tokenType = TK_ERROR;
-            token.errorType = ERR_ID_TOO_LONG;
-            snprintf(token.errorMsg, sizeof(token.errorMsg), "Variable Identifier is longer than 20 characters.");
-        }
-        token.lineNumber = startLine;
-        return token;
-    } else {
-        while (isLOW(c))
-            c = getNextChar(tb);
-        if ((unsigned char)c != (unsigned char)EOF)
-            retract(tb, 1);
-        getLexeme(tb, token.lexeme);
-        token.tokenType = lookupKeyword(token.lexeme);
-        token.lineNumber = startLine;
-        return token;
-    }
-  }
-  if (isLOW(c)) {
-    while (isLOW(c))
-      c = getNextChar(tb);
-    if ((unsigned char)c != (unsigned char)EOF)
-      retract(tb, 1);
-    getLexeme(tb, token.lexeme);
-    token.tokenType = lookupKeyword(token.lexeme);
-    token.lineNumber = startLine;
-    return token;
-  }
-  if (c == '<') {
-    c = getNextChar(tb);
-    if (c == '=') {
-      token.tokenType = TK_LE;
-      strcpy(token.lexeme, "<=");
-      token.lineNumber = startLine;
-      return token;
-    } else if (c == '-') {
-      c = getNextChar(tb);
-      if (c == '-') {
-        c = getNextChar(tb);
-        if (c == '-') {
-          token.tokenType = TK_ASSIGNOP;
-          strcpy(token.lexeme, "<---");
-          token.lineNumber = startLine;
-          return token;
-        } else {
-          retract(tb, 1);
-          getLexeme(tb, token.lexeme);
-          token.tokenType = TK_ERROR;
-          token.errorType = ERR_UNKNOWN_PATTERN;
-          snprintf(token.errorMsg, sizeof(token.errorMsg),
-                   "Unknown pattern <%s>", token.lexeme);
-          token.lineNumber = startLine;
-          return token;
-        }
-      } else {
-        token.tokenType = TK_ERROR;
-        strcpy(token.lexeme, "<-");
-        token.lineNumber = startLine;
-        return token;
-      }
-    } else {
-      retract(tb, 1);
-      token.tokenType = TK_LT;
-      strcpy(token.lexeme, "<");
-      token.lineNumber = startLine;
-      return token;
-    }
-  }
-  if (c == '>') {
-    c = getNextChar(tb);
-    if (c == '=') {
-      token.tokenType = TK_GE;
-      strcpy(token.lexeme, ">=");
-    } else {
-      retract(tb, 1);
-      token.tokenType = TK_GT;
-      strcpy(token.lexeme, ">");
-    }
-    token.lineNumber = startLine;
-    return token;
+TokenType lookupKeywordSpan(const char *s, size_t len) {
+  for (int i = 0; keywordTable[i].keyword != NULL; i++) {
+    const char *k = keywordTable[i].keyword;
+    if (k[0] == s[0] && strncmp(k, s, len) == 0 && k[len] == '\0')
+      return keywordTable[i].token;
   }
-  if (c == '=') {
-    c = getNextChar(tb);
-    if (c == '=') {
-      token.tokenType = TK_EQ;
-      strcpy(token.lexeme, "==");
-    } else {
-      retract(tb, 1);
-      token.tokenType = TK_ERROR;
-      token.errorType = ERR_UNKNOWN_SYMBOL;
-      snprintf(token.errorMsg, sizeof(token.errorMsg), "Unknown Symbol <=>");
-      strcpy(token.lexeme, "=");
-    }
-    token.lineNumber = startLine;
-    return token;
+  return TK_FIELDID;
+}
+
+void spanLexeme(const lexSpan *tk, char *lexeme) {
+  if (tk->type == TK_EOF) {
+    strcpy(lexeme, "EOF");
+    return;
   }
-  if (c == '!') {
-    c = getNextChar(tb);
-    if (c == '=') {
-      token.tokenType = TK_NE;
-      strcpy(token.lexeme, "!=");
-    } else {
-      retract(tb, 1);
-      token.tokenType = TK_ERROR;
-      token.errorType = ERR_UNKNOWN_SYMBOL;
-      snprintf(token.errorMsg, sizeof(token.errorMsg), "Unknown Symbol <!>");
-      strcpy(token.lexeme, "!");
-    }
-    token.lineNumber = startLine;
-    return token;
+  uint32_t n = tk->len < MAX_LEXEME_LENGTH - 1 ? tk->len
+                                                 : MAX_LEXEME_LENGTH - 1;
+  memcpy(lexeme, tk->start, n);
+  lexeme[n] = '\0';
+}
+
+void spanToken(const lexSpan *tk, tokenInfo *token) {
+  token->tokenType = (TokenType)tk->type;
+  token->lineNumber = tk->line;
+  spanLexeme(tk, token->lexeme);
+  token->value.realValue = 0;
+  token->hasValue = tk->type == TK_NUM || tk->type == TK_RNUM;
+  if (tk->type == TK_NUM)
+    token->value.intValue = atoi(token->lexeme);
+  else if (tk->type == TK_RNUM)
+    token->value.realValue = atof(token->lexeme);
+  token->errorType = tk->type == TK_ERROR ? tk->err : ERR_NONE;
+  token->errorMsg[0] = '\0';
+  if (tk->type != TK_ERROR)
+    return;
+  switch (tk->err) {
+  case ERR_UNKNOWN_PATTERN:
+    snprintf(token->errorMsg, sizeof(token->errorMsg), "Unknown pattern <%s>",
+             token->lexeme);
+    break;
+  case ERR_UNKNOWN_SYMBOL:
+    snprintf(token->errorMsg, sizeof(token->errorMsg), "Unknown Symbol <%c>",
+             *tk->start);
+    break;
+  case ERR_FUNID_TOO_LONG:
+    snprintf(token->errorMsg, sizeof(token->errorMsg),
+             "Function identifier exceeds max length of 30 characters.");
+    break;
+  case ERR_ID_TOO_LONG:
+    snprintf(token->errorMsg, sizeof(token->errorMsg),
+             "Variable Identifier is longer than 20 characters.");
+    break;
   }
-  if (c == '&') {
-    c = getNextChar(tb);
-    if (c == '&') {
-      c = getNextChar(tb);
-      if (c == '&') {
-        token.tokenType = TK_AND;
-        strcpy(token.lexeme, "&&&");
-      } else {
-        retract(tb, 1);
-        token.tokenType = TK_ERROR;
-        token.errorType = ERR_UNKNOWN_PATTERN;
-        snprintf(token.errorMsg, sizeof(token.errorMsg),
-                 "Unknown pattern <&&>");
-        strcpy(token.lexeme, "&&");
-      }
-    } else {
-      retract(tb, 1);
-      token.tokenType = TK_ERROR;
-      token.errorType = ERR_UNKNOWN_SYMBOL;
-      snprintf(token.errorMsg, sizeof(token.errorMsg), "Unknown Symbol <&>");
-      strcpy(token.lexeme, "&");
-    }
-    token.lineNumber = startLine;
-    return token;
+}
+
+/* A token that runs into the wrap is read through getNextChar into
+   tb->scratch, a chunk at a time, and rescanned until scanSpan stops short
+   of the end. A chunk is at most half a buffer, so what was read past the
+   token can still be retracted. */
+static void scanWrapped(twinBuffer *tb, tokenInfo *token) {
+  uint32_t n = 0, chunk = 64;
+  int begin = tb->forward, line = tb->lineNumber;
+  lexCursor C;
+  lexSpan tk;
+  for (;;) {
+    tb->scratch = (char *)growArray(tb->scratch, &tb->scratchCap, n + chunk,
+                                    1, "lexer scratch");
+    uint32_t stop = n + chunk;
+    while (n < stop && !atEOF(tb))
+      tb->scratch[n++] = getNextChar(tb);
+    C = (lexCursor){tb->scratch, tb->scratch + n, line, 0};
+    tk.type = scanSpan(&C, &tk);
+    if (!C.hitEnd || atEOF(tb))
+      break;
+    if (chunk < BUFFER_SIZE / 2)
+      chunk *= 2;
   }
-  if (c == '@') {
-    c = getNextChar(tb);
-    if (c == '@') {
-      c = getNextChar(tb);
-      if (c == '@') {
-        token.tokenType = TK_OR;
-        strcpy(token.lexeme, "@@@");
-      } else {
-        retract(tb, 1);
-        token.tokenType = TK_ERROR;
-        token.errorType = ERR_UNKNOWN_PATTERN;
-        snprintf(token.errorMsg, sizeof(token.errorMsg),
-                 "Unknown pattern <@@>");
-        strcpy(token.lexeme, "@@");
-      }
+  retract(tb, (int)(tb->scratch + n - C.p));
+  tb->lexemeBegin = (int)((begin + (tk.start - tb->scratch)) % TWIN_BUFFER_SIZE);
+  spanToken(&tk, token);
+}
+
+void scanNextToken(twinBuffer *tb, tokenInfo *token) {
+  int last, end = contiguousEnd(tb, &last);
+  const char *base = tb->buffer + tb->forward;
+  lexCursor C = {base, tb->buffer + end, tb->lineNumber, 0};
+  lexSpan tk;
+  tk.type = scanSpan(&C, &tk);
+  if (C.hitEnd && !last) {
+    if (tb->forward < BUFFER_SIZE && tb->currentBuffer == 0) {
+      loadHalf(tb, 1);
+      scanNextToken(tb, token);
     } else {
-      retract(tb, 1);
-      token.tokenType = TK_ERROR;
-      token.errorType = ERR_UNKNOWN_SYMBOL;
-      snprintf(token.errorMsg, sizeof(token.errorMsg), "Unknown Symbol <@>");
-      strcpy(token.lexeme, "@");
+      scanWrapped(tb, token);
     }
-    token.lineNumber = startLine;
-    return token;
-  }
-  if (c == '|') {
-    token.tokenType = TK_ERROR;
-    token.errorType = ERR_UNKNOWN_SYMBOL;
-    snprintf(token.errorMsg, sizeof(token.errorMsg), "Unknown Symbol <|>");
-    strcpy(token.lexeme, "|");
-    token.lineNumber = startLine;
-    return token;
+    return;
   }
-  switch (c) {
-  case '~':
-    token.tokenType = TK_NOT;
-    strcpy(token.lexeme, "~");
-    break;
-  case '+':
-    token.tokenType = TK_PLUS;
-    strcpy(token.lexeme, "+");
-    break;
-  case '-':
-    token.tokenType = TK_MINUS;
-    strcpy(token.lexeme, "-");
-    break;
-  case '*':
-    token.tokenType = TK_MUL;
-    strcpy(token.lexeme, "*");
-    break;
-  case '/':
-    token.tokenType = TK_DIV;
-    strcpy(token.lexeme, "/");
-    break;
-  case ',':
-    token.tokenType = TK_COMMA;
-    strcpy(token.lexeme, ",");
-    break;
-  case ';':
-    token.tokenType = TK_SEM;
-    strcpy(token.lexeme, ";");
-    break;
-  case ':':
-    token.tokenType = TK_COLON;
-    strcpy(token.lexeme, ":");
-    break;
-  case '.':
-    token.tokenType = TK_DOT;
-    strcpy(token.lexeme, ".");
-    break;
-  case '(':
-    token.tokenType = TK_OP;
-    strcpy(token.lexeme, "(");
-    break;
-  case ')':
-    token.tokenType = TK_CL;
-    strcpy(token.lexeme, ")");
-    break;
-  case '[':
-    token.tokenType = TK_SQL;
-    strcpy(token.lexeme, "[");
-    break;
-  case ']':
-    token.tokenType = TK_SQR;
-    strcpy(token.lexeme, "]");
-    break;
-  default:
-    token.tokenType = TK_ERROR;
-    token.errorType = ERR_UNKNOWN_SYMBOL;
-    snprintf(token.errorMsg, sizeof(token.errorMsg), "Unknown Symbol <%c>", c);
-    snprintf(token.lexeme, sizeof(token.lexeme), "%c", c);
-    break;
+  /* The lexeme is copied out before the next half is loaded over it. */
+  spanToken(&tk, token);
+  tb->lexemeBegin = (int)(tk.start - tb->buffer);
+  tb->forward += (int)(C.p - base);
+  tb->lineNumber = C.line;
+  if (tb->forward == BUFFER_SIZE && tb->currentBuffer == 0) {
+    loadHalf(tb, 1);
+  } else if (tb->forward == TWIN_BUFFER_SIZE) {
+    if (tb->currentBuffer == 1)
+      loadHalf(tb, 0);
+    tb->forward = 0;
   }
-  token.lineNumber = startLine;
+}
+
+tokenInfo getNextToken(twinBuffer *tb) {
+  tokenInfo token;
+  memset(&token, 0, sizeof(token));
+  scanNextToken(tb, &token);
   return token;
 }
 
@@ -14,10 +14,249 @@ void freeTwinBuffer(twinBuffer *tb);
 
 TokenType lookupKeyword(const char *lexeme);
 
+/* lookupKeyword for a lexeme that is not NUL-terminated. */
+TokenType lookupKeywordSpan(const char *s, size_t len);
+
 tokenInfo getNextToken(twinBuffer *tb);
 
+void scanNextToken(twinBuffer *tb, tokenInfo *token);
+
+/* The lexeme, value and error message scanNextToken stores for tk. */
+void spanToken(const lexSpan *tk, tokenInfo *token);
+
+/* tk's lexeme alone, cut to MAX_LEXEME_LENGTH - 1 characters. */
+void spanLexeme(const lexSpan *tk, char *lexeme);
+
 void removeComments(char *testcaseFile, char *cleanFile);
 
 const char* getTokenName(TokenType token);
 
+static inline int isDIG(int c) { return c >= '0' && c <= '9'; }
+static inline int isD27(int c) { return c >= '2' && c <= '7'; }
+static inline int isLOW(int c) { return c >= 'a' && c <= 'z'; }
+static inline int isBD(int c) { return c == 'b' || c == 'c' || c == 'd'; }
+static inline int isLET(int c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+static inline int isWS(int c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+#define SPAN_EOF (-1)
+
+static inline int spanGet(lexCursor *S) {
+  if (S->p == S->end) {
+    S->hitEnd = 1;
+    return SPAN_EOF;
+  }
+  int c = (unsigned char)*S->p++;
+  if (c == '\n')
+    S->line++;
+  return c;
+}
+
+static inline void spanUnget(lexCursor *S) {
+  if (*--S->p == '\n')
+    S->line--;
+}
+
+/* A retract after a one-character prefix that reached end of input would
+   leave the cursor where the token began, so it is skipped at EOF. */
+static inline void spanUngetUnlessEOF(lexCursor *S, int c) {
+  if (c != SPAN_EOF)
+    spanUnget(S);
+}
+
+static inline int spanError(lexCursor *S, lexSpan *tk, int err) {
+  tk->err = err;
+  tk->len = (uint32_t)(S->p - tk->start);
+  return TK_ERROR;
+}
+
+/* The lexer DFA: skips blanks, then scans one token at S->p and leaves S
+   after it. Returns the token type; a comment is TK_COMMENT with the
+   lexeme "%". scanNextToken drives it over the twin buffer, the fused
+   engine over the whole file. */
+static inline int scanSpan(lexCursor *S, lexSpan *tk) {
+  while (S->p != S->end && isWS((unsigned char)*S->p))
+    if (*S->p++ == '\n')
+      S->line++;
+
+  tk->start = S->p;
+  tk->line = S->line;
+  tk->err = ERR_NONE;
+  int c = spanGet(S);
+  switch (c) {
+  case SPAN_EOF:
+    tk->len = 0;
+    return TK_EOF;
+
+  case '%':
+    while ((c = spanGet(S)) != '\n' && c != SPAN_EOF)
+      ;
+    spanUngetUnlessEOF(S, c);
+    tk->len = 1;
+    return TK_COMMENT;
+
+  case '0': case '1': case '2': case '3': case '4':
+  case '5': case '6': case '7': case '8': case '9':
+    while (isDIG(c = spanGet(S)))
+      ;
+    if (c == '.') {
+      if (!isDIG(spanGet(S))) {
+        spanUnget(S);
+        return spanError(S, tk, ERR_UNKNOWN_PATTERN);
+      }
+      if (!isDIG(spanGet(S))) {
+        spanUnget(S);
+        return spanError(S, tk, ERR_UNKNOWN_PATTERN);
+      }
+      if (spanGet(S) == 'E') {
+        c = spanGet(S);
+        if (c == '+' || c == '-')
+          c = spanGet(S);
+        if (!isDIG(c)) {
+          spanUnget(S);
+          return spanError(S, tk, ERR_NONE);
+        }
+        if (!isDIG(spanGet(S))) {
+          spanUnget(S);
+          return spanError(S, tk, ERR_UNKNOWN_PATTERN);
+        }
+      } else {
+        spanUnget(S);
+      }
+      tk->len = (uint32_t)(S->p - tk->start);
+      return TK_RNUM;
+    }
+    spanUngetUnlessEOF(S, c);
+    tk->len = (uint32_t)(S->p - tk->start);
+    return TK_NUM;
+
+  case '_':
+    c = spanGet(S);
+    if (!isLET(c)) {
+      spanUngetUnlessEOF(S, c);
+      return spanError(S, tk, ERR_UNKNOWN_SYMBOL);
+    }
+    while (isLET(c))
+      c = spanGet(S);
+    while (isDIG(c))
+      c = spanGet(S);
+    spanUngetUnlessEOF(S, c);
+    tk->len = (uint32_t)(S->p - tk->start);
+    if (tk->len == 5 && memcmp(tk->start, "_main", 5) == 0)
+      return TK_MAIN;
+    return tk->len <= 30 ? TK_FUNID
+                         : spanError(S, tk, ERR_FUNID_TOO_LONG);
+
+  case '#':
+    c = spanGet(S);
+    if (!isLOW(c)) {
+      spanUngetUnlessEOF(S, c);
+      return spanError(S, tk, ERR_UNKNOWN_SYMBOL);
+    }
+    while (isLOW(c))
+      c = spanGet(S);
+    spanUngetUnlessEOF(S, c);
+    tk->len = (uint32_t)(S->p - tk->start);
+    return TK_RUID;
+
+  case 'b': case 'c': case 'd':
+    c = spanGet(S);
+    if (isD27(c)) {
+      c = spanGet(S);
+      while (isBD(c))
+        c = spanGet(S);
+      while (isD27(c))
+        c = spanGet(S);
+      spanUngetUnlessEOF(S, c);
+      tk->len = (uint32_t)(S->p - tk->start);
+      return tk->len <= 20 ? TK_ID : spanError(S, tk, ERR_ID_TOO_LONG);
+    }
+    /* fall through */
+  case 'a': case 'e': case 'f': case 'g': case 'h': case 'i': case 'j':
+  case 'k': case 'l': case 'm': case 'n': case 'o': case 'p': case 'q':
+  case 'r': case 's': case 't': case 'u': case 'v': case 'w': case 'x':
+  case 'y': case 'z':
+    while (isLOW(c))
+      c = spanGet(S);
+    spanUngetUnlessEOF(S, c);
+    tk->len = (uint32_t)(S->p - tk->start);
+    return lookupKeywordSpan(tk->start, tk->len);
+
+  case '<':
+    c = spanGet(S);
+    if (c == '=') {
+      tk->len = 2;
+      return TK_LE;
+    }
+    if (c == '-') {
+      /* "<-" also swallows the character after it. */
+      if (spanGet(S) != '-') {
+        tk->len = 2;
+        return TK_ERROR;
+      }
+      if (spanGet(S) != '-') {
+        spanUnget(S);
+        return spanError(S, tk, ERR_UNKNOWN_PATTERN);
+      }
+      tk->len = 4;
+      return TK_ASSIGNOP;
+    }
+    spanUngetUnlessEOF(S, c);
+    tk->len = 1;
+    return TK_LT;
+
+  case '>':
+    c = spanGet(S);
+    if (c == '=') {
+      tk->len = 2;
+      return TK_GE;
+    }
+    spanUngetUnlessEOF(S, c);
+    tk->len = 1;
+    return TK_GT;
+
+  case '=':
+  case '!':
+    if ((c = spanGet(S)) == '=') {
+      tk->len = 2;
+      return *tk->start == '=' ? TK_EQ : TK_NE;
+    }
+    spanUngetUnlessEOF(S, c);
+    return spanError(S, tk, ERR_UNKNOWN_SYMBOL);
+
+  case '&':
+  case '@':
+    if ((c = spanGet(S)) == *tk->start) {
+      if ((c = spanGet(S)) == *tk->start) {
+        tk->len = 3;
+        return *tk->start == '&' ? TK_AND : TK_OR;
+      }
+      spanUngetUnlessEOF(S, c);
+      tk->err = ERR_UNKNOWN_PATTERN;
+      tk->len = 2;
+      return TK_ERROR;
+    }
+    spanUngetUnlessEOF(S, c);
+    return spanError(S, tk, ERR_UNKNOWN_SYMBOL);
+
+  case '~': tk->len = 1; return TK_NOT;
+  case '+': tk->len = 1; return TK_PLUS;
+  case '-': tk->len = 1; return TK_MINUS;
+  case '*': tk->len = 1; return TK_MUL;
+  case '/': tk->len = 1; return TK_DIV;
+  case ',': tk->len = 1; return TK_COMMA;
+  case ';': tk->len = 1; return TK_SEM;
+  case ':': tk->len = 1; return TK_COLON;
+  case '.': tk->len = 1; return TK_DOT;
+  case '(': tk->len = 1; return TK_OP;
+  case ')': tk->len = 1; return TK_CL;
+  case '[': tk->len = 1; return TK_SQL;
+  case ']': tk->len = 1; return TK_SQR;
+  }
+  return spanError(S, tk, ERR_UNKNOWN_SYMBOL);
+}
+
 #endif
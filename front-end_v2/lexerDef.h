@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
 
 #define BUFFER_SIZE 4096
 #define TWIN_BUFFER_SIZE (2 * BUFFER_SIZE)
@@ -93,9 +94,32 @@ typedef struct {
     int currentBuffer;
     FILE *fp;
     int eof1, eof2;
+    int size1, size2;       // bytes read into each half
     int lineNumber;
+    char *scratch;          // a token that wraps past the end of the buffer
+    uint32_t scratchCap;
 } twinBuffer;
 
+/* Text in memory scanned by scanSpan. hitEnd is set once the scan has
+   looked for a character at end. */
+typedef struct {
+    const char *p;
+    const char *end;
+    int line;
+    int hitEnd;
+} lexCursor;
+
+/* A token found by scanSpan: the lexeme is start[0 .. len), and for
+   TK_ERROR err is the LexErrorType of its message (ERR_NONE: the lexeme
+   itself). */
+typedef struct {
+    int type;
+    int line;
+    int err;
+    uint32_t len;
+    const char *start;
+} lexSpan;
+
 typedef struct {
     char *keyword;
     TokenType token;
@@ -0,0 +1,120 @@
+#define _POSIX_C_SOURCE 200809L
+#include "mappedFile.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint64_t alignUp(uint64_t n) { return (n + 7) & ~(uint64_t)7; }
+
+void initMappedTag(mappedFileTag *T, const char *magic, uint32_t version) {
+  memcpy(T->magic, magic, sizeof(T->magic));
+  T->version = version;
+  T->byteOrder = MAPPED_FILE_BYTE_ORDER;
+}
+
+uint64_t layoutSections(size_t headerSize, mappedSection *S, int n) {
+  uint64_t offset = alignUp(headerSize);
+  for (int i = 0; i < n; i++) {
+    S[i].offset = offset;
+    offset += alignUp(S[i].count * S[i].size);
+  }
+  return offset;
+}
+
+static int writePadded(FILE *fp, const void *data, uint64_t size,
+                       uint64_t end) {
+  static const char zeros[8];
+  if (size && fwrite(data, 1, size, fp) != size)
+    return -1;
+  uint64_t pad = end - size;
+  return pad && fwrite(zeros, 1, pad, fp) != pad ? -1 : 0;
+}
+
+int writeMappedFile(const char *outfile, const void *header,
+                    size_t headerSize, const mappedSection *S, int n) {
+  FILE *fp = fopen(outfile, "wb");
+  if (!fp) {
+    fprintf(stderr, "Error: Cannot open output file %s\n", outfile);
+    return -1;
+  }
+  int rc = writePadded(fp, header, headerSize, alignUp(headerSize));
+  for (int i = 0; i < n && rc == 0; i++) {
+    uint64_t bytes = S[i].count * S[i].size;
+    rc = writePadded(fp, S[i].data, bytes, alignUp(bytes));
+  }
+  if (fclose(fp) != 0)
+    rc = -1;
+  if (rc != 0)
+    fprintf(stderr, "Error: Failed writing %s\n", outfile);
+  return rc;
+}
+
+void *mappedImage(const void *header, size_t headerSize,
+                  const mappedSection *S, int n, uint64_t fileSize) {
+  char *image = (char *)calloc(1, (size_t)fileSize);
+  if (!image) {
+    fprintf(stderr, "calloc failed for mapped image\n");
+    exit(1);
+  }
+  memcpy(image, header, headerSize);
+  for (int i = 0; i < n; i++)
+    if (S[i].count)
+      memcpy(image + S[i].offset, S[i].data, (size_t)(S[i].count * S[i].size));
+  return image;
+}
+
+void *mapFile(const char *infile, size_t *size) {
+  int fd = open(infile, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Error: Cannot open %s\n", infile);
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    fprintf(stderr, "Error: %s is empty\n", infile);
+    close(fd);
+    return NULL;
+  }
+  void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "Error: Cannot map %s\n", infile);
+    return NULL;
+  }
+  *size = (size_t)st.st_size;
+  return map;
+}
+
+void unmapFile(void *map, size_t size) { munmap(map, size); }
+
+const char *checkMappedTag(const mappedFileTag *T, uint32_t version) {
+  if (T->version != version)
+    return "unsupported format version";
+  if (T->byteOrder != MAPPED_FILE_BYTE_ORDER)
+    return "written on an incompatible platform";
+  return NULL;
+}
+
+static int sectionFits(uint64_t offset, uint64_t count, uint64_t size,
+                       uint64_t fileSize) {
+  return offset % 8 == 0 && offset <= fileSize &&
+         count * size <= fileSize - offset;
+}
+
+const char *checkSections(const void *map, size_t mapSize, uint64_t fileSize,
+                          const mappedSection *S, int n) {
+  if (fileSize != mapSize)
+    return "truncated or corrupt";
+  for (int i = 0; i < n; i++)
+    if (!sectionFits(S[i].offset, S[i].count, S[i].size, mapSize))
+      return "truncated or corrupt";
+  const mappedSection *pool = &S[n - 1];
+  if (pool->count &&
+      ((const char *)map)[pool->offset + pool->count - 1] != '\0')
+    return "unterminated string table";
+  return NULL;
+}
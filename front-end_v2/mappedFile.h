@@ -0,0 +1,38 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+#include "mappedFileDef.h"
+
+void initMappedTag(mappedFileTag *T, const char *magic, uint32_t version);
+
+/* Places the sections one after another behind a header of headerSize
+   bytes, each 8-byte aligned, and sets their offsets. Returns the size of
+   the whole file. */
+uint64_t layoutSections(size_t headerSize, mappedSection *S, int n);
+
+/* Writes the header and the sections laid out by layoutSections, padded
+   with zeros. Returns 0 on success. */
+int writeMappedFile(const char *outfile, const void *header,
+                    size_t headerSize, const mappedSection *S, int n);
+
+/* The bytes writeMappedFile would write, in one malloc'd block of
+   fileSize bytes. */
+void *mappedImage(const void *header, size_t headerSize,
+                  const mappedSection *S, int n, uint64_t fileSize);
+
+/* Maps infile read-only. Returns NULL (with a message) if it cannot be
+   opened, is empty or cannot be mapped. */
+void *mapFile(const char *infile, size_t *size);
+
+void unmapFile(void *map, size_t size);
+
+/* Checks the version and byte order. Returns NULL if the file can be
+   read, else what is wrong; the magic is left to the format. */
+const char *checkMappedTag(const mappedFileTag *T, uint32_t version);
+
+/* Checks that the file is fileSize bytes and every section is aligned and
+   inside it. The last section is the string pool (1-byte records) and must
+   end in '\0'. Constant time. */
+const char *checkSections(const void *map, size_t mapSize, uint64_t fileSize,
+                          const mappedSection *S, int n);
+
+#endif
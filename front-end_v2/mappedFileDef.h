@@ -0,0 +1,26 @@
+#ifndef MAPPEDFILEDEF_H
+#define MAPPEDFILEDEF_H
+#include <stddef.h>
+#include <stdint.h>
+
+#define MAPPED_FILE_BYTE_ORDER 0x01020304u
+
+/* Start of every mmap-able format (treeFileDef.h, xrefIndexDef.h). The
+   byte-order mark, with the record sizes in the format's own header, lets
+   a reader reject files from an ABI it cannot map directly. */
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+} mappedFileTag;
+
+/* One section: `count` records of `size` bytes at `offset` from the start
+   of the file. `data` is only used when writing. */
+typedef struct {
+  const void *data;
+  uint64_t offset;
+  uint64_t count;
+  uint64_t size;
+} mappedSection;
+
+#endif
@@ -1,8 +1,18 @@
+#define _POSIX_C_SOURCE 200809L
 #include "parser.h"
 #include "parserDef.h"
+#include "tokenPipe.h"
+#include "exprParser.h"
+#include "treeWalk.h"
+#include "util.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 
 const char *getNonTerminalName(NonTerminal nt) {
@@ -119,30 +129,29 @@ const char *getNonTerminalName(NonTerminal nt) {
 }
 
 
-static grammar *G_global;
-
+/* The rule macros append to the local `G` of initializeGrammar. */
 #define START_RULE(nt)                                                         \
   do {                                                                         \
-    G_global->rules[G_global->ruleCount].lhs = (nt);                           \
-    G_global->rules[G_global->ruleCount].rhsCount = 0;                         \
-    G_global->rules[G_global->ruleCount].ruleNumber = G_global->ruleCount + 1;
+    G->rules[G->ruleCount].lhs = (nt);                                         \
+    G->rules[G->ruleCount].rhsCount = 0;                                       \
+    G->rules[G->ruleCount].ruleNumber = G->ruleCount + 1;
 
 #define T(tok)                                                                 \
   do {                                                                         \
-    int _i = G_global->rules[G_global->ruleCount].rhsCount++;                  \
-    G_global->rules[G_global->ruleCount].rhs[_i].type = SYMBOL_TERMINAL;       \
-    G_global->rules[G_global->ruleCount].rhs[_i].symbol.terminal = (tok);      \
+    int _i = G->rules[G->ruleCount].rhsCount++;                                \
+    G->rules[G->ruleCount].rhs[_i].type = SYMBOL_TERMINAL;                     \
+    G->rules[G->ruleCount].rhs[_i].symbol.terminal = (tok);                    \
   } while (0)
 
 #define NT(nterm)                                                              \
   do {                                                                         \
-    int _i = G_global->rules[G_global->ruleCount].rhsCount++;                  \
-    G_global->rules[G_global->ruleCount].rhs[_i].type = SYMBOL_NON_TERMINAL;   \
-    G_global->rules[G_global->ruleCount].rhs[_i].symbol.nonTerminal = (nterm); \
+    int _i = G->rules[G->ruleCount].rhsCount++;                                \
+    G->rules[G->ruleCount].rhs[_i].type = SYMBOL_NON_TERMINAL;                 \
+    G->rules[G->ruleCount].rhs[_i].symbol.nonTerminal = (nterm);               \
   } while (0)
 
 #define END_RULE()                                                             \
-  G_global->ruleCount++;                                                       \
+  G->ruleCount++;                                                              \
   }                                                                            \
   while (0)
 #define EPS() T(TK_EPSILON)
@@ -156,7 +165,6 @@ grammar *initializeGrammar(void) {
   }
   G->ruleCount = 0;
   G->startSymbol = NT_PROGRAM;
-  G_global = G;
 
   START_RULE(NT_PROGRAM);
   NT(NT_OTHERFUNCTIONS);
@@ -861,266 +869,1468 @@ void createParseTable(FirstAndFollow *F, table *T, grammar *G) {
       }
     }
   }
-}
 
-static void push(stackNode **top, GrammarSymbol sym, parseTreeNode *tn) {
-  stackNode *n = (stackNode *)malloc(sizeof(stackNode));
-  if (!n) {
-    fprintf(stderr, "malloc failed in push\n");
-    exit(1);
+  for (int i = 0; i < MAX_NT; i++) {
+    T->firstMask[i] = 0;
+    T->followMask[i] = 0;
+  }
+  for (int i = 0; i < F->firstCount; i++) {
+    FirstSet *fs = &F->firstSets[i];
+    for (int j = 0; j < fs->firstCount; j++)
+      T->firstMask[fs->nonTerminal] |= TERMINAL_BIT(fs->first[j]);
+  }
+  for (int i = 0; i < F->followCount; i++) {
+    FollowSet *fw = &F->followSets[i];
+    for (int j = 0; j < fw->followCount; j++)
+      T->followMask[fw->nonTerminal] |= TERMINAL_BIT(fw->follow[j]);
+  }
+
+  memset(T->packed, 0, sizeof(T->packed));
+  for (int r = 0; r < G->ruleCount; r++) {
+    const GrammarRule *rule = &G->rules[r];
+    packedRule *p = &T->packed[rule->ruleNumber - 1];
+    uint64_t anchor = 0, pending = 0;
+    for (int i = rule->rhsCount - 1; i >= 0; i--) {
+      GrammarSymbol sym = rule->rhs[i];
+      if (sym.type == SYMBOL_NON_TERMINAL) {
+        anchor |= T->firstMask[sym.symbol.nonTerminal];
+        p->symbol[p->count] = (uint8_t)(CT_NT_BASE + sym.symbol.nonTerminal);
+      } else if (sym.symbol.terminal != TK_EPSILON) {
+        anchor |= TERMINAL_BIT(sym.symbol.terminal);
+        pending |= TERMINAL_BIT(sym.symbol.terminal);
+        p->symbol[p->count] = (uint8_t)sym.symbol.terminal;
+      } else {
+        continue;
+      }
+      p->anchor[p->count] = anchor;
+      p->pending[p->count] = pending;
+      p->count++;
+    }
+    p->epsilonLeaf = rule->rhsCount > 0 && p->count == 0;
   }
-  n->symbol = sym;
-  n->treeNode = tn;
-  n->next = *top;
-  *top = n;
 }
 
-static stackNode *pop(stackNode **top) {
-  if (!*top)
-    return NULL;
-  stackNode *n = *top;
-  *top = (*top)->next;
-  return n;
+uint32_t createNode(parseTree *PT, GrammarSymbol sym, uint32_t parent) {
+  PT->nodes = growArray(PT->nodes, &PT->nodeCapacity, PT->nodeCount + 1,
+                        sizeof(parseTreeNode), "parse tree nodes");
+  uint32_t idx = PT->nodeCount++;
+  parseTreeNode *n = &PT->nodes[idx];
+  n->symbolType = (uint8_t)sym.type;
+  n->symbolId = (uint8_t)(sym.type == SYMBOL_TERMINAL
+                              ? (int)sym.symbol.terminal
+                              : (int)sym.symbol.nonTerminal);
+  n->childCount = 0;
+  n->parent = parent;
+  n->subtreeEnd = idx + 1;
+  n->token = PT_NONE;
+  if (parent != PT_NONE)
+    PT->nodes[parent].childCount++;
+  return idx;
 }
 
-static parseTreeNode *createNode(GrammarSymbol sym) {
-  parseTreeNode *n = (parseTreeNode *)calloc(1, sizeof(parseTreeNode));
-  if (!n) {
-    fprintf(stderr, "calloc failed in createNode\n");
-    exit(1);
+uint32_t addParseToken(parseTree *PT, const tokenInfo *tk) {
+  uint32_t len = (uint32_t)strlen(tk->lexeme) + 1;
+  PT->lexemes = growArray(PT->lexemes, &PT->lexemeCapacity,
+                          PT->lexemeSize + len, 1, "lexeme pool");
+  PT->tokens = growArray(PT->tokens, &PT->tokenCapacity, PT->tokenCount + 1,
+                         sizeof(parseToken), "token stream");
+  parseToken *t = &PT->tokens[PT->tokenCount];
+  memset(t, 0, sizeof(*t)); /* padding is written out by writeTreeFile */
+  t->tokenType = tk->tokenType;
+  t->lineNumber = tk->lineNumber;
+  t->hasValue = tk->hasValue;
+  if (tk->tokenType == TK_RNUM)
+    t->value.realValue = tk->value.realValue;
+  else
+    t->value.intValue = tk->value.intValue;
+  t->lexeme = PT->lexemeSize;
+  memcpy(PT->lexemes + PT->lexemeSize, tk->lexeme, len);
+  PT->lexemeSize += len;
+  return PT->tokenCount++;
+}
+
+/* Same as addParseToken for a token that is already in compact form. */
+static uint32_t copyParseToken(parseTree *PT, const parseToken *src,
+                               const char *lexeme) {
+  uint32_t len = (uint32_t)strlen(lexeme) + 1;
+  PT->lexemes = growArray(PT->lexemes, &PT->lexemeCapacity,
+                          PT->lexemeSize + len, 1, "lexeme pool");
+  PT->tokens = growArray(PT->tokens, &PT->tokenCapacity, PT->tokenCount + 1,
+                         sizeof(parseToken), "token stream");
+  parseToken *t = &PT->tokens[PT->tokenCount];
+  *t = *src;
+  t->lexeme = PT->lexemeSize;
+  memcpy(PT->lexemes + PT->lexemeSize, lexeme, len);
+  PT->lexemeSize += len;
+  return PT->tokenCount++;
+}
+
+void computeSubtreeEnds(parseTree *PT) {
+  for (uint32_t i = PT->nodeCount; i-- > 1;) {
+    parseTreeNode *p = &PT->nodes[PT->nodes[i].parent];
+    if (p->subtreeEnd < PT->nodes[i].subtreeEnd)
+      p->subtreeEnd = PT->nodes[i].subtreeEnd;
   }
-  n->symbol = sym;
-  n->isLeaf = (sym.type == SYMBOL_TERMINAL) ? 1 : 0;
-  return n;
 }
 
-static void addChild(parseTreeNode *parent, parseTreeNode *child) {
-  if (parent && child && parent->childCount < MAX_CHILDREN) {
-    parent->children[parent->childCount++] = child;
-    child->parent = parent;
+uint32_t parseTreeFirstChild(const parseTree *PT, uint32_t node) {
+  return PT->nodes[node].childCount ? node + 1 : PT_NONE;
+}
+
+uint32_t parseTreeNextSibling(const parseTree *PT, uint32_t node) {
+  uint32_t parent = PT->nodes[node].parent;
+  uint32_t next = PT->nodes[node].subtreeEnd;
+  if (parent == PT_NONE || next >= PT->nodes[parent].subtreeEnd)
+    return PT_NONE;
+  return next;
+}
+
+const char *parseTreeLexeme(const parseTree *PT, uint32_t node) {
+  uint32_t t = PT->nodes[node].token;
+  return t == PT_NONE ? "" : PT->lexemes + PT->tokens[t].lexeme;
+}
+
+void initParserState(parserState *ps, parseTree *PT,
+                            parseListener *listener) {
+  memset(ps, 0, sizeof(*ps));
+  ps->PT = PT;
+  ps->listener = listener;
+  ps->curIndex = PT_NONE;
+  ps->syntaxOK = 1;
+  ps->lastErrorLine = -1;
+}
+
+static void addDiagnostic(parseDiagnostics *D, int line, const char *fmt,
+                          ...);
+
+void reportError(parserState *ps, int line, const char *fmt, ...) {
+  char msg[512];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(msg, sizeof(msg), fmt, ap);
+  va_end(ap);
+  if (ps->diag) {
+    addDiagnostic(ps->diag, line, "%s", msg);
+  } else if (ps->errorCount < MAX_PARSE_ERRORS) {
+    /* errors past the cap are counted but not reported */
+    if (ps->listener && ps->listener->error)
+      ps->listener->error(ps->listener->ctx, line, msg);
+    else
+      fprintf(stderr, "Line %d\tError: %s\n", line, msg);
   }
+  ps->errorCount++;
+  ps->syntaxOK = 0;
 }
 
-static int isSyncToken(TokenType t) {
-  return (t == TK_SEM || t == TK_ENDRECORD || t == TK_ENDUNION ||
-          t == TK_ENDIF || t == TK_ENDWHILE || t == TK_ELSE || t == TK_CL ||
-          t == TK_SQR || t == TK_END || t == TK_EOF);
+void reportMismatch(parserState *ps, int line, TokenType found,
+                    const char *lexeme, TokenType expected) {
+  if (!recoveryReports(ps, line))
+    return;
+  reportError(ps, line,
+              "The token %s for lexeme %s  does not match with the "
+              "expected token %s",
+              getTokenName(found), lexeme, getTokenName(expected));
+  ps->lastErrorLine = line;
+  ps->quiet = RECOVERY_QUIET_MATCHES;
 }
 
-static tokenInfo nextMeaningfulToken(twinBuffer *tb, int *errorCount,
-                                     int *syntaxOK) {
-  tokenInfo cur;
+void reportNoRule(parserState *ps, int line, TokenType found,
+                  const char *lexeme, NonTerminal A) {
+  if (found == TK_EOF || !recoveryReports(ps, line))
+    return;
+  reportError(ps, line,
+              "Invalid token %s encountered with value %s stack top %s",
+              getTokenName(found), lexeme, getNonTerminalName(A) + 1);
+  ps->lastErrorLine = line;
+  ps->quiet = RECOVERY_QUIET_MATCHES;
+}
+
+int recoverTerminal(parserState *ps, TokenType t, uint64_t anchor,
+                    uint64_t pending) {
+  if (ps->curType == t)
+    return 1;
+  reportMismatch(ps, ps->curLine, ps->curType, ps->curLexeme, t);
+  while (recoveryDeletes(ps->curType, t, anchor, pending))
+    nextMeaningfulToken(ps);
+  return ps->curType == t;
+}
+
+void nextMeaningfulToken(parserState *ps) {
+  if (ps->stream) {
+    if (ps->streamPos < ps->streamEnd) {
+      const parseToken *t = &ps->stream->tokens[ps->streamPos];
+      ps->curType = t->tokenType;
+      ps->curLine = t->lineNumber;
+      ps->curLexeme = ps->stream->lexemes + t->lexeme;
+      ps->curIndex = ps->streamPos++;
+    } else {
+      ps->curType = TK_EOF;
+      ps->curLexeme = "EOF";
+      ps->curIndex = PT_NONE;
+    }
+    return;
+  }
+
+  if (ps->pipe) {
+    const parseToken *t;
+    const char *lexeme;
+    while ((t = tokenPipeNext(ps->pipe, &lexeme))->tokenType == TK_ERROR)
+      reportError(ps, t->lineNumber, "%s", lexeme);
+    ps->pipeToken = t;
+    ps->curType = t->tokenType;
+    ps->curLine = t->lineNumber;
+    ps->curLexeme = lexeme;
+    if (ps->PT)
+      ps->curIndex = copyParseToken(ps->PT, t, lexeme);
+    return;
+  }
+
+  tokenInfo *cur = &ps->lexed;
   do {
-    cur = getNextToken(tb);
-    if (cur.tokenType == TK_COMMENT)
+    scanNextToken(ps->tb, cur);
+    if (cur->tokenType == TK_COMMENT)
       continue;
-    if (cur.tokenType == TK_ERROR) {
-      fprintf(stderr, "Line %d\tError: %s\n", cur.lineNumber,
-              cur.errorMsg[0] ? cur.errorMsg : cur.lexeme);
-      (*errorCount)++;
-      *syntaxOK = 0;
+    if (cur->tokenType == TK_ERROR)
+      reportError(ps, cur->lineNumber, "%s",
+                  cur->errorMsg[0] ? cur->errorMsg : cur->lexeme);
+  } while (cur->tokenType == TK_COMMENT || cur->tokenType == TK_ERROR);
+  ps->curType = cur->tokenType;
+  ps->curLine = cur->lineNumber;
+  ps->curLexeme = cur->lexeme;
+  if (ps->PT)
+    ps->curIndex = addParseToken(ps->PT, cur);
+}
+
+static const tokenInfo *currentToken(parserState *ps) {
+  if (!ps->stream && !ps->pipe)
+    return &ps->lexed;
+  const parseToken *t =
+      ps->pipe ? ps->pipeToken : &ps->stream->tokens[ps->curIndex];
+  ps->lexed.tokenType = t->tokenType;
+  ps->lexed.lineNumber = t->lineNumber;
+  ps->lexed.hasValue = t->hasValue;
+  ps->lexed.value.realValue = t->value.realValue;
+  strncpy(ps->lexed.lexeme, ps->curLexeme, MAX_LEXEME_LENGTH - 1);
+  ps->lexed.lexeme[MAX_LEXEME_LENGTH - 1] = '\0';
+  return &ps->lexed;
+}
+
+static GrammarSymbol unpackSymbol(uint8_t sym) {
+  GrammarSymbol s;
+  if (sym >= CT_NT_BASE) {
+    s.type = SYMBOL_NON_TERMINAL;
+    s.symbol.nonTerminal = (NonTerminal)(sym - CT_NT_BASE);
+  } else {
+    s.type = SYMBOL_TERMINAL;
+    s.symbol.terminal = (TokenType)sym;
+  }
+  return s;
+}
+
+/* Bounded mode: pass the finished function at `root` to the consumer, then
+   drop its nodes and tokens. Terminals are matched in preorder, so nothing
+   outside the subtree uses its tokens; only those from the lookahead on are
+   kept, moved down to where the function's tokens began. */
+static void releaseFunction(parserState *ps, uint32_t root) {
+  parseTree *PT = ps->PT;
+  for (uint32_t i = PT->nodeCount; i-- > root + 1;) {
+    parseTreeNode *p = &PT->nodes[PT->nodes[i].parent];
+    if (p->subtreeEnd < PT->nodes[i].subtreeEnd)
+      p->subtreeEnd = PT->nodes[i].subtreeEnd;
+  }
+  ps->consumer->function(ps->consumer->ctx, PT, root);
+
+  uint32_t first = ps->curIndex;
+  for (uint32_t i = root + 1; i < PT->nodeCount; i++)
+    if (PT->nodes[i].token < first)
+      first = PT->nodes[i].token;
+  if (first < ps->curIndex) {
+    uint32_t keep = PT->tokenCount - ps->curIndex;
+    uint32_t from = PT->tokens[ps->curIndex].lexeme;
+    uint32_t to = PT->tokens[first].lexeme;
+    memmove(PT->lexemes + to, PT->lexemes + from, PT->lexemeSize - from);
+    PT->lexemeSize -= from - to;
+    memmove(&PT->tokens[first], &PT->tokens[ps->curIndex],
+            keep * sizeof(parseToken));
+    for (uint32_t k = 0; k < keep; k++)
+      PT->tokens[first + k].lexeme -= from - to;
+    PT->tokenCount = first + keep;
+    ps->curIndex = first;
+  }
+  PT->nodeCount = root + 1;
+  PT->nodes[root].childCount = 0;
+  PT->nodes[root].subtreeEnd = root + 1;
+}
+
+static int runParser(parserState *ps, const table *T,
+                     NonTerminal startSymbol) {
+  parseTree *PT = ps->PT;
+  parseListener *listener = ps->listener;
+
+  uint32_t cap = 0, sp = 0;
+  stackNode *stack = (stackNode *)growArray(NULL, &cap, 2, sizeof(stackNode),
+                                            "parser stack");
+  stack[sp].symbol = (uint8_t)TK_EOF;
+  stack[sp].parent = PT_NONE;
+  stack[sp].rule = NULL;
+  stack[sp].anchor = stack[sp].pending = TERMINAL_BIT(TK_EOF);
+  sp++;
+  stack[sp].symbol = (uint8_t)(CT_NT_BASE + startSymbol);
+  stack[sp].parent = PT_NONE;
+  stack[sp].rule = NULL;
+  stack[sp].anchor = T->firstMask[startSymbol] | TERMINAL_BIT(TK_EOF);
+  stack[sp].pending = TERMINAL_BIT(TK_EOF);
+  sp++;
+
+  nextMeaningfulToken(ps);
+
+  while (sp > 0) {
+    stackNode top = stack[--sp];
+    uint8_t X = top.symbol;
+
+    if (X == PACKED_RULE_END) {
+      if (listener->exitNonTerminal)
+        listener->exitNonTerminal(listener->ctx, top.rule->lhs, top.rule);
+      continue;
+    }
+
+    if (X == TK_EOF) {
+      if (ps->curType != TK_EOF) {
+        if (ps->curLine != ps->lastErrorLine) {
+          reportError(ps, ps->curLine,
+                      "Unexpected token %s encountered at end",
+                      getTokenName(ps->curType));
+          ps->lastErrorLine = ps->curLine;
+        }
+      }
+      break;
     }
-  } while (cur.tokenType == TK_COMMENT || cur.tokenType == TK_ERROR);
-  return cur;
+
+    uint32_t tn =
+        listener ? PT_NONE : createNode(PT, unpackSymbol(X), top.parent);
+
+    if (X < CT_NT_BASE) {
+      TokenType t = (TokenType)X;
+      if (recoverTerminal(ps, t, stack[sp - 1].anchor,
+                          stack[sp - 1].pending)) {
+        if (!listener)
+          PT->nodes[tn].token = ps->curIndex;
+        else if (listener->matchTerminal)
+          listener->matchTerminal(listener->ctx, t, currentToken(ps));
+        if (ps->quiet)
+          ps->quiet--;
+        nextMeaningfulToken(ps);
+      } else if (listener && listener->matchTerminal) {
+        listener->matchTerminal(listener->ctx, t, NULL);
+      }
+      if (t == TK_END && ps->consumer &&
+          PT->nodes[top.parent].symbolType == SYMBOL_NON_TERMINAL &&
+          (PT->nodes[top.parent].symbolId == NT_FUNCTION ||
+           PT->nodes[top.parent].symbolId == NT_MAINFUNCTION))
+        releaseFunction(ps, top.parent);
+    } else if (ps->flatExpressions && !listener &&
+               (X == CT_NT_BASE + NT_ARITHMETICEXPRESSION ||
+                X == CT_NT_BASE + NT_BOOLEANEXPRESSION)) {
+      parseFlatExpression(ps, T, (NonTerminal)(X - CT_NT_BASE), tn,
+                          stack[sp - 1].anchor, stack[sp - 1].pending);
+    } else {
+      NonTerminal A = (NonTerminal)(X - CT_NT_BASE);
+      int a = (int)ps->curType;
+
+      if (!T->entries[A][a].isValid) {
+        reportNoRule(ps, ps->curLine, ps->curType, ps->curLexeme, A);
+        /* Skip to a token A can start with, A can be followed by, or some
+           pending symbol can consume. Resume A in the first case,
+           otherwise give it up as empty. */
+        uint64_t stop =
+            T->firstMask[A] | T->followMask[A] | stack[sp - 1].anchor;
+        while (ps->curType != TK_EOF && !(stop & TERMINAL_BIT(ps->curType)))
+          nextMeaningfulToken(ps);
+        a = (int)ps->curType;
+      }
+
+      if (T->entries[A][a].isValid) {
+        const ParseTableEntry *e = &T->entries[A][a];
+        const packedRule *p = &T->packed[e->ruleNumber - 1];
+        stack = (stackNode *)growArray(stack, &cap, sp + p->count + 1,
+                                       sizeof(stackNode), "parser stack");
+        uint64_t anchor = stack[sp - 1].anchor;
+        uint64_t pending = stack[sp - 1].pending;
+        if (listener) {
+          if (listener->enterNonTerminal)
+            listener->enterNonTerminal(listener->ctx, A, e->rule);
+          stack[sp].symbol = PACKED_RULE_END;
+          stack[sp].parent = PT_NONE;
+          stack[sp].rule = e->rule;
+          stack[sp].anchor = anchor;
+          stack[sp].pending = pending;
+          sp++;
+        } else if (p->epsilonLeaf) {
+          createNode(PT, unpackSymbol(TK_EPSILON), tn);
+        }
+        for (int k = 0; k < p->count; k++, sp++) {
+          stack[sp].symbol = p->symbol[k];
+          stack[sp].parent = tn;
+          stack[sp].rule = NULL;
+          stack[sp].anchor = p->anchor[k] | anchor;
+          stack[sp].pending = p->pending[k] | pending;
+        }
+      } else if (listener) {
+        if (listener->enterNonTerminal)
+          listener->enterNonTerminal(listener->ctx, A, NULL);
+        if (listener->exitNonTerminal)
+          listener->exitNonTerminal(listener->ctx, A, NULL);
+      }
+    }
+  }
+
+  while (sp > 0) {
+    const stackNode *n = &stack[--sp];
+    int isEnd = n->symbol == TK_EOF;
+    if (!listener) {
+      if (!isEnd)
+        createNode(PT, unpackSymbol(n->symbol), n->parent);
+    } else if (n->symbol == PACKED_RULE_END) {
+      if (listener->exitNonTerminal)
+        listener->exitNonTerminal(listener->ctx, n->rule->lhs, n->rule);
+    } else if (n->symbol >= CT_NT_BASE) {
+      NonTerminal A = (NonTerminal)(n->symbol - CT_NT_BASE);
+      if (listener->enterNonTerminal)
+        listener->enterNonTerminal(listener->ctx, A, NULL);
+      if (listener->exitNonTerminal)
+        listener->exitNonTerminal(listener->ctx, A, NULL);
+    } else if (!isEnd && listener->matchTerminal) {
+      listener->matchTerminal(listener->ctx, (TokenType)n->symbol, NULL);
+    }
+  }
+  free(stack);
+  if (!listener)
+    computeSubtreeEnds(PT);
+
+  return ps->syntaxOK && ps->errorCount == 0;
+}
+
+static int runParserOnFile(char *testcaseFile, const table *T,
+                           const grammar *G, parseTree *PT,
+                           parseListener *listener, parseDiagnostics *D) {
+  FILE *fp = fopen(testcaseFile, "r");
+  if (!fp) {
+    fprintf(stderr, "Error: Cannot open %s\n", testcaseFile);
+    return -1;
+  }
+
+  parserState ps;
+  initParserState(&ps, PT, listener);
+  ps.diag = D;
+  ps.tb = initializeTwinBuffer(fp);
+  int ok = runParser(&ps, T, G->startSymbol);
+  freeTwinBuffer(ps.tb);
+  return ok;
 }
 
 parseTree *parseInputSourceCode(char *testcaseFile, table *T, grammar *G) {
+  parseTree *PT = (parseTree *)calloc(1, sizeof(parseTree));
+  if (!PT) {
+    fprintf(stderr, "calloc failed for parseTree\n");
+    exit(1);
+  }
+
+  int ok = runParserOnFile(testcaseFile, T, G, PT, NULL, NULL);
+  if (ok < 0) {
+    free(PT);
+    return NULL;
+  }
+  if (ok) {
+    printf("Input source code is syntactically correct...........\n");
+  }
+
+  return PT;
+}
+
+parseTree *parseInputSourceCodeFlat(char *testcaseFile, table *T,
+                                    grammar *G) {
   FILE *fp = fopen(testcaseFile, "r");
   if (!fp) {
     fprintf(stderr, "Error: Cannot open %s\n", testcaseFile);
     return NULL;
   }
+  parseTree *PT = (parseTree *)calloc(1, sizeof(parseTree));
+  if (!PT) {
+    fprintf(stderr, "calloc failed for parseTree\n");
+    exit(1);
+  }
 
-  twinBuffer *tb = initializeTwinBuffer(fp);
+  parserState ps;
+  initParserState(&ps, PT, NULL);
+  ps.tb = initializeTwinBuffer(fp);
+  ps.flatExpressions = 1;
+  int ok = runParser(&ps, T, G->startSymbol);
+  freeTwinBuffer(ps.tb);
+  freeExprScratch(ps.expr);
+  if (ok)
+    printf("Input source code is syntactically correct...........\n");
+  return PT;
+}
+
+parseTree *parseInputSourceCodeBounded(char *testcaseFile, table *T,
+                                       grammar *G, functionConsumer *C) {
+  FILE *fp = fopen(testcaseFile, "r");
+  if (!fp) {
+    fprintf(stderr, "Error: Cannot open %s\n", testcaseFile);
+    return NULL;
+  }
   parseTree *PT = (parseTree *)calloc(1, sizeof(parseTree));
   if (!PT) {
     fprintf(stderr, "calloc failed for parseTree\n");
     exit(1);
   }
 
-  GrammarSymbol start;
-  start.type = SYMBOL_NON_TERMINAL;
-  start.symbol.nonTerminal = G->startSymbol;
-  PT->root = createNode(start);
+  parserState ps;
+  initParserState(&ps, PT, NULL);
+  ps.tb = initializeTwinBuffer(fp);
+  ps.consumer = C;
+  int ok = runParser(&ps, T, G->startSymbol);
+  freeTwinBuffer(ps.tb);
+  if (ok)
+    printf("Input source code is syntactically correct...........\n");
+  return PT;
+}
 
-  stackNode *stack = NULL;
-  GrammarSymbol dollar;
-  dollar.type = SYMBOL_TERMINAL;
-  dollar.symbol.terminal = TK_EOF;
-  push(&stack, dollar, NULL);
-  push(&stack, start, PT->root);
+int parseInputSourceCodeStreaming(char *testcaseFile, table *T, grammar *G,
+                                  parseListener *listener) {
+  return runParserOnFile(testcaseFile, T, G, NULL, listener, NULL);
+}
 
-  int errorCount = 0;
-  int syntaxOK = 1;
-  tokenInfo cur = nextMeaningfulToken(tb, &errorCount, &syntaxOK);
+int parseIntoTree(char *testcaseFile, const table *T, const grammar *G,
+                  parseTree *PT, parseDiagnostics *D) {
+  return runParserOnFile(testcaseFile, T, G, PT, NULL, D);
+}
 
-  int lastErrorLine = -1;
+parseTree *parseInputSourceCodePipelined(char *testcaseFile, table *T,
+                                         grammar *G) {
+  FILE *fp = fopen(testcaseFile, "r");
+  if (!fp) {
+    fprintf(stderr, "Error: Cannot open %s\n", testcaseFile);
+    return NULL;
+  }
+  parseTree *PT = (parseTree *)calloc(1, sizeof(parseTree));
+  if (!PT) {
+    fprintf(stderr, "calloc failed for parseTree\n");
+    exit(1);
+  }
 
-  while (stack != NULL && errorCount < 60) {
-    stackNode *topNode = pop(&stack);
-    GrammarSymbol X = topNode->symbol;
-    parseTreeNode *tn = topNode->treeNode;
-    free(topNode);
+  parserState ps;
+  initParserState(&ps, PT, NULL);
+  ps.pipe = startTokenPipe(fp);
+  int ok = runParser(&ps, T, G->startSymbol);
+  stopTokenPipe(ps.pipe);
+  if (ok)
+    printf("Input source code is syntactically correct...........\n");
+  return PT;
+}
 
-    if (X.type == SYMBOL_TERMINAL && X.symbol.terminal == TK_EPSILON)
+/* ---- Parallel parsing of function definitions ---- */
+
+typedef struct {
+  uint32_t first;
+  uint32_t end;
+  NonTerminal start;
+  parseTree tree;
+  int ok;
+  int cached;         /* tree.nodes is borrowed from a subtreeCache */
+  uint32_t tokenBase; /* added to tree token indices when splicing */
+} functionSpan;
+
+typedef struct {
+  const parseTree *stream;
+  table *T;
+  functionSpan *spans;
+  uint32_t spanCount;
+  atomic_uint next;
+} parallelJob;
+
+static int lexWholeFile(char *testcaseFile, parseTree *stream) {
+  FILE *fp = fopen(testcaseFile, "r");
+  if (!fp) {
+    fprintf(stderr, "Error: Cannot open %s\n", testcaseFile);
+    return -1;
+  }
+  twinBuffer *tb = initializeTwinBuffer(fp);
+  tokenInfo tk;
+  int clean = 1;
+  do {
+    scanNextToken(tb, &tk);
+    if (tk.tokenType == TK_COMMENT)
       continue;
+    if (tk.tokenType == TK_ERROR) {
+      clean = 0;
+      break;
+    }
+    addParseToken(stream, &tk);
+  } while (tk.tokenType != TK_EOF);
+  freeTwinBuffer(tb);
+  return clean;
+}
 
-    if (X.type == SYMBOL_TERMINAL && X.symbol.terminal == TK_EOF) {
-      if (cur.tokenType != TK_EOF) {
-        if (cur.lineNumber != lastErrorLine) {
-          fprintf(stderr,
-                  "Line %d\tError: Unexpected token %s encountered at end\n",
-                  cur.lineNumber, getTokenName(cur.tokenType));
-          lastErrorLine = cur.lineNumber;
-          errorCount++;
-          syntaxOK = 0;
-        }
-      }
+/* Splits the token stream into function spans: each starts at a TK_FUNID
+   and runs to the first TK_END, followed by one TK_MAIN span that must be
+   the last thing before TK_EOF. Returns the number of spans, or 0 if the
+   stream does not have that shape. */
+static uint32_t findFunctionSpans(const parseTree *stream,
+                                  functionSpan **out) {
+  uint32_t count = 0, cap = 0;
+  functionSpan *spans = NULL;
+  uint32_t i = 0, n = stream->tokenCount;
+  while (i < n && stream->tokens[i].tokenType != TK_EOF) {
+    TokenType t = stream->tokens[i].tokenType;
+    if (t != TK_FUNID && t != TK_MAIN)
+      break;
+    uint32_t j = i + 1;
+    while (j < n && stream->tokens[j].tokenType != TK_END &&
+           stream->tokens[j].tokenType != TK_EOF)
+      j++;
+    if (j >= n || stream->tokens[j].tokenType != TK_END)
+      break;
+    spans = growArray(spans, &cap, count + 1, sizeof(functionSpan),
+                      "function spans");
+    memset(&spans[count], 0, sizeof(functionSpan));
+    spans[count].first = i;
+    spans[count].end = j + 1;
+    spans[count].start = t == TK_MAIN ? NT_MAINFUNCTION : NT_FUNCTION;
+    count++;
+    i = j + 1;
+    if (t == TK_MAIN)
+      break;
+  }
+  if (count == 0 || spans[count - 1].start != NT_MAINFUNCTION ||
+      i >= n || stream->tokens[i].tokenType != TK_EOF) {
+    free(spans);
+    return 0;
+  }
+  *out = spans;
+  return count;
+}
+
+static void *parseSpansWorker(void *arg) {
+  parallelJob *job = (parallelJob *)arg;
+  parseDiagnostics silent = {NULL, 0, 0};
+  for (;;) {
+    uint32_t k = atomic_fetch_add(&job->next, 1);
+    if (k >= job->spanCount)
       break;
+    functionSpan *span = &job->spans[k];
+    parserState ps;
+    initParserState(&ps, &span->tree, NULL);
+    ps.stream = job->stream;
+    ps.streamPos = span->first;
+    ps.streamEnd = span->end;
+    ps.diag = &silent;
+    silent.count = 0;
+    span->ok = runParser(&ps, job->T, span->start);
+  }
+  freeDiagnostics(&silent);
+  return NULL;
+}
+
+static uint32_t appendSpliceNode(parseTree *PT, uint8_t type, uint8_t id,
+                                 uint32_t parent) {
+  uint32_t idx = PT->nodeCount++;
+  parseTreeNode *n = &PT->nodes[idx];
+  n->symbolType = type;
+  n->symbolId = id;
+  n->childCount = 0;
+  n->parent = parent;
+  n->subtreeEnd = idx + 1;
+  n->token = PT_NONE;
+  if (parent != PT_NONE)
+    PT->nodes[parent].childCount++;
+  return idx;
+}
+
+static void appendSubtree(parseTree *PT, const parseTree *sub,
+                          uint32_t parent, uint32_t tokenBase) {
+  uint32_t base = PT->nodeCount;
+  memcpy(PT->nodes + base, sub->nodes, sub->nodeCount * sizeof(parseTreeNode));
+  for (uint32_t i = 0; i < sub->nodeCount; i++) {
+    parseTreeNode *n = &PT->nodes[base + i];
+    n->parent = n->parent == PT_NONE ? parent : n->parent + base;
+    n->subtreeEnd += base;
+    if (n->token != PT_NONE)
+      n->token += tokenBase;
+  }
+  PT->nodes[parent].childCount++;
+  PT->nodeCount += sub->nodeCount;
+}
+
+/* Rebuilds the derivation program -> otherFunctions mainFunction with
+   otherFunctions -> function otherFunctions | eps around the per-function
+   subtrees, in the same preorder the sequential parser produces. */
+static void spliceFunctions(parseTree *PT, functionSpan *spans,
+                            uint32_t count) {
+  uint32_t total = 2 * count + 1;
+  for (uint32_t k = 0; k < count; k++)
+    total += spans[k].tree.nodeCount;
+  PT->nodes = growArray(PT->nodes, &PT->nodeCapacity, total,
+                        sizeof(parseTreeNode), "parse tree nodes");
+
+  uint32_t program = appendSpliceNode(PT, SYMBOL_NON_TERMINAL, NT_PROGRAM,
+                                      PT_NONE);
+  uint32_t chain = program;
+  for (uint32_t k = 0; k + 1 < count; k++) {
+    chain = appendSpliceNode(PT, SYMBOL_NON_TERMINAL, NT_OTHERFUNCTIONS, chain);
+    appendSubtree(PT, &spans[k].tree, chain, spans[k].tokenBase);
+  }
+  chain = appendSpliceNode(PT, SYMBOL_NON_TERMINAL, NT_OTHERFUNCTIONS, chain);
+  appendSpliceNode(PT, SYMBOL_TERMINAL, TK_EPSILON, chain);
+  appendSubtree(PT, &spans[count - 1].tree, program,
+                spans[count - 1].tokenBase);
+  computeSubtreeEnds(PT);
+}
+
+parseTree *parseInputSourceCodeParallel(char *testcaseFile, table *T,
+                                        grammar *G, int threads) {
+  parseTree *PT = (parseTree *)calloc(1, sizeof(parseTree));
+  if (!PT) {
+    fprintf(stderr, "calloc failed for parseTree\n");
+    exit(1);
+  }
+  int lexOK = lexWholeFile(testcaseFile, PT);
+  if (lexOK < 0) {
+    free(PT);
+    return NULL;
+  }
+
+  functionSpan *spans = NULL;
+  uint32_t count = lexOK ? findFunctionSpans(PT, &spans) : 0;
+  if (threads <= 0) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = n > 0 ? (int)n : 1;
+  }
+  if ((uint32_t)threads > count)
+    threads = (int)count;
+
+  int ok = count > 0;
+  if (ok) {
+    parallelJob job;
+    job.stream = PT;
+    job.T = T;
+    job.spans = spans;
+    job.spanCount = count;
+    atomic_init(&job.next, 0);
+
+    pthread_t *workers = (pthread_t *)malloc((size_t)threads * sizeof(pthread_t));
+    if (!workers) {
+      fprintf(stderr, "malloc failed for worker threads\n");
+      exit(1);
     }
+    int started = 0;
+    for (int i = 1; i < threads; i++)
+      if (pthread_create(&workers[started], NULL, parseSpansWorker, &job) == 0)
+        started++;
+    parseSpansWorker(&job);
+    for (int i = 0; i < started; i++)
+      pthread_join(workers[i], NULL);
+    free(workers);
+
+    for (uint32_t k = 0; k < count; k++)
+      ok = ok && spans[k].ok;
+    if (ok)
+      spliceFunctions(PT, spans, count);
+  }
 
-    if (X.type == SYMBOL_TERMINAL) {
-      if (X.symbol.terminal == cur.tokenType) {
-        if (tn) {
-          tn->token = cur;
-          tn->isLeaf = 1;
-        }
-        cur = nextMeaningfulToken(tb, &errorCount, &syntaxOK);
-      } else {
-     
-        if (cur.lineNumber != lastErrorLine) {
-          fprintf(stderr,
-                  "Line %d\tError: The token %s for lexeme %s  does not match "
-                  "with the expected token %s\n",
-                  cur.lineNumber, getTokenName(cur.tokenType), cur.lexeme,
-                  getTokenName(X.symbol.terminal));
-          lastErrorLine = cur.lineNumber;
-          errorCount++;
-          syntaxOK = 0;
-        }
-      }
-    } else {
-      NonTerminal A = X.symbol.nonTerminal;
-      int a = (int)cur.tokenType;
+  for (uint32_t k = 0; k < count; k++)
+    free(spans[k].tree.nodes);
+  free(spans);
 
-      if (a >= 0 && a < TABLE_TERMINALS && T->entries[A][a].isValid) {
-        GrammarRule *rule = T->entries[A][a].rule;
-        parseTreeNode *children[MAX_RHS];
-        int nc = 0;
+  if (!ok) {
+    /* Lexical or syntax errors (or an unexpected top-level shape): rerun
+       sequentially so diagnostics and recovery match the normal path. */
+    freeParseTree(PT);
+    return parseInputSourceCode(testcaseFile, T, G);
+  }
 
-        for (int i = 0; i < rule->rhsCount; i++) {
-          children[nc] = createNode(rule->rhs[i]);
-          nc++;
-        }
-        for (int i = 0; i < nc; i++)
-          addChild(tn, children[i]);
+  printf("Input source code is syntactically correct...........\n");
+  return PT;
+}
 
-        for (int i = nc - 1; i >= 0; i--)
-          push(&stack, rule->rhs[i], children[i]);
 
-      } else {
-        if (cur.tokenType != TK_EOF && cur.lineNumber != lastErrorLine) {
-          fprintf(stderr,
-                  "Line %d\tError: Invalid token %s encountered with value %s "
-                  "stack top %s\n",
-                  cur.lineNumber, getTokenName(a), cur.lexeme,
-                  getNonTerminalName(A) + 1); 
-          lastErrorLine = cur.lineNumber;
-          errorCount++;
-          syntaxOK = 0;
-        }
+/* ---- Incremental reparsing with a function subtree cache ---- */
 
-        if (!isSyncToken(cur.tokenType)) {
-          while (cur.tokenType != TK_EOF && !isSyncToken(cur.tokenType)) {
-            cur = nextMeaningfulToken(tb, &errorCount, &syntaxOK);
-          }
-        }
-      }
+/* A span's subtree depends only on its token types, so that is the key;
+   lexemes, values and line numbers are read from the new token stream. */
+static uint64_t spanHash(const parseTree *stream, const functionSpan *span) {
+  uint64_t h = FNV1A_BASIS;
+  for (uint32_t i = span->first; i < span->end; i++) {
+    uint8_t type = (uint8_t)stream->tokens[i].tokenType;
+    h = fnv1a(&type, 1, h);
+  }
+  return h ^ (span->end - span->first);
+}
+
+static int cacheEntryMatches(const subtreeCacheEntry *e, uint64_t hash,
+                             const parseTree *stream,
+                             const functionSpan *span) {
+  if (e->hash != hash || e->tokenCount != span->end - span->first)
+    return 0;
+  for (uint32_t i = 0; i < e->tokenCount; i++)
+    if (e->types[i] != (uint8_t)stream->tokens[span->first + i].tokenType)
+      return 0;
+  return 1;
+}
+
+/* Open addressing; slots[] holds entry index + 1, 0 for empty. */
+static void cacheRehash(subtreeCache *C) {
+  uint32_t cap = 64;
+  while (cap < 2 * C->count + 2)
+    cap *= 2;
+  free(C->slots);
+  C->slots = (uint32_t *)calloc(cap, sizeof(uint32_t));
+  if (!C->slots) {
+    fprintf(stderr, "calloc failed for subtree cache\n");
+    exit(1);
+  }
+  C->slotCount = cap;
+  for (uint32_t i = 0; i < C->count; i++) {
+    uint32_t s = (uint32_t)C->entries[i].hash & (cap - 1);
+    while (C->slots[s])
+      s = (s + 1) & (cap - 1);
+    C->slots[s] = i + 1;
+  }
+}
+
+static subtreeCacheEntry *cacheFind(subtreeCache *C, uint64_t hash,
+                                    const parseTree *stream,
+                                    const functionSpan *span) {
+  if (!C->slotCount)
+    return NULL;
+  uint32_t s = (uint32_t)hash & (C->slotCount - 1);
+  for (; C->slots[s]; s = (s + 1) & (C->slotCount - 1)) {
+    subtreeCacheEntry *e = &C->entries[C->slots[s] - 1];
+    if (cacheEntryMatches(e, hash, stream, span))
+      return e;
+  }
+  return NULL;
+}
+
+static void cacheInsert(subtreeCache *C, uint64_t hash,
+                        const parseTree *stream, functionSpan *span) {
+  C->entries = growArray(C->entries, &C->capacity, C->count + 1,
+                         sizeof(subtreeCacheEntry), "subtree cache");
+  subtreeCacheEntry *e = &C->entries[C->count++];
+  e->hash = hash;
+  e->tokenCount = span->end - span->first;
+  e->generation = C->generation;
+  e->types = (uint8_t *)malloc(e->tokenCount);
+  if (!e->types) {
+    fprintf(stderr, "malloc failed for subtree cache\n");
+    exit(1);
+  }
+  for (uint32_t i = 0; i < e->tokenCount; i++)
+    e->types[i] = (uint8_t)stream->tokens[span->first + i].tokenType;
+  /* Keep token indices relative to the span so the entry fits wherever the
+     function lands in a later version of the file. */
+  for (uint32_t i = 0; i < span->tree.nodeCount; i++)
+    if (span->tree.nodes[i].token != PT_NONE)
+      span->tree.nodes[i].token -= span->first;
+  e->nodes = span->tree.nodes;
+  e->nodeCount = span->tree.nodeCount;
+  span->cached = 1;
+  if (2 * C->count + 2 > C->slotCount)
+    cacheRehash(C);
+  else {
+    uint32_t s = (uint32_t)hash & (C->slotCount - 1);
+    while (C->slots[s])
+      s = (s + 1) & (C->slotCount - 1);
+    C->slots[s] = C->count;
+  }
+}
+
+/* Drops entries no function of the latest parse used. */
+static void cacheEvict(subtreeCache *C) {
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < C->count; i++) {
+    subtreeCacheEntry *e = &C->entries[i];
+    if (e->generation != C->generation) {
+      free(e->types);
+      free(e->nodes);
+      continue;
     }
+    C->entries[kept++] = *e;
   }
+  if (kept != C->count) {
+    C->count = kept;
+    cacheRehash(C);
+  }
+}
 
-  while (stack) {
-    stackNode *n = pop(&stack);
-    free(n);
+subtreeCache *createSubtreeCache(void) {
+  subtreeCache *C = (subtreeCache *)calloc(1, sizeof(subtreeCache));
+  if (!C) {
+    fprintf(stderr, "calloc failed for subtree cache\n");
+    exit(1);
   }
+  return C;
+}
 
-  freeTwinBuffer(tb);
+void freeSubtreeCache(subtreeCache *C) {
+  if (!C)
+    return;
+  for (uint32_t i = 0; i < C->count; i++) {
+    free(C->entries[i].types);
+    free(C->entries[i].nodes);
+  }
+  free(C->entries);
+  free(C->slots);
+  free(C);
+}
 
-  if (syntaxOK && errorCount == 0) {
-    printf("Input source code is syntactically correct...........\n");
+parseTree *parseInputSourceCodeIncremental(char *testcaseFile, table *T,
+                                           grammar *G, subtreeCache *C) {
+  parseTree *PT = (parseTree *)calloc(1, sizeof(parseTree));
+  if (!PT) {
+    fprintf(stderr, "calloc failed for parseTree\n");
+    exit(1);
+  }
+  int lexOK = lexWholeFile(testcaseFile, PT);
+  if (lexOK < 0) {
+    free(PT);
+    return NULL;
   }
 
+  functionSpan *spans = NULL;
+  uint32_t count = lexOK ? findFunctionSpans(PT, &spans) : 0;
+  int ok = count > 0;
+  C->generation++;
+  C->hits = C->misses = 0;
+
+  parseDiagnostics silent = {NULL, 0, 0};
+  for (uint32_t k = 0; k < count; k++) {
+    functionSpan *span = &spans[k];
+    uint64_t h = spanHash(PT, span);
+    span->tokenBase = span->first;
+    subtreeCacheEntry *e = cacheFind(C, h, PT, span);
+    if (e) {
+      e->generation = C->generation;
+      span->tree.nodes = e->nodes;
+      span->tree.nodeCount = e->nodeCount;
+      span->cached = 1;
+      C->hits++;
+      continue;
+    }
+    parserState ps;
+    initParserState(&ps, &span->tree, NULL);
+    ps.stream = PT;
+    ps.streamPos = span->first;
+    ps.streamEnd = span->end;
+    ps.diag = &silent;
+    silent.count = 0;
+    C->misses++;
+    /* Keep going after a failure so the cache stays warm for the rest. */
+    if (runParser(&ps, T, span->start))
+      cacheInsert(C, h, PT, span);
+    else
+      ok = 0;
+  }
+  freeDiagnostics(&silent);
+
+  if (ok)
+    spliceFunctions(PT, spans, count);
+  for (uint32_t k = 0; k < count; k++)
+    if (!spans[k].cached)
+      free(spans[k].tree.nodes);
+  free(spans);
+  if (count > 0)
+    cacheEvict(C);
+
+  if (!ok) {
+    /* Same fallback as the parallel parser: errors are reported by a full
+       sequential parse. The cache keeps the functions that did parse. */
+    freeParseTree(PT);
+    return parseInputSourceCode(testcaseFile, T, G);
+  }
+
+  printf("Input source code is syntactically correct...........\n");
   return PT;
 }
 
-static void printInorder(parseTreeNode *node, FILE *fp) {
-  if (!node)
+void createCompactTable(table *T, grammar *G, compactTable *CT) {
+  for (int i = 0; i < (int)NT_COUNT; i++)
+    for (int j = 0; j < TABLE_TERMINALS; j++)
+      CT->rule[i][j] =
+          T->entries[i][j].isValid ? (int16_t)(T->entries[i][j].rule - G->rules)
+                                   : -1;
+
+  for (int r = 0; r < G->ruleCount; r++) {
+    const packedRule *p = &T->packed[G->rules[r].ruleNumber - 1];
+    memcpy(CT->rhs[r], p->symbol, p->count);
+    CT->rhsCount[r] = p->count;
+  }
+  CT->startSymbol = (uint8_t)(CT_NT_BASE + G->startSymbol);
+
+  for (int t = 0; t < CT_NT_BASE; t++)
+    CT->first[t] = t == TK_EPSILON ? 0 : TERMINAL_BIT(t);
+  for (int i = 0; i < (int)NT_COUNT; i++) {
+    CT->first[CT_NT_BASE + i] = T->firstMask[i];
+    CT->follow[i] = T->followMask[i];
+  }
+}
+
+static void addDiagnostic(parseDiagnostics *D, int line, const char *fmt,
+                          ...) {
+  if (!D || D->count >= MAX_PARSE_ERRORS)
     return;
+  if (D->count == D->capacity) {
+    int cap = D->capacity ? D->capacity * 2 : 16;
+    parseDiagnostic *p =
+        (parseDiagnostic *)realloc(D->items, (size_t)cap * sizeof(*p));
+    if (!p) {
+      fprintf(stderr, "realloc failed for diagnostics\n");
+      exit(1);
+    }
+    D->items = p;
+    D->capacity = cap;
+  }
+  parseDiagnostic *d = &D->items[D->count++];
+  d->lineNumber = line;
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(d->message, sizeof(d->message), fmt, ap);
+  va_end(ap);
+}
 
-  char parentStr[64];
-  if (node->parent == NULL) {
-    strcpy(parentStr, "ROOT");
-  } else if (node->parent->symbol.type == SYMBOL_NON_TERMINAL) {
-    const char *full =
-        getNonTerminalName(node->parent->symbol.symbol.nonTerminal);
-    int len = (int)strlen(full);
+int checkSyntax(char *testcaseFile, const compactTable *CT,
+                parseDiagnostics *D) {
+  FILE *fp = fopen(testcaseFile, "r");
+  if (!fp) {
+    fprintf(stderr, "Error: Cannot open %s\n", testcaseFile);
+    return -1;
+  }
+  twinBuffer *tb = initializeTwinBuffer(fp);
+
+  compactStack S;
+  initCompactStack(&S, CT, 0);
+
+  /* Diagnostics are dropped when D is NULL; reportError would print
+     them, so collect into a scratch list instead. */
+  parseDiagnostics scratch = {NULL, 0, 0};
+  parserState ps;
+  initParserState(&ps, NULL, NULL);
+  ps.diag = D ? D : &scratch;
+  ps.tb = tb;
+  nextMeaningfulToken(&ps);
+
+  while (S.count > 0) {
+    uint32_t sp = --S.count;
+    int X = S.symbol[sp];
+    int a = (int)ps.curType;
+
+    if (X < CT_NT_BASE) {
+      if (X == TK_EOF) {
+        if (a != TK_EOF && ps.curLine != ps.lastErrorLine)
+          reportError(&ps, ps.curLine,
+                      "Unexpected token %s encountered at end",
+                      getTokenName((TokenType)a));
+        break;
+      }
+      if (recoverTerminal(&ps, (TokenType)X, S.anchor[sp - 1],
+                          S.pending[sp - 1])) {
+        if (ps.quiet)
+          ps.quiet--;
+        nextMeaningfulToken(&ps);
+      }
+      continue;
+    }
+
+    int A = X - CT_NT_BASE;
+    int r = CT->rule[A][a];
+    if (r < 0) {
+      reportNoRule(&ps, ps.curLine, ps.curType, ps.curLexeme,
+                   (NonTerminal)A);
+      uint64_t stop = CT->first[X] | CT->follow[A] | S.anchor[sp - 1];
+      while (ps.curType != TK_EOF && !(stop & TERMINAL_BIT(ps.curType)))
+        nextMeaningfulToken(&ps);
+      r = CT->rule[A][ps.curType];
+      if (r < 0)
+        continue;
+    }
+    pushCompactRule(&S, CT, r, PT_NONE);
+  }
+
+  freeCompactStack(&S);
+  freeTwinBuffer(tb);
+  freeDiagnostics(&scratch);
+  return ps.errorCount == 0;
+}
+
+void initCompactStack(compactStack *S, const compactTable *CT,
+                      int withParents) {
+  memset(S, 0, sizeof(*S));
+  growCompactStack(S, 256);
+  if (withParents) {
+    S->parent = (uint32_t *)malloc(S->capacity * sizeof(uint32_t));
+    if (!S->parent) {
+      fprintf(stderr, "malloc failed for parser stack\n");
+      exit(1);
+    }
+    S->parent[0] = S->parent[1] = PT_NONE;
+  }
+  S->symbol[0] = (uint8_t)TK_EOF;
+  S->anchor[0] = S->pending[0] = TERMINAL_BIT(TK_EOF);
+  S->symbol[1] = CT->startSymbol;
+  S->anchor[1] = CT->first[CT->startSymbol] | S->anchor[0];
+  S->pending[1] = S->pending[0];
+  S->count = 2;
+}
+
+void growCompactStack(compactStack *S, uint32_t needed) {
+  uint32_t cap = S->capacity ? S->capacity : 256;
+  while (cap < needed)
+    cap *= 2;
+  int withParents = S->parent != NULL;
+  S->symbol = (uint8_t *)realloc(S->symbol, cap);
+  S->anchor = (uint64_t *)realloc(S->anchor, cap * sizeof(uint64_t));
+  S->pending = (uint64_t *)realloc(S->pending, cap * sizeof(uint64_t));
+  if (withParents)
+    S->parent = (uint32_t *)realloc(S->parent, cap * sizeof(uint32_t));
+  if (!S->symbol || !S->anchor || !S->pending ||
+      (withParents && !S->parent)) {
+    fprintf(stderr, "realloc failed for parser stack\n");
+    exit(1);
+  }
+  S->capacity = cap;
+}
+
+void freeCompactStack(compactStack *S) {
+  free(S->symbol);
+  free(S->anchor);
+  free(S->pending);
+  free(S->parent);
+}
+
+void printDiagnostics(parseDiagnostics *D, FILE *out, const char *prefix) {
+  for (int i = 0; i < D->count; i++)
+    fprintf(out, "%s%sLine %d\tError: %s\n", prefix ? prefix : "",
+            prefix ? ": " : "", D->items[i].lineNumber, D->items[i].message);
+}
+
+void freeDiagnostics(parseDiagnostics *D) {
+  free(D->items);
+  D->items = NULL;
+  D->count = D->capacity = 0;
+}
+
+/* ---- Parse tree serializer ---- */
+
+#define TW_BUFFER_SIZE (1u << 20)
+#define TW_LINE_MAX (MAX_LEXEME_LENGTH + 512)
+#define TW_WINDOW 8
+
+typedef struct {
+  const char *text;
+  uint8_t len;
+} twName;
+
+/* Stripped symbol names, built once per serialization and shared read-only
+   by the rendering threads. */
+typedef struct {
+  twName terminal[TK_EPSILON + 1];
+  twName nonTerminal[NT_COUNT];
+  char ntText[NT_COUNT][64];
+} twNames;
+
+typedef struct {
+  char *data;
+  size_t len;
+  size_t cap;
+  FILE *fp; /* flushed to fp when full; NULL grows the buffer instead */
+} twBuffer;
+
+static void buildTreeNames(twNames *N) {
+  for (int t = 0; t <= TK_EPSILON; t++) {
+    N->terminal[t].text = getTokenName((TokenType)t);
+    N->terminal[t].len = (uint8_t)strlen(N->terminal[t].text);
+  }
+  for (int nt = 0; nt < NT_COUNT; nt++) {
+    const char *full = getNonTerminalName((NonTerminal)nt);
+    size_t len = strlen(full);
     if (len >= 2 && full[0] == '<' && full[len - 1] == '>') {
-      strncpy(parentStr, full + 1, len - 2);
-      parentStr[len - 2] = '\0';
-    } else {
-      strncpy(parentStr, full, 63);
-      parentStr[63] = '\0';
+      full++;
+      len -= 2;
     }
-  } else {
-    strncpy(parentStr, getTokenName(node->parent->symbol.symbol.terminal), 63);
-    parentStr[63] = '\0';
+    if (len > 63)
+      len = 63;
+    memcpy(N->ntText[nt], full, len);
+    N->ntText[nt][len] = '\0';
+    N->nonTerminal[nt].text = N->ntText[nt];
+    N->nonTerminal[nt].len = (uint8_t)len;
   }
+}
 
-  if (node->isLeaf || node->childCount == 0) {
-    char valueStr[32];
-    if (node->token.tokenType == TK_NUM && node->token.hasValue)
-      snprintf(valueStr, sizeof(valueStr), "%d", node->token.value.intValue);
-    else if (node->token.tokenType == TK_RNUM && node->token.hasValue)
-      snprintf(valueStr, sizeof(valueStr), "%.2f", node->token.value.realValue);
-    else
-      strcpy(valueStr, "----");
+static const twName *symbolName(const twNames *N, const parseTreeNode *n) {
+  return n->symbolType == SYMBOL_NON_TERMINAL ? &N->nonTerminal[n->symbolId]
+                                              : &N->terminal[n->symbolId];
+}
 
-    const char *lex =
-        (node->token.lexeme[0] != '\0') ? node->token.lexeme : "----";
+static void twReserve(twBuffer *B, size_t need) {
+  if (B->len + need <= B->cap)
+    return;
+  if (B->fp && B->len) {
+    fwrite(B->data, 1, B->len, B->fp);
+    B->len = 0;
+    if (need <= B->cap)
+      return;
+  }
+  size_t cap = B->cap ? B->cap : TW_BUFFER_SIZE;
+  while (cap < B->len + need)
+    cap *= 2;
+  char *data = (char *)realloc(B->data, cap);
+  if (!data) {
+    fprintf(stderr, "realloc failed for parse tree output\n");
+    exit(1);
+  }
+  B->data = data;
+  B->cap = cap;
+}
+
+/* Appends s left-aligned in a field of at least width bytes, followed by
+   the two-space column separator (printf "%-*s  "). */
+static char *twField(char *p, const char *s, size_t len, size_t width) {
+  memcpy(p, s, len);
+  p += len;
+  while (len++ < width)
+    *p++ = ' ';
+  p[0] = ' ';
+  p[1] = ' ';
+  return p + 2;
+}
 
-    const char *currentNode = getTokenName(node->token.tokenType);
+static size_t formatInt(char *out, long long v) {
+  char tmp[24];
+  size_t n = 0, len = 0;
+  unsigned long long u = v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+  do {
+    tmp[n++] = (char)('0' + u % 10);
+    u /= 10;
+  } while (u);
+  if (v < 0)
+    out[len++] = '-';
+  while (n)
+    out[len++] = tmp[--n];
+  return len;
+}
 
-    fprintf(fp, "%-20s  %-30s  %-6d  %-22s  %-12s  %-30s  %-5s  %-s\n", lex,
-            currentNode, node->token.lineNumber,
-            getTokenName(node->token.tokenType), valueStr, parentStr, "yes",
-            "----");
+/* "%.2f" without printf. Values near a rounding tie, or too large to scale
+   exactly, go through snprintf so the digits always match it. */
+static size_t formatReal2(char *out, double v) {
+  double scaled = v < 0 ? -v * 100.0 : v * 100.0;
+  double frac = scaled - floor(scaled);
+  if (!(scaled < 1e9) || fabs(frac - 0.5) < 1e-6) {
+    int n = snprintf(out, 32, "%.2f", v);
+    return n < 32 ? (size_t)n : 31; /* same truncation as valueStr[32] */
+  }
+  long long cents = (long long)floor(scaled) + (frac > 0.5);
+  size_t len = 0;
+  if (signbit(v))
+    out[len++] = '-';
+  len += formatInt(out + len, cents / 100);
+  out[len++] = '.';
+  out[len++] = (char)('0' + (cents / 10) % 10);
+  out[len++] = (char)('0' + cents % 10);
+  return len;
+}
+
+static void writeTreeLine(twBuffer *B, const twNames *N, const parseTree *PT,
+                          uint32_t idx) {
+  static const twName root = {"ROOT", 4};
+  static const parseToken noToken;
+  const parseTreeNode *node = &PT->nodes[idx];
+  const twName *parent =
+      node->parent == PT_NONE ? &root : symbolName(N, &PT->nodes[node->parent]);
+
+  twReserve(B, TW_LINE_MAX);
+  char *p = B->data + B->len;
+  char num[32];
+  size_t numLen;
+
+  if (node->symbolType == SYMBOL_TERMINAL || node->childCount == 0) {
+    const parseToken *tk =
+        node->token != PT_NONE ? &PT->tokens[node->token] : &noToken;
+    const char *lex = node->token != PT_NONE ? PT->lexemes + tk->lexeme : "";
+    if (lex[0] == '\0')
+      lex = "----";
+    const twName *tn = &N->terminal[tk->tokenType];
+
+    p = twField(p, lex, strlen(lex), 20);
+    p = twField(p, tn->text, tn->len, 30);
+    numLen = formatInt(num, tk->lineNumber);
+    p = twField(p, num, numLen, 6);
+    p = twField(p, tn->text, tn->len, 22);
+    if (tk->tokenType == TK_NUM && tk->hasValue)
+      numLen = formatInt(num, tk->value.intValue);
+    else if (tk->tokenType == TK_RNUM && tk->hasValue)
+      numLen = formatReal2(num, tk->value.realValue);
+    else
+      numLen = 0;
+    p = numLen ? twField(p, num, numLen, 12) : twField(p, "----", 4, 12);
+    p = twField(p, parent->text, parent->len, 30);
+    p = node->childCount ? twField(p, "no", 2, 5) : twField(p, "yes", 3, 5);
+    memcpy(p, "----\n", 5);
+    p += 5;
   } else {
-    const char *fullNT = getNonTerminalName(node->symbol.symbol.nonTerminal);
-    char ntStr[64];
-    int len = (int)strlen(fullNT);
-    if (len >= 2 && fullNT[0] == '<' && fullNT[len - 1] == '>') {
-      strncpy(ntStr, fullNT + 1, len - 2);
-      ntStr[len - 2] = '\0';
-    } else {
-      strncpy(ntStr, fullNT, 63);
-      ntStr[63] = '\0';
-    }
+    const twName *nt = &N->nonTerminal[node->symbolId];
+    p = twField(p, "----", 4, 20);
+    p = twField(p, nt->text, nt->len, 30);
+    p = twField(p, "----", 4, 6);
+    p = twField(p, "----", 4, 22);
+    p = twField(p, "----", 4, 12);
+    p = twField(p, parent->text, parent->len, 30);
+    p = twField(p, "no", 2, 5);
+    memcpy(p, nt->text, nt->len);
+    p += nt->len;
+    *p++ = '\n';
+  }
+  B->len = (size_t)(p - B->data);
+}
 
-    if (node->childCount > 0) {
-      printInorder(node->children[0], fp);
-    }
+typedef struct {
+  const twNames *names;
+  const parseTree *PT;
+  const uint8_t *detached; /* nodes rendered by onDetached, or NULL */
+  void (*onDetached)(void *ctx, uint32_t node, twBuffer *B);
+  void *ctx;
+} twWalker;
+
+/* Inorder walk (first child, the node itself, then the remaining children),
+   matching the layout of the parsetree_t*.txt files. */
+static void writeSubtree(twWalker *W, twBuffer *B, uint32_t rootIdx) {
+  treeWalker it;
+  treeWalkBegin(&it, W->PT, rootIdx, WALK_INORDER, W->detached);
+  for (uint32_t n; (n = treeWalkNext(&it)) != PT_NONE;) {
+    if (n != rootIdx && W->detached && W->detached[n])
+      W->onDetached(W->ctx, n, B);
+    else
+      writeTreeLine(B, W->names, W->PT, n);
+  }
+}
 
-    fprintf(fp, "%-20s  %-30s  %-6s  %-22s  %-12s  %-30s  %-5s  %-s\n", "----",
-            ntStr, "----", "----", "----", parentStr, "no", ntStr);
+static void writeTreeHeader(twBuffer *B) {
+  twReserve(B, TW_LINE_MAX);
+  B->len += (size_t)snprintf(
+      B->data + B->len, TW_LINE_MAX,
+      "%-20s  %-30s  %-6s  %-22s  %-12s  %-30s  %-5s  %-s\n%s\n", "lexeme",
+      "CurrentNode", "lineno", "tokenName", "valueIfNumber",
+      "parentNodeSymbol", "isLeaf", "NodeSymbol",
+      "--------------------------------------------------------------------"
+      "---------------------------------"
+      "-----------------------------------------------------");
+}
 
-    for (int i = 1; i < node->childCount; i++) {
-      printInorder(node->children[i], fp);
+/* Parallel rendering: every <function>/<mainFunction> subtree is a job.
+   Jobs are rendered TW_WINDOW at a time into private buffers while the main
+   walk writes everything around them, so output order and memory stay
+   bounded regardless of file size. */
+typedef struct {
+  const twNames *names;
+  const parseTree *PT;
+  uint32_t *jobs;
+  uint32_t jobCount;
+  uint32_t windowStart;
+  uint32_t windowEnd;
+  twBuffer out[TW_WINDOW];
+  atomic_uint next;
+  int threads;
+} twParallel;
+
+static void *renderJobsWorker(void *arg) {
+  twParallel *P = (twParallel *)arg;
+  twWalker W = {P->names, P->PT, NULL, NULL, NULL};
+  for (;;) {
+    uint32_t k = atomic_fetch_add(&P->next, 1);
+    if (P->windowStart + k >= P->windowEnd)
+      break;
+    P->out[k].len = 0;
+    writeSubtree(&W, &P->out[k], P->jobs[P->windowStart + k]);
+  }
+  return NULL;
+}
+
+static void renderWindow(twParallel *P, uint32_t start) {
+  P->windowStart = start;
+  P->windowEnd = start + TW_WINDOW < P->jobCount ? start + TW_WINDOW
+                                                  : P->jobCount;
+  atomic_store(&P->next, 0);
+  int threads = P->threads;
+  if ((uint32_t)threads > P->windowEnd - start)
+    threads = (int)(P->windowEnd - start);
+  pthread_t workers[TW_WINDOW];
+  int started = 0;
+  for (int i = 1; i < threads; i++)
+    if (pthread_create(&workers[started], NULL, renderJobsWorker, P) == 0)
+      started++;
+  renderJobsWorker(P);
+  for (int i = 0; i < started; i++)
+    pthread_join(workers[i], NULL);
+}
+
+typedef struct {
+  twParallel *P;
+  uint32_t nextJob;
+} twSplice;
+
+static void spliceRenderedJob(void *ctx, uint32_t node, twBuffer *B) {
+  twSplice *S = (twSplice *)ctx;
+  twParallel *P = S->P;
+  uint32_t k = S->nextJob++;
+  (void)node;
+  if (k >= P->windowEnd || k < P->windowStart)
+    renderWindow(P, k);
+  twBuffer *part = &P->out[k - P->windowStart];
+  if (B->len)
+    fwrite(B->data, 1, B->len, B->fp);
+  B->len = 0;
+  if (part->len)
+    fwrite(part->data, 1, part->len, B->fp);
+}
+
+static void writeTreeParallel(const twNames *N, const parseTree *PT,
+                              twBuffer *B, int threads) {
+  uint8_t *detached = (uint8_t *)calloc(PT->nodeCount, 1);
+  uint32_t *jobs = NULL, jobCount = 0, jobCap = 0;
+  if (!detached) {
+    fprintf(stderr, "calloc failed for serializer jobs\n");
+    exit(1);
+  }
+  for (uint32_t i = 0; i < PT->nodeCount; i++) {
+    const parseTreeNode *n = &PT->nodes[i];
+    if (n->symbolType == SYMBOL_NON_TERMINAL &&
+        (n->symbolId == NT_FUNCTION || n->symbolId == NT_MAINFUNCTION)) {
+      jobs = growArray(jobs, &jobCap, jobCount + 1, sizeof(uint32_t),
+                       "serializer jobs");
+      jobs[jobCount++] = i;
+      detached[i] = 1;
+      i = n->subtreeEnd - 1;
     }
   }
+
+  twParallel P;
+  memset(&P, 0, sizeof(P));
+  P.names = N;
+  P.PT = PT;
+  P.jobs = jobs;
+  P.jobCount = jobCount;
+  P.threads = threads;
+  twSplice S = {&P, 0};
+  twWalker W = {N, PT, detached, spliceRenderedJob, &S};
+  writeSubtree(&W, B, 0);
+
+  for (int i = 0; i < TW_WINDOW; i++)
+    free(P.out[i].data);
+  free(jobs);
+  free(detached);
 }
 
-void printParseTree(parseTree *PT, char *outfile) {
-  if (!PT || !PT->root) {
+void printParseTreeParallel(parseTree *PT, char *outfile, int threads) {
+  if (!PT || PT->nodeCount == 0) {
     fprintf(stderr, "Warning: empty parse tree, nothing to print\n");
     return;
   }
@@ -1131,31 +2341,136 @@ void printParseTree(parseTree *PT, char *outfile) {
     return;
   }
 
-  fprintf(fp, "%-20s  %-30s  %-6s  %-22s  %-12s  %-30s  %-5s  %-s\n", "lexeme",
-          "CurrentNode", "lineno", "tokenName", "valueIfNumber",
-          "parentNodeSymbol", "isLeaf", "NodeSymbol");
-  fprintf(fp, "%s\n",
-          "--------------------------------------------------------------------"
-          "---------------------------------"
-          "-----------------------------------------------------");
+  twNames N;
+  buildTreeNames(&N);
+  twBuffer B = {NULL, 0, 0, fp};
+  writeTreeHeader(&B);
+  if (threads <= 0) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = n > 0 ? (int)n : 1;
+  }
+  if (threads > TW_WINDOW)
+    threads = TW_WINDOW;
 
-  printInorder(PT->root, fp);
+  if (threads > 1) {
+    writeTreeParallel(&N, PT, &B, threads);
+  } else {
+    twWalker W = {&N, PT, NULL, NULL, NULL};
+    writeSubtree(&W, &B, 0);
+  }
+  fwrite(B.data, 1, B.len, fp);
+  free(B.data);
   fclose(fp);
   printf("Parse tree written to %s\n", outfile);
 }
 
-static void freeNode(parseTreeNode *node) {
-  if (!node)
+void printParseTree(parseTree *PT, char *outfile) {
+  printParseTreeParallel(PT, outfile, 1);
+}
+
+/* Inorder walk over a tree that is still being built. A node's line is
+   final once its first child's subtree is, so the walk runs whenever a
+   function completes and stops where the next child does not exist yet;
+   `hi` is the end of the last subtree walked. */
+typedef struct {
+  uint32_t node;
+  int state; /* 0: entered, 1: in first child, 2: line written */
+} twStreamFrame;
+
+typedef struct {
+  twNames names;
+  twBuffer B;
+  twStreamFrame *path;
+  uint32_t depth;
+  uint32_t capacity;
+  uint32_t hi;
+  int started;
+  uint32_t peakNodes;
+  uint32_t totalNodes;
+} twStream;
+
+static void twStreamPush(twStream *S, uint32_t node) {
+  S->path = growArray(S->path, &S->capacity, S->depth + 1,
+                      sizeof(twStreamFrame), "tree writer path");
+  S->path[S->depth].node = node;
+  S->path[S->depth].state = 0;
+  S->depth++;
+  S->hi = node + 1;
+}
+
+static void twStreamAdvance(twStream *S, const parseTree *PT, int final) {
+  if (!S->started && PT->nodeCount > 0) {
+    S->started = 1;
+    twStreamPush(S, 0);
+  }
+  while (S->depth > 0) {
+    twStreamFrame *f = &S->path[S->depth - 1];
+    uint32_t n = f->node;
+    int leaf = PT->nodes[n].childCount == 0;
+    if (f->state == 0 && !leaf) {
+      f->state = 1;
+      twStreamPush(S, n + 1);
+      continue;
+    }
+    if (f->state < 2) {
+      writeTreeLine(&S->B, &S->names, PT, n);
+      f->state = 2;
+    }
+    if (!leaf && S->hi >= PT->nodeCount && !final)
+      return;
+    if (!leaf && S->hi < PT->nodeCount && PT->nodes[S->hi].parent == n)
+      twStreamPush(S, S->hi);
+    else
+      S->depth--;
+  }
+}
+
+static void twStreamFunction(void *ctx, const parseTree *PT, uint32_t root) {
+  twStream *S = (twStream *)ctx;
+  if (PT->nodeCount > S->peakNodes)
+    S->peakNodes = PT->nodeCount;
+  S->totalNodes += PT->nodeCount - root - 1;
+  twStreamAdvance(S, PT, 0);
+  S->hi = root + 1; /* the subtree is released after this returns */
+}
+
+void printParseTreeBounded(char *testcaseFile, table *T, grammar *G,
+                           char *outfile) {
+  FILE *fp = fopen(outfile, "w");
+  if (!fp) {
+    fprintf(stderr, "Error: Cannot open output file %s\n", outfile);
     return;
-  for (int i = 0; i < node->childCount; i++)
-    freeNode(node->children[i]);
-  free(node);
+  }
+
+  twStream S;
+  memset(&S, 0, sizeof(S));
+  buildTreeNames(&S.names);
+  S.B.fp = fp;
+  writeTreeHeader(&S.B);
+  functionConsumer C = {&S, twStreamFunction};
+  parseTree *PT = parseInputSourceCodeBounded(testcaseFile, T, G, &C);
+  if (PT) {
+    if (PT->nodeCount > S.peakNodes)
+      S.peakNodes = PT->nodeCount;
+    S.totalNodes += PT->nodeCount;
+    twStreamAdvance(&S, PT, 1);
+    freeParseTree(PT);
+  }
+  fwrite(S.B.data, 1, S.B.len, fp);
+  free(S.B.data);
+  free(S.path);
+  fclose(fp);
+  if (PT)
+    printf("Parse tree written to %s (at most %u of %u nodes held at once)\n",
+           outfile, S.peakNodes, S.totalNodes);
 }
 
 void freeParseTree(parseTree *PT) {
   if (!PT)
     return;
-  freeNode(PT->root);
+  free(PT->nodes);
+  free(PT->tokens);
+  free(PT->lexemes);
   free(PT);
 }
 
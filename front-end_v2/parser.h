@@ -15,10 +15,146 @@ void printParseTable(table *T, grammar *G);
 
 parseTree* parseInputSourceCode(char *testcaseFile, table *T, grammar *G);
 
+/* Parses each top-level function on a worker thread (threads <= 0 uses one
+   per online CPU) and splices the results; falls back to the sequential
+   parser whenever the input has lexical or syntax errors. */
+parseTree *parseInputSourceCodeParallel(char *testcaseFile, table *T,
+                                        grammar *G, int threads);
+
+/* Same result as parseInputSourceCode, with the lexer running ahead on its
+   own thread and handing tokens over through a bounded ring (tokenPipe). */
+parseTree *parseInputSourceCodePipelined(char *testcaseFile, table *T,
+                                         grammar *G);
+
+/* Same language as parseInputSourceCode, but arithmetic and boolean
+   expressions are parsed by precedence climbing (exprParser.h) into flat
+   operator nodes instead of the <term>/<expPrime>/... chains. */
+parseTree *parseInputSourceCodeFlat(char *testcaseFile, table *T,
+                                    grammar *G);
+
+/* Bounded-memory parse: each function subtree is handed to C as soon as it
+   is complete and then freed, so memory tracks the largest function rather
+   than the whole program. Returns what is left (released functions stay as
+   childless placeholders), or NULL if the file cannot be opened. */
+parseTree *parseInputSourceCodeBounded(char *testcaseFile, table *T,
+                                       grammar *G, functionConsumer *C);
+
+subtreeCache *createSubtreeCache(void);
+
+/* Re-lexes the file, reuses cached subtrees of functions whose token spans
+   are unchanged and runs the LL(1) driver only on the others. Falls back
+   to parseInputSourceCode when the input has errors. */
+parseTree *parseInputSourceCodeIncremental(char *testcaseFile, table *T,
+                                           grammar *G, subtreeCache *C);
+
+void freeSubtreeCache(subtreeCache *C);
+
+/* Appends the parse of testcaseFile to PT (normally empty) and collects
+   errors into D instead of printing them. Touches no shared state, so
+   threads may call it concurrently with the same T and G. Returns 1 if the
+   input is correct, 0 on errors, -1 if the file cannot be opened. */
+int parseIntoTree(char *testcaseFile, const table *T, const grammar *G,
+                  parseTree *PT, parseDiagnostics *D);
+
+int parseInputSourceCodeStreaming(char *testcaseFile, table *T, grammar *G,
+                                  parseListener *listener);
+
+void createCompactTable(table *T, grammar *G, compactTable *CT);
+
+int checkSyntax(char *testcaseFile, const compactTable *CT,
+                parseDiagnostics *D);
+
+/* Holds TK_EOF and the start symbol; withParents keeps a parent per entry
+   (PT_NONE for these two). */
+void initCompactStack(compactStack *S, const compactTable *CT,
+                      int withParents);
+
+void growCompactStack(compactStack *S, uint32_t needed);
+
+void freeCompactStack(compactStack *S);
+
+/* The expansion step of the compactTable engines: pushes production r,
+   whose entries get the masks of the entry below and parent `parent`. */
+static inline void pushCompactRule(compactStack *S, const compactTable *CT,
+                                   int r, uint32_t parent) {
+  uint32_t n = CT->rhsCount[r], sp = S->count;
+  if (sp + n > S->capacity)
+    growCompactStack(S, sp + n);
+  for (uint32_t i = 0; i < n; i++, sp++) {
+    int sym = CT->rhs[r][i];
+    S->symbol[sp] = (uint8_t)sym;
+    S->anchor[sp] = CT->first[sym] | S->anchor[sp - 1];
+    S->pending[sp] =
+        (sym < CT_NT_BASE ? CT->first[sym] : 0) | S->pending[sp - 1];
+    if (S->parent)
+      S->parent[sp] = parent;
+  }
+  S->count = sp;
+}
+
+void printDiagnostics(parseDiagnostics *D, FILE *out, const char *prefix);
+
+void freeDiagnostics(parseDiagnostics *D);
+
 void printParseTree(parseTree *PT, char *outfile);
+/* Same output as printParseTree; function subtrees are rendered on up to
+   `threads` workers (<= 0: one per online CPU) and written in order. */
+void printParseTreeParallel(parseTree *PT, char *outfile, int threads);
+/* Parses testcaseFile with parseInputSourceCodeBounded and writes the same
+   file as printParseTree while holding at most one function's subtree. */
+void printParseTreeBounded(char *testcaseFile, table *T, grammar *G,
+                           char *outfile);
 
 void freeParseTree(parseTree *PT);
 
+uint32_t addParseToken(parseTree *PT, const tokenInfo *tk);
+
+uint32_t parseTreeFirstChild(const parseTree *PT, uint32_t node);
+
+uint32_t parseTreeNextSibling(const parseTree *PT, uint32_t node);
+
+const char *parseTreeLexeme(const parseTree *PT, uint32_t node);
+
 const char* getNonTerminalName(NonTerminal nt);
 
+/* Driver primitives shared with the generated recursive-descent engine
+   (rdParser.c), so both engines build identical trees and diagnostics. */
+void initParserState(parserState *ps, parseTree *PT, parseListener *listener);
+
+void nextMeaningfulToken(parserState *ps);
+
+void reportError(parserState *ps, int line, const char *fmt, ...);
+
+/* Error recovery, shared by every LL(1) engine. An error is reported
+   unless it is on the line of the previous one or fewer than
+   RECOVERY_QUIET_MATCHES terminals have matched since. */
+static inline int recoveryReports(const parserState *ps, int line) {
+  return line != ps->lastErrorLine && !ps->quiet;
+}
+
+/* Terminal t is on top of the stack and the lookahead a is not t: a is
+   deleted only if no entry below can use it (it is in neither anchor nor
+   pending). Otherwise t is taken as missing and popped, so that a missing
+   `;` does not swallow the statement after it. */
+static inline int recoveryDeletes(int a, int t, uint64_t anchor,
+                                  uint64_t pending) {
+  return a != t && a != TK_EOF && !((anchor | pending) & TERMINAL_BIT(a));
+}
+
+void reportMismatch(parserState *ps, int line, TokenType found,
+                    const char *lexeme, TokenType expected);
+
+void reportNoRule(parserState *ps, int line, TokenType found,
+                  const char *lexeme, NonTerminal A);
+
+/* Terminal t is on top of the stack: reports a mismatch and deletes tokens
+   by recoveryDeletes. Returns 1 if t is now the lookahead (not consumed),
+   0 if it is missing. */
+int recoverTerminal(parserState *ps, TokenType t, uint64_t anchor,
+                    uint64_t pending);
+
+uint32_t createNode(parseTree *PT, GrammarSymbol sym, uint32_t parent);
+
+void computeSubtreeEnds(parseTree *PT);
+
 #endif
@@ -0,0 +1,89 @@
+#include "parserContext.h"
+#include "grammarFile.h"
+#include "parser.h"
+#include "fusedParser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+parserShared *createParserShared(const char *grammarPath) {
+  parserShared *S = (parserShared *)malloc(sizeof(parserShared));
+  if (!S) {
+    fprintf(stderr, "malloc failed for parserShared\n");
+    exit(1);
+  }
+  if (grammarPath) {
+    S->G = loadGrammar(grammarPath, NULL, &S->F, &S->T, NULL);
+    if (!S->G) {
+      free(S);
+      return NULL;
+    }
+  } else {
+    S->G = initializeGrammar();
+    S->F = computeFirstAndFollowSets(S->G);
+    createParseTable(&S->F, &S->T, S->G);
+  }
+  createCompactTable(&S->T, S->G, &S->CT);
+  return S;
+}
+
+void freeParserShared(parserShared *S) {
+  if (!S)
+    return;
+  free(S->G);
+  free(S);
+}
+
+parserContext *createParserContext(const parserShared *S) {
+  parserContext *C = (parserContext *)calloc(1, sizeof(parserContext));
+  if (!C) {
+    fprintf(stderr, "calloc failed for parserContext\n");
+    exit(1);
+  }
+  C->shared = S;
+  return C;
+}
+
+void resetParserContext(parserContext *C) {
+  C->tree.nodeCount = 0;
+  C->tree.tokenCount = 0;
+  C->tree.lexemeSize = 0;
+  C->diag.count = 0;
+  C->status = 0;
+}
+
+parseTree *parseWithContext(parserContext *C, char *testcaseFile) {
+  resetParserContext(C);
+  C->status = parseIntoTree(testcaseFile, &C->shared->T, C->shared->G,
+                            &C->tree, &C->diag);
+  C->parses++;
+  return C->status < 0 ? NULL : &C->tree;
+}
+
+int checkSyntaxWithContext(parserContext *C, char *testcaseFile) {
+  resetParserContext(C);
+  C->status = checkSyntaxFused(testcaseFile, &C->shared->CT, &C->diag);
+  C->parses++;
+  return C->status;
+}
+
+parseTree *detachContextTree(parserContext *C) {
+  parseTree *PT = (parseTree *)malloc(sizeof(parseTree));
+  if (!PT) {
+    fprintf(stderr, "malloc failed for parseTree\n");
+    exit(1);
+  }
+  *PT = C->tree;
+  memset(&C->tree, 0, sizeof(C->tree));
+  return PT;
+}
+
+void freeParserContext(parserContext *C) {
+  if (!C)
+    return;
+  free(C->tree.nodes);
+  free(C->tree.tokens);
+  free(C->tree.lexemes);
+  freeDiagnostics(&C->diag);
+  free(C);
+}
@@ -0,0 +1,30 @@
+#ifndef PARSERCONTEXT_H
+#define PARSERCONTEXT_H
+#include "parserContextDef.h"
+
+/* Builds the built-in grammar (grammarPath == NULL) or loads a BNF file
+   through its cache. Returns NULL if the file cannot be loaded. */
+parserShared *createParserShared(const char *grammarPath);
+
+void freeParserShared(parserShared *S);
+
+parserContext *createParserContext(const parserShared *S);
+
+/* Empties the tree and diagnostics, keeping their capacity. */
+void resetParserContext(parserContext *C);
+
+/* Resets C and parses testcaseFile into C->tree, which stays valid until
+   the next parse or reset. Errors go to C->diag, nothing is printed.
+   Returns NULL only if the file cannot be opened. */
+parseTree *parseWithContext(parserContext *C, char *testcaseFile);
+
+/* Recognize-only check into C->diag; returns as checkSyntax. */
+int checkSyntaxWithContext(parserContext *C, char *testcaseFile);
+
+/* Hands C->tree over to the caller (free with freeParseTree); the context
+   starts a fresh arena. */
+parseTree *detachContextTree(parserContext *C);
+
+void freeParserContext(parserContext *C);
+
+#endif
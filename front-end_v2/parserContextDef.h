@@ -0,0 +1,25 @@
+#ifndef PARSERCONTEXTDEF_H
+#define PARSERCONTEXTDEF_H
+#include "parserDef.h"
+
+/* Grammar and tables, built once and only read afterwards. Any number of
+   parserContexts on any threads may share one. */
+typedef struct {
+  grammar *G;
+  FirstAndFollow F;
+  table T;
+  compactTable CT;
+} parserShared;
+
+/* Everything one parse writes. tree and diag are arenas: a reset empties
+   them but keeps their storage, so a worker that reuses its context stops
+   allocating once it has seen its largest input. */
+typedef struct {
+  const parserShared *shared;
+  parseTree tree;
+  parseDiagnostics diag;
+  int status; /* last parse: 1 correct, 0 errors, -1 unreadable */
+  uint32_t parses;
+} parserContext;
+
+#endif
@@ -1,13 +1,15 @@
 #ifndef PARSERDEF_H
 #define PARSERDEF_H
 #include "lexerDef.h"
+#include <stdint.h>
 
-#define MAX_CHILDREN 15
 #define MAX_RHS 15
 #define MAX_RULES 140
 #define MAX_FIRST_FOLLOW 45
 #define MAX_NT 60
 #define TABLE_TERMINALS 70
+#define MAX_PARSE_ERRORS 60
+#define RECOVERY_QUIET_MATCHES 3
 
 typedef enum {
   NT_PROGRAM = 0,
@@ -115,28 +117,192 @@ typedef struct {
   GrammarRule *rule;
 } ParseTableEntry;
 
+/* Terminal sets as bitmasks; every TokenType fits below 64. */
+#define TERMINAL_BIT(t) ((uint64_t)1 << (t))
+
+/* Stack symbols are one byte: terminals keep their TokenType value,
+   nonterminals are CT_NT_BASE + nt. */
+#define CT_NT_BASE 64
+#define PACKED_RULE_END 0xFF
+
+/* A production as the LL(1) driver pushes it: the RHS reversed with
+   epsilons removed. anchor[k]/pending[k] are the stackNode masks of entry
+   k less what it inherits from below the production, so an expansion is
+   one block copy. An epsilon production has count 0 and epsilonLeaf set. */
+typedef struct {
+  uint8_t count;
+  uint8_t epsilonLeaf;
+  uint8_t symbol[MAX_RHS];
+  uint64_t anchor[MAX_RHS];
+  uint64_t pending[MAX_RHS];
+} packedRule;
+
 typedef struct {
   ParseTableEntry entries[MAX_NT][TABLE_TERMINALS];
+  uint64_t firstMask[MAX_NT];  /* FIRST(A) without epsilon */
+  uint64_t followMask[MAX_NT]; /* FOLLOW(A) */
+  packedRule packed[MAX_RULES]; /* by ruleNumber - 1 */
 } table;
 
-typedef struct parseTreeNode {
-  GrammarSymbol symbol;
-  tokenInfo token;
-  struct parseTreeNode *children[MAX_CHILDREN];
-  int childCount;
-  struct parseTreeNode *parent;
-  int isLeaf;
-  int visited;
+/* Dense form of `table` for the recognize-only path, with one-byte
+   symbols as in packedRule. rule[][] holds a production index (-1 for an
+   error entry) and rhs[] is that production reversed with epsilons
+   removed, ready to copy onto a byte stack. */
+typedef struct {
+  int16_t rule[NT_COUNT][TABLE_TERMINALS];
+  uint8_t rhs[MAX_RULES][MAX_RHS];
+  uint8_t rhsCount[MAX_RULES];
+  uint8_t startSymbol;
+  uint64_t first[CT_NT_BASE + NT_COUNT]; /* indexed by stack byte */
+  uint64_t follow[NT_COUNT];
+} compactTable;
+
+typedef struct {
+  int lineNumber;
+  char message[512];
+} parseDiagnostic;
+
+typedef struct {
+  parseDiagnostic *items;
+  int count;
+  int capacity;
+} parseDiagnostics;
+
+/* Sentinel for "no node" / "no token" in the 32-bit index fields below. */
+#define PT_NONE UINT32_MAX
+
+/* Compact copy of a token from the input stream. The lexeme lives in the
+   owning tree's string pool at offset `lexeme`. */
+typedef struct {
+  TokenType tokenType;
+  int lineNumber;
+  int hasValue;
+  union {
+    int intValue;
+    double realValue;
+  } value;
+  uint32_t lexeme;
+} parseToken;
+
+/* Nodes are stored in preorder, so a node's first child (if any) is the
+   next slot and its subtree occupies [index, subtreeEnd). The next sibling
+   of a child is its own subtreeEnd while that is below the parent's. */
+typedef struct {
+  uint8_t symbolType;
+  uint8_t symbolId;
+  uint16_t childCount;
+  uint32_t parent;
+  uint32_t subtreeEnd;
+  uint32_t token;
 } parseTreeNode;
 
 typedef struct {
-  parseTreeNode *root;
+  parseTreeNode *nodes;
+  uint32_t nodeCount;
+  uint32_t nodeCapacity;
+  parseToken *tokens;
+  uint32_t tokenCount;
+  uint32_t tokenCapacity;
+  char *lexemes;
+  uint32_t lexemeSize;
+  uint32_t lexemeCapacity;
 } parseTree;
 
-typedef struct stackNode {
-  GrammarSymbol symbol;
-  parseTreeNode *treeNode;
-  struct stackNode *next;
+/* Event callbacks for parseInputSourceCodeStreaming. Any may be NULL.
+   enterNonTerminal/exitNonTerminal bracket each nonterminal; `rule` is the
+   production being expanded, or NULL when the nonterminal was skipped by
+   error recovery. matchTerminal gets tk == NULL for a terminal that was
+   expected but not found. error replaces the usual stderr report. */
+typedef struct {
+  void *ctx;
+  void (*enterNonTerminal)(void *ctx, NonTerminal nt, const GrammarRule *rule);
+  void (*exitNonTerminal)(void *ctx, NonTerminal nt, const GrammarRule *rule);
+  void (*matchTerminal)(void *ctx, TokenType expected, const tokenInfo *tk);
+  void (*error)(void *ctx, int line, const char *message);
+} parseListener;
+
+/* Function subtrees from earlier parses, keyed by the token types of the
+   function's span (TK_FUNID or TK_MAIN through TK_END). Token indices in
+   `nodes` are relative to the span start. */
+typedef struct {
+  uint64_t hash;
+  uint32_t tokenCount;
+  uint32_t generation;
+  uint8_t *types;
+  parseTreeNode *nodes;
+  uint32_t nodeCount;
+} subtreeCacheEntry;
+
+typedef struct {
+  subtreeCacheEntry *entries;
+  uint32_t count;
+  uint32_t capacity;
+  uint32_t *slots;
+  uint32_t slotCount;
+  uint32_t generation;
+  uint32_t hits;   /* functions reused by the last parse */
+  uint32_t misses; /* functions parsed by the last parse */
+} subtreeCache;
+
+/* Receives each <function>/<mainFunction> subtree of a bounded parse once
+   its TK_END has been processed. The subtree is [root, PT->nodeCount) with
+   subtreeEnd filled in; its nodes and tokens are released on return. */
+typedef struct {
+  void *ctx;
+  void (*function)(void *ctx, const parseTree *PT, uint32_t root);
+} functionConsumer;
+
+struct tokenPipe;
+struct exprScratch;
+
+/* Tokens come from a live lexer (tb), from a lexer thread (pipe), or from
+   the pre-lexed range [streamPos, streamEnd) of `stream`; the current token
+   is always exposed through curType/curLine/curLexeme/curIndex. */
+typedef struct {
+  twinBuffer *tb;
+  struct tokenPipe *pipe;
+  const parseToken *pipeToken;
+  const parseTree *stream;
+  uint32_t streamPos;
+  uint32_t streamEnd;
+  parseTree *PT;
+  parseListener *listener;
+  parseDiagnostics *diag;
+  tokenInfo lexed;
+  TokenType curType;
+  int curLine;
+  const char *curLexeme;
+  uint32_t curIndex;
+  int errorCount;
+  int syntaxOK;
+  int lastErrorLine;
+  int quiet; /* matches left before errors are reported again */
+  int flatExpressions; /* hand expressions to exprParser.c */
+  struct exprScratch *expr;
+  functionConsumer *consumer; /* bounded mode: release finished functions */
+} parserState;
+
+/* anchor is the union of FIRST over this entry and everything below it;
+   pending is the set of terminals at or below it. Error recovery skips
+   input until a token in one of these can be used again. */
+typedef struct {
+  uint8_t symbol; /* packed symbol or PACKED_RULE_END */
+  uint32_t parent;
+  const GrammarRule *rule; /* for PACKED_RULE_END */
+  uint64_t anchor;
+  uint64_t pending;
 } stackNode;
 
+/* Stack of the compactTable engines (checkSyntax, fusedParser.c): the
+   stackNode fields as parallel arrays, with parent only when a tree is
+   built. */
+typedef struct {
+  uint8_t *symbol;
+  uint64_t *anchor;
+  uint64_t *pending;
+  uint32_t *parent;
+  uint32_t count;
+  uint32_t capacity;
+} compactStack;
+
 #endif
@@ -0,0 +1,10 @@
+#ifndef RDPARSER_H
+#define RDPARSER_H
+#include "parser.h"
+
+/* Generated recursive-descent engine (rdParser.c, written by gen_rd_parser
+   from the built-in grammar). Builds the same parseTree and reports the
+   same errors as parseInputSourceCode. */
+parseTree *parseInputSourceCodeRD(char *testcaseFile);
+
+#endif
@@ -0,0 +1,559 @@
+#define _POSIX_C_SOURCE 200809L
+#include "resultCache.h"
+#include "fusedParser.h"
+#include "parserContext.h"
+#include "treeFile.h"
+#include "util.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CACHE_PATH_MAX 4096
+
+/* Two independent chains, so a collision needs both to collide: FNV-1a
+   over the bytes and a multiply-xorshift over 8-byte words. */
+static void mixBytes(uint64_t h[2], const void *data, size_t size) {
+  const unsigned char *p = (const unsigned char *)data;
+  uint64_t b = h[1], w;
+  h[0] = fnv1a(data, size, h[0]);
+  for (; size >= 8; p += 8, size -= 8) {
+    memcpy(&w, p, 8);
+    b = (b ^ w) * 0x9E3779B97F4A7C15ULL;
+    b ^= b >> 29;
+  }
+  w = 0; /* the tail, tagged with its length so "ab" and "ab\0" differ */
+  memcpy(&w, p, size);
+  w ^= (uint64_t)size << 56;
+  b = (b ^ w) * 0x9E3779B97F4A7C15ULL;
+  b ^= b >> 29;
+  h[1] = b;
+}
+
+static void mixValue(uint64_t h[2], uint64_t v) { mixBytes(h, &v, sizeof(v)); }
+
+resultCache *openResultCache(const char *dir, uint64_t maxBytes,
+                             const parserShared *S) {
+  if (strlen(dir) > CACHE_PATH_MAX - 64) {
+    fprintf(stderr, "Error: cache directory %s: path too long\n", dir);
+    return NULL;
+  }
+  if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "Error: Cannot create cache directory %s\n", dir);
+    return NULL;
+  }
+  resultCache *RC = (resultCache *)calloc(1, sizeof(resultCache));
+  if (!RC) {
+    fprintf(stderr, "calloc failed for resultCache\n");
+    exit(1);
+  }
+  RC->dir = strdup(dir);
+  if (!RC->dir) {
+    fprintf(stderr, "strdup failed for cache directory\n");
+    exit(1);
+  }
+  RC->maxBytes = maxBytes ? maxBytes : RESULT_CACHE_DEFAULT_MAX;
+  pthread_mutex_init(&RC->flushLock, NULL);
+
+  /* The grammar enters every key through the compact table, which is
+     derived from it; struct padding is skipped. */
+  const compactTable *CT = &S->CT;
+  RC->seed[0] = FNV1A_BASIS;
+  RC->seed[1] = 0x243F6A8885A308D3ULL;
+  mixValue(RC->seed, RESULT_CACHE_VERSION);
+  mixValue(RC->seed, TREE_FILE_VERSION);
+  mixValue(RC->seed, sizeof(parseTreeNode));
+  mixValue(RC->seed, sizeof(parseToken));
+  mixBytes(RC->seed, CT->rule, sizeof(CT->rule));
+  mixBytes(RC->seed, CT->rhs, sizeof(CT->rhs));
+  mixBytes(RC->seed, CT->rhsCount, sizeof(CT->rhsCount));
+  mixBytes(RC->seed, &CT->startSymbol, sizeof(CT->startSymbol));
+  mixBytes(RC->seed, CT->first, sizeof(CT->first));
+  mixBytes(RC->seed, CT->follow, sizeof(CT->follow));
+  return RC;
+}
+
+resultKey resultCacheKey(const resultCache *RC, resultKind kind,
+                         const char *text, size_t size) {
+  resultKey K;
+  K.hash[0] = RC->seed[0];
+  K.hash[1] = RC->seed[1];
+  mixValue(K.hash, (uint64_t)kind);
+  mixValue(K.hash, (uint64_t)size);
+  mixBytes(K.hash, text, size);
+  K.sourceSize = size;
+  K.kind = (uint32_t)kind;
+  return K;
+}
+
+static void entryPath(const resultCache *RC, const resultKey *K, char *path,
+                      int withName) {
+  if (withName)
+    snprintf(path, CACHE_PATH_MAX, "%s/%02x/%016llx%016llx", RC->dir,
+             (unsigned)(K->hash[0] >> 56), (unsigned long long)K->hash[0],
+             (unsigned long long)K->hash[1]);
+  else
+    snprintf(path, CACHE_PATH_MAX, "%s/%02x", RC->dir,
+             (unsigned)(K->hash[0] >> 56));
+}
+
+static int readFull(int fd, void *buf, size_t n) {
+  char *p = (char *)buf;
+  while (n > 0) {
+    ssize_t got = read(fd, p, n);
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got <= 0)
+      return -1;
+    p += got;
+    n -= (size_t)got;
+  }
+  return 0;
+}
+
+static int writeFull(int fd, const void *buf, size_t n) {
+  const char *p = (const char *)buf;
+  while (n > 0) {
+    ssize_t put = write(fd, p, n);
+    if (put < 0 && errno == EINTR)
+      continue;
+    if (put <= 0)
+      return -1;
+    p += put;
+    n -= (size_t)put;
+  }
+  return 0;
+}
+
+static void addCachedDiagnostic(parseDiagnostics *D, int line,
+                                const char *message, uint32_t length) {
+  if (D->count == D->capacity) {
+    int cap = D->capacity ? 2 * D->capacity : 16;
+    parseDiagnostic *p =
+        (parseDiagnostic *)realloc(D->items, cap * sizeof(parseDiagnostic));
+    if (!p) {
+      fprintf(stderr, "realloc failed for diagnostics\n");
+      exit(1);
+    }
+    D->items = p;
+    D->capacity = cap;
+  }
+  parseDiagnostic *d = &D->items[D->count++];
+  if (length >= sizeof(d->message))
+    length = sizeof(d->message) - 1;
+  d->lineNumber = line;
+  memcpy(d->message, message, length);
+  d->message[length] = '\0';
+}
+
+static int restoreDiagnostics(const char *block, uint32_t size,
+                              uint32_t count, parseDiagnostics *D) {
+  uint32_t at = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    int32_t line;
+    uint32_t length;
+    if (size - at < 8)
+      return -1;
+    memcpy(&line, block + at, 4);
+    memcpy(&length, block + at + 4, 4);
+    at += 8;
+    if (length > size - at)
+      return -1;
+    addCachedDiagnostic(D, line, block + at, length);
+    at += length;
+  }
+  return 0;
+}
+
+static void restoreTree(parseTree *dst, const parseTree *src) {
+  dst->nodes = growArray(dst->nodes, &dst->nodeCapacity, src->nodeCount,
+                         sizeof(parseTreeNode), "parse tree nodes");
+  dst->tokens = growArray(dst->tokens, &dst->tokenCapacity, src->tokenCount,
+                          sizeof(parseToken), "parse tree tokens");
+  dst->lexemes = growArray(dst->lexemes, &dst->lexemeCapacity,
+                           src->lexemeSize, 1, "parse tree lexemes");
+  if (src->nodeCount)
+    memcpy(dst->nodes, src->nodes, src->nodeCount * sizeof(parseTreeNode));
+  if (src->tokenCount)
+    memcpy(dst->tokens, src->tokens, src->tokenCount * sizeof(parseToken));
+  if (src->lexemeSize)
+    memcpy(dst->lexemes, src->lexemes, src->lexemeSize);
+  dst->nodeCount = src->nodeCount;
+  dst->tokenCount = src->tokenCount;
+  dst->lexemeSize = src->lexemeSize;
+}
+
+/* Returns 1 and fills C on a hit. An entry that does not match its name
+   (torn by a crash, or a key collision) is removed. */
+static int lookupResult(resultCache *RC, const resultKey *K,
+                        parserContext *C) {
+  char path[CACHE_PATH_MAX];
+  entryPath(RC, K, path, 1);
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return 0;
+
+  resultEntryHeader H;
+  struct stat sb;
+  char *diag = NULL, *data = NULL;
+  int ok = fstat(fd, &sb) == 0 && readFull(fd, &H, sizeof(H)) == 0 &&
+           H.magic == RESULT_CACHE_MAGIC && H.kind == K->kind &&
+           H.hash[0] == K->hash[0] && H.hash[1] == K->hash[1] &&
+           H.sourceSize == K->sourceSize && H.diagBytes % 8 == 0 &&
+           (uint64_t)sb.st_size == sizeof(H) + H.diagBytes + H.dataLength &&
+           (K->kind != RESULT_CHECK) == (H.dataLength > 0);
+  if (ok) {
+    diag = (char *)malloc(H.diagBytes ? H.diagBytes : 1);
+    data = H.dataLength ? (char *)malloc(H.dataLength) : NULL;
+    if (!diag || (H.dataLength && !data)) {
+      fprintf(stderr, "malloc failed for cache entry\n");
+      exit(1);
+    }
+    ok = readFull(fd, diag, H.diagBytes) == 0 &&
+         (!data || readFull(fd, data, H.dataLength) == 0) &&
+         restoreDiagnostics(diag, H.diagBytes, H.diagCount, &C->diag) == 0;
+  }
+  if (ok && data) {
+    treeFile *TF = openTreeImage(data, H.dataLength);
+    data = NULL;
+    if (TF && !verifyTreeFile(TF))
+      restoreTree(&C->tree, treeFileTree(TF));
+    else
+      ok = 0;
+    closeTreeFile(TF);
+  }
+  if (ok)
+    futimens(fd, NULL); /* recency for LRU eviction */
+  close(fd);
+  free(diag);
+  free(data);
+
+  if (!ok) {
+    unlink(path);
+    resetParserContext(C);
+    return 0;
+  }
+  C->status = H.status;
+  return 1;
+}
+
+static void storeResult(resultCache *RC, const resultKey *K,
+                        const parserContext *C) {
+  size_t dataLength = 0;
+  void *data = NULL;
+  if (K->kind != RESULT_CHECK)
+    data = serializeTree(&C->tree, &dataLength);
+
+  uint32_t diagBytes = 0;
+  for (int i = 0; i < C->diag.count; i++)
+    diagBytes += 8 + (uint32_t)strlen(C->diag.items[i].message);
+  diagBytes = (diagBytes + 7) & ~7u;
+
+  resultEntryHeader H;
+  memset(&H, 0, sizeof(H));
+  H.magic = RESULT_CACHE_MAGIC;
+  H.kind = K->kind;
+  H.hash[0] = K->hash[0];
+  H.hash[1] = K->hash[1];
+  H.sourceSize = K->sourceSize;
+  H.status = C->status;
+  H.diagCount = (uint32_t)C->diag.count;
+  H.diagBytes = diagBytes;
+  H.dataLength = dataLength;
+
+  size_t size = sizeof(H) + diagBytes;
+  char *head = (char *)calloc(1, size);
+  if (!head) {
+    fprintf(stderr, "calloc failed for cache entry\n");
+    exit(1);
+  }
+  memcpy(head, &H, sizeof(H));
+  char *p = head + sizeof(H);
+  for (int i = 0; i < C->diag.count; i++) {
+    int32_t line = C->diag.items[i].lineNumber;
+    uint32_t length = (uint32_t)strlen(C->diag.items[i].message);
+    memcpy(p, &line, 4);
+    memcpy(p + 4, &length, 4);
+    memcpy(p + 8, C->diag.items[i].message, length);
+    p += 8 + length;
+  }
+
+  /* Written under a temporary name and renamed into place, so a reader
+     sees either no entry or a complete one. */
+  char path[CACHE_PATH_MAX], temp[CACHE_PATH_MAX + 32];
+  entryPath(RC, K, path, 0);
+  snprintf(temp, sizeof(temp), "%s/.tmp.%ld.%u", path, (long)getpid(),
+           atomic_fetch_add(&RC->tempCounter, 1));
+  int fd = open(temp, O_WRONLY | O_CREAT | O_EXCL, 0644);
+  if (fd < 0 && errno == ENOENT) {
+    mkdir(path, 0755); /* may race with another writer; either one wins */
+    fd = open(temp, O_WRONLY | O_CREAT | O_EXCL, 0644);
+  }
+  entryPath(RC, K, path, 1);
+  int ok = fd >= 0 && writeFull(fd, head, size) == 0 &&
+           (!dataLength || writeFull(fd, data, dataLength) == 0);
+  if (fd >= 0 && close(fd) != 0)
+    ok = 0;
+  if (ok && rename(temp, path) == 0) {
+    atomic_fetch_add(&RC->stores, 1);
+    atomic_fetch_add(&RC->storedBytes, size + dataLength);
+  } else if (fd >= 0) {
+    unlink(temp);
+  }
+  free(head);
+  free(data);
+}
+
+static void flushLocked(resultCache *RC);
+
+int cachedResult(resultCache *RC, resultKind kind, parserContext *C,
+                 const char *text, size_t size) {
+  resetParserContext(C);
+  resultKey K;
+  if (RC) {
+    K = resultCacheKey(RC, kind, text, size);
+    if (lookupResult(RC, &K, C)) {
+      atomic_fetch_add(&RC->hits, 1);
+      return C->status;
+    }
+    atomic_fetch_add(&RC->misses, 1);
+  }
+
+  const parserShared *S = C->shared;
+  if (kind == RESULT_CHECK)
+    C->status = checkSyntaxBuffer(text, size, &S->CT, &C->diag);
+  else if (kind == RESULT_PARSE)
+    C->status = parseBufferIntoTree(text, size, &S->CT, &C->tree, &C->diag);
+  else
+    C->status = lexBuffer(text, size, &C->tree, &C->diag);
+  C->parses++;
+
+  if (RC) {
+    storeResult(RC, &K, C);
+    /* A long-running process (server, huge batch) enforces the cap as it
+       goes; whoever finds the lock taken leaves it to the holder. */
+    if (atomic_load(&RC->storedBytes) - atomic_load(&RC->flushedBytes) >
+            RC->maxBytes / 8 &&
+        pthread_mutex_trylock(&RC->flushLock) == 0) {
+      flushLocked(RC);
+      pthread_mutex_unlock(&RC->flushLock);
+    }
+  }
+  return C->status;
+}
+
+int cachedResultForFile(resultCache *RC, resultKind kind, parserContext *C,
+                        const char *path) {
+  size_t n;
+  char *text = readWholeFile(path, &n);
+  if (!text) {
+    fprintf(stderr, "Error: Cannot open %s\n", path);
+    resetParserContext(C);
+    C->status = -1;
+    return -1;
+  }
+  int status = cachedResult(RC, kind, C, text, n);
+  free(text);
+  return status;
+}
+
+/* ---- stats and eviction ---- */
+
+typedef struct {
+  struct timespec used;
+  uint64_t size;
+  char name[40];
+  uint8_t shard;
+} cacheEntryInfo;
+
+static int compareRecency(const void *a, const void *b) {
+  const cacheEntryInfo *x = (const cacheEntryInfo *)a;
+  const cacheEntryInfo *y = (const cacheEntryInfo *)b;
+  if (x->used.tv_sec != y->used.tv_sec)
+    return x->used.tv_sec < y->used.tv_sec ? -1 : 1;
+  if (x->used.tv_nsec != y->used.tv_nsec)
+    return x->used.tv_nsec < y->used.tv_nsec ? -1 : 1;
+  return 0;
+}
+
+/* Lists every entry of dir; temporary files left by a crashed writer are
+   removed once they are an hour old. */
+static cacheEntryInfo *scanEntries(const char *dir, uint32_t *count,
+                                   uint64_t *bytes) {
+  cacheEntryInfo *list = NULL;
+  uint32_t n = 0, cap = 0;
+  uint64_t total = 0;
+  time_t now = time(NULL);
+  char path[CACHE_PATH_MAX];
+  for (int shard = 0; shard < 256; shard++) {
+    snprintf(path, sizeof(path), "%s/%02x", dir, shard);
+    DIR *d = opendir(path);
+    if (!d)
+      continue;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+      if (e->d_name[0] == '.' && strncmp(e->d_name, ".tmp.", 5) != 0)
+        continue;
+      struct stat sb;
+      snprintf(path, sizeof(path), "%s/%02x/%s", dir, shard, e->d_name);
+      if (stat(path, &sb) != 0 || !S_ISREG(sb.st_mode))
+        continue;
+      if (e->d_name[0] == '.') {
+        if (now - sb.st_mtime > 3600)
+          unlink(path);
+        continue;
+      }
+      if (strlen(e->d_name) >= sizeof(list->name))
+        continue;
+      list = growArray(list, &cap, n + 1, sizeof(cacheEntryInfo),
+                       "cache entries");
+      list[n].used = sb.st_mtim;
+      list[n].size = (uint64_t)sb.st_size;
+      list[n].shard = (uint8_t)shard;
+      strcpy(list[n].name, e->d_name);
+      total += (uint64_t)sb.st_size;
+      n++;
+    }
+    closedir(d);
+  }
+  *count = n;
+  *bytes = total;
+  return list;
+}
+
+static void readStatsFile(const char *dir, resultCacheStats *st) {
+  char path[CACHE_PATH_MAX], key[32];
+  unsigned long long value;
+  memset(st, 0, sizeof(*st));
+  snprintf(path, sizeof(path), "%s/stats", dir);
+  FILE *fp = fopen(path, "r");
+  if (!fp)
+    return;
+  while (fscanf(fp, "%31s %llu", key, &value) == 2) {
+    if (strcmp(key, "hits") == 0)
+      st->hits = value;
+    else if (strcmp(key, "misses") == 0)
+      st->misses = value;
+    else if (strcmp(key, "stores") == 0)
+      st->stores = value;
+    else if (strcmp(key, "evictions") == 0)
+      st->evictions = value;
+    else if (strcmp(key, "entries") == 0)
+      st->entries = value;
+    else if (strcmp(key, "bytes") == 0)
+      st->bytes = value;
+    else if (strcmp(key, "max") == 0)
+      st->maxBytes = value;
+  }
+  fclose(fp);
+}
+
+static void writeStatsFile(const char *dir, const resultCacheStats *st) {
+  char path[CACHE_PATH_MAX], temp[CACHE_PATH_MAX];
+  snprintf(path, sizeof(path), "%s/stats", dir);
+  snprintf(temp, sizeof(temp), "%s/stats.tmp", dir);
+  FILE *fp = fopen(temp, "w");
+  if (!fp)
+    return;
+  fprintf(fp, "hits %llu\nmisses %llu\nstores %llu\nevictions %llu\n"
+              "entries %llu\nbytes %llu\nmax %llu\n",
+          (unsigned long long)st->hits, (unsigned long long)st->misses,
+          (unsigned long long)st->stores, (unsigned long long)st->evictions,
+          (unsigned long long)st->entries, (unsigned long long)st->bytes,
+          (unsigned long long)st->maxBytes);
+  if (fclose(fp) != 0 || rename(temp, path) != 0)
+    unlink(temp);
+}
+
+static void evictEntries(const resultCache *RC, resultCacheStats *st) {
+  uint32_t count;
+  uint64_t bytes;
+  cacheEntryInfo *list = scanEntries(RC->dir, &count, &bytes);
+  qsort(list, count, sizeof(cacheEntryInfo), compareRecency);
+  uint64_t target = RC->maxBytes / 10 * 9;
+  char path[CACHE_PATH_MAX];
+  uint32_t removed = 0;
+  while (removed < count && bytes > target) {
+    cacheEntryInfo *e = &list[removed++];
+    snprintf(path, sizeof(path), "%s/%02x/%s", RC->dir, e->shard, e->name);
+    if (unlink(path) == 0) {
+      bytes -= e->size;
+      st->evictions++;
+    }
+  }
+  st->entries = count - removed;
+  st->bytes = bytes;
+  free(list);
+}
+
+static void flushLocked(resultCache *RC) {
+  char path[CACHE_PATH_MAX];
+  snprintf(path, sizeof(path), "%s/lock", RC->dir);
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    return;
+  struct flock fl;
+  memset(&fl, 0, sizeof(fl));
+  fl.l_type = F_WRLCK;
+  fl.l_whence = SEEK_SET;
+  while (fcntl(fd, F_SETLKW, &fl) != 0)
+    if (errno != EINTR) {
+      close(fd);
+      return;
+    }
+
+  resultCacheStats now, st;
+  now.hits = atomic_load(&RC->hits);
+  now.misses = atomic_load(&RC->misses);
+  now.stores = atomic_load(&RC->stores);
+  now.bytes = atomic_load(&RC->storedBytes);
+  readStatsFile(RC->dir, &st);
+  st.hits += now.hits - RC->flushed.hits;
+  st.misses += now.misses - RC->flushed.misses;
+  st.stores += now.stores - RC->flushed.stores;
+  st.entries += now.stores - RC->flushed.stores;
+  st.bytes += now.bytes - atomic_load(&RC->flushedBytes);
+  st.maxBytes = RC->maxBytes;
+  if (st.bytes > RC->maxBytes)
+    evictEntries(RC, &st);
+  writeStatsFile(RC->dir, &st);
+  RC->flushed.hits = now.hits;
+  RC->flushed.misses = now.misses;
+  RC->flushed.stores = now.stores;
+  atomic_store(&RC->flushedBytes, now.bytes);
+
+  close(fd); /* releases the lock */
+}
+
+void flushResultCache(resultCache *RC) {
+  pthread_mutex_lock(&RC->flushLock);
+  flushLocked(RC);
+  pthread_mutex_unlock(&RC->flushLock);
+}
+
+void closeResultCache(resultCache *RC) {
+  if (!RC)
+    return;
+  flushResultCache(RC);
+  pthread_mutex_destroy(&RC->flushLock);
+  free(RC->dir);
+  free(RC);
+}
+
+int readResultCacheStats(const char *dir, resultCacheStats *st) {
+  char path[CACHE_PATH_MAX];
+  struct stat sb;
+  snprintf(path, sizeof(path), "%s/stats", dir);
+  if (strlen(dir) > CACHE_PATH_MAX - 64 || stat(path, &sb) != 0)
+    return -1;
+  readStatsFile(dir, st);
+  uint32_t count;
+  free(scanEntries(dir, &count, &st->bytes));
+  st->entries = count;
+  return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+#include "resultCacheDef.h"
+#include <stddef.h>
+
+/* Opens the cache directory dir, creating it if needed, for results
+   computed with the tables of S. maxBytes caps the size of all entries
+   (0: RESULT_CACHE_DEFAULT_MAX). Returns NULL if dir cannot be created. */
+resultCache *openResultCache(const char *dir, uint64_t maxBytes,
+                             const parserShared *S);
+
+resultKey resultCacheKey(const resultCache *RC, resultKind kind,
+                         const char *text, size_t size);
+
+/* Resets C and fills C->status, C->diag and, for RESULT_PARSE/RESULT_LEX,
+   C->tree for text[0, size): from RC if it holds the entry, otherwise by
+   running checkSyntaxBuffer, parseBufferIntoTree or lexBuffer and storing
+   the result. RC may be NULL to skip the cache. Returns C->status. */
+int cachedResult(resultCache *RC, resultKind kind, parserContext *C,
+                 const char *text, size_t size);
+
+/* Same for a file; -1 if it cannot be read. */
+int cachedResultForFile(resultCache *RC, resultKind kind, parserContext *C,
+                        const char *path);
+
+/* Adds the counters not yet recorded to the directory's stats file and,
+   if the entries exceed the cap, removes the least recently used ones
+   down to 90% of it. Writers of one directory are serialized by a lock
+   file, so several processes may share it. */
+void flushResultCache(resultCache *RC);
+
+/* Flushes and frees RC. */
+void closeResultCache(resultCache *RC);
+
+/* Totals of the directory; entries and bytes are counted afresh.
+   Returns -1 if dir is not a cache. */
+int readResultCacheStats(const char *dir, resultCacheStats *st);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef RESULTCACHEDEF_H
+#define RESULTCACHEDEF_H
+#include "parserContextDef.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define RESULT_CACHE_MAGIC 0x31435250u /* "PRC1" */
+/* Part of every key: bump it whenever the lexer, the parser or the tree
+   file layout can produce different output for the same source. */
+#define RESULT_CACHE_VERSION 2
+#define RESULT_CACHE_DEFAULT_MAX (512ull << 20)
+
+typedef enum { RESULT_CHECK = 1, RESULT_PARSE, RESULT_LEX } resultKind;
+
+/* 128-bit content key: two independent 64-bit hashes of the grammar
+   fingerprint, the kind and the source bytes. */
+typedef struct {
+  uint64_t hash[2];
+  uint64_t sourceSize;
+  uint32_t kind;
+} resultKey;
+
+/* An entry file is this header, diagBytes of diagnostic records (int32
+   line, uint32 length, message bytes, the whole block padded to 8) and
+   dataLength bytes of tree image (PARSE: the tree, LEX: the token
+   stream), as serializeTree writes it. */
+typedef struct {
+  uint32_t magic;
+  uint32_t kind;
+  uint64_t hash[2];
+  uint64_t sourceSize;
+  int32_t status;
+  uint32_t diagCount;
+  uint32_t diagBytes;
+  uint32_t reserved;
+  uint64_t dataLength;
+} resultEntryHeader;
+
+typedef struct {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t stores;
+  uint64_t evictions;
+  uint64_t entries;
+  uint64_t bytes;
+  uint64_t maxBytes;
+} resultCacheStats;
+
+/* One open cache directory. The counters are this process's; they are
+   added to the directory's stats file by flushResultCache. Any number of
+   threads may use one resultCache. */
+typedef struct {
+  char *dir;
+  uint64_t maxBytes;
+  uint64_t seed[2]; /* hash state after the grammar fingerprint */
+  atomic_ulong hits;
+  atomic_ulong misses;
+  atomic_ulong stores;
+  atomic_ulong storedBytes;
+  atomic_uint tempCounter;
+  pthread_mutex_t flushLock;
+  resultCacheStats flushed; /* counters already in the stats file */
+  atomic_ulong flushedBytes;
+} resultCache;
+
+#endif
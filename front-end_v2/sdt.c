@@ -0,0 +1,789 @@
+#include "sdt.h"
+#include "util.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const sdtAttr NO_ATTR = {0, -1, 0};
+
+static int isEpsilonRule(const GrammarRule *rule) {
+  return rule->rhs[0].type == SYMBOL_TERMINAL &&
+         rule->rhs[0].symbol.terminal == TK_EPSILON;
+}
+
+/* ---- engine ---- */
+
+typedef struct {
+  const sdtScheme *S;
+  sdtFrame *frames;
+  uint32_t frameCount;
+  uint32_t frameCapacity;
+  sdtAttr *values; /* kids of every frame on the stack, bottom to top */
+  uint32_t valueCount;
+  uint32_t valueCapacity;
+  sdtStats *st;
+} sdtEngine;
+
+static sdtFrame *topFrame(sdtEngine *E) {
+  sdtFrame *f = &E->frames[E->frameCount - 1];
+  f->kids = E->values + f->base;
+  return f;
+}
+
+static void sdtEnter(void *ctx, NonTerminal nt, const GrammarRule *rule) {
+  sdtEngine *E = (sdtEngine *)ctx;
+  int count = rule ? rule->rhsCount : 0;
+  E->frames = (sdtFrame *)growArray(E->frames, &E->frameCapacity,
+                                    E->frameCount + 1, sizeof(sdtFrame),
+                                    "translator stack");
+  E->values = (sdtAttr *)growArray(E->values, &E->valueCapacity,
+                                   E->valueCount + (uint32_t)count,
+                                   sizeof(sdtAttr), "attribute stack");
+
+  sdtFrame *child = &E->frames[E->frameCount];
+  child->nt = nt;
+  child->rule = rule;
+  child->next = 0;
+  child->inh = NO_ATTR;
+  child->syn = NO_ATTR;
+  child->base = E->valueCount;
+  child->kids = E->values + child->base;
+  for (int k = 0; k < count; k++)
+    child->kids[k] = NO_ATTR;
+  E->valueCount += (uint32_t)count;
+
+  if (E->frameCount > 0) {
+    sdtFrame *parent = topFrame(E);
+    child->inh = parent->inh;
+    sdtInheritHook hook = E->S->inherit[parent->nt];
+    if (hook && parent->rule)
+      hook(E->S->ctx, parent, parent->next, child);
+  }
+  if (++E->frameCount > E->st->maxFrames)
+    E->st->maxFrames = E->frameCount;
+}
+
+static void sdtMatch(void *ctx, TokenType expected, const tokenInfo *tk) {
+  sdtEngine *E = (sdtEngine *)ctx;
+  (void)expected;
+  if (E->frameCount == 0)
+    return;
+  sdtFrame *f = topFrame(E);
+  int pos = f->next++;
+  if (!f->rule || pos >= f->rule->rhsCount)
+    return;
+  f->kids[pos].line = tk ? tk->lineNumber : 0;
+  sdtTerminalHook hook = E->S->terminal[f->nt];
+  if (hook && tk)
+    hook(E->S->ctx, f, pos, tk);
+}
+
+static void sdtExit(void *ctx, NonTerminal nt, const GrammarRule *rule) {
+  sdtEngine *E = (sdtEngine *)ctx;
+  sdtFrame *f = topFrame(E);
+  if (rule) {
+    if (E->S->synthesize[nt])
+      E->S->synthesize[nt](E->S->ctx, f);
+    else if (rule->rhsCount == 1 && !isEpsilonRule(rule))
+      f->syn = f->kids[0];
+  }
+  sdtAttr syn = f->syn;
+  E->valueCount = f->base;
+  if (--E->frameCount == 0)
+    return;
+  sdtFrame *parent = topFrame(E);
+  int pos = parent->next++;
+  if (parent->rule && pos < parent->rule->rhsCount)
+    parent->kids[pos] = syn;
+}
+
+static void sdtError(void *ctx, int line, const char *message) {
+  sdtEngine *E = (sdtEngine *)ctx;
+  E->st->syntaxErrors++;
+  if (E->S->error)
+    E->S->error(E->S->ctx, line, message);
+  else
+    fprintf(stderr, "Line %d\tError: %s\n", line, message);
+}
+
+int translateSourceCode(char *testcaseFile, table *T, grammar *G,
+                        const sdtScheme *S, sdtStats *st) {
+  sdtStats local;
+  if (!st)
+    st = &local;
+  memset(st, 0, sizeof(*st));
+  sdtEngine E;
+  memset(&E, 0, sizeof(E));
+  E.S = S;
+  E.st = st;
+  parseListener listener = {&E, sdtEnter, sdtExit, sdtMatch, sdtError};
+  int ok = parseInputSourceCodeStreaming(testcaseFile, T, G, &listener);
+  free(E.frames);
+  free(E.values);
+  return ok;
+}
+
+/* ---- straight-line translator ---- */
+
+enum { TY_NONE, TY_INT, TY_REAL, TY_BOOL, TY_RECORD };
+
+#define SCOPE_GLOBAL 0u
+#define SCOPE_TYPE 0xFFFFFFFFu
+#define SCOPE_FIELD 0x80000000u /* | record index */
+
+typedef struct {
+  uint32_t name; /* offset in names */
+  uint32_t scope;
+  int32_t type;
+  uint32_t hash;
+} slName;
+
+typedef struct {
+  uint32_t name;
+  uint32_t fields;
+} slRecord;
+
+/* Record types are TY_RECORD + index into records. Operand text lives in
+   `text`, which is emptied at the start of every function. */
+typedef struct {
+  FILE *out;
+  sdtStats *st;
+  char *text;
+  uint32_t textSize;
+  uint32_t textCapacity;
+  char *names;
+  uint32_t namesSize;
+  uint32_t namesCapacity;
+  slName *table;
+  uint32_t count;
+  uint32_t capacity;
+  uint32_t *slots; /* open addressing, index + 1, 0 = empty */
+  uint32_t slotCount;
+  slRecord *records;
+  uint32_t recordCount;
+  uint32_t recordCapacity;
+  uint32_t scope;
+  uint32_t temps;
+  int syntaxErrorLine; /* type errors there are likely fallout; drop them */
+} slTranslator;
+
+static uint32_t slHash(uint32_t scope, const char *s) {
+  uint64_t h = fnv1a(s, strlen(s), fnv1a(&scope, sizeof(scope), FNV1A_BASIS));
+  return (uint32_t)(h ^ (h >> 32));
+}
+
+static uint32_t slAppend(char **pool, uint32_t *size, uint32_t *capacity,
+                         const char *s, const char *what) {
+  uint32_t n = (uint32_t)strlen(s) + 1;
+  *pool = (char *)growArray(*pool, capacity, *size + n, 1, what);
+  memcpy(*pool + *size, s, n);
+  uint32_t at = *size;
+  *size += n;
+  return at;
+}
+
+static int32_t slText(slTranslator *X, const char *s) {
+  return (int32_t)slAppend(&X->text, &X->textSize, &X->textCapacity, s,
+                           "operand text");
+}
+
+static const char *slOperand(const slTranslator *X, sdtAttr a) {
+  return a.place < 0 ? "?" : X->text + a.place;
+}
+
+static int32_t slConcat(slTranslator *X, sdtAttr a, const char *sep,
+                        sdtAttr b) {
+  const char *l = slOperand(X, a), *r = slOperand(X, b);
+  size_t n = strlen(l) + strlen(sep) + strlen(r) + 1;
+  X->text = (char *)growArray(X->text, &X->textCapacity,
+                              X->textSize + (uint32_t)n, 1, "operand text");
+  l = slOperand(X, a);
+  r = slOperand(X, b);
+  int32_t at = (int32_t)X->textSize;
+  snprintf(X->text + at, n, "%s%s%s", l, sep, r);
+  X->textSize += (uint32_t)n;
+  return at;
+}
+
+static void slRehash(slTranslator *X) {
+  uint32_t cap = 64;
+  while (cap < 2 * X->count + 2)
+    cap *= 2;
+  free(X->slots);
+  X->slots = (uint32_t *)calloc(cap, sizeof(uint32_t));
+  if (!X->slots) {
+    fprintf(stderr, "calloc failed for translator names\n");
+    exit(1);
+  }
+  X->slotCount = cap;
+  for (uint32_t i = 0; i < X->count; i++) {
+    uint32_t s = X->table[i].hash & (cap - 1);
+    while (X->slots[s])
+      s = (s + 1) & (cap - 1);
+    X->slots[s] = i + 1;
+  }
+}
+
+static slName *slLookup(slTranslator *X, uint32_t scope, const char *name) {
+  if (!X->slotCount)
+    return NULL;
+  uint32_t h = slHash(scope, name);
+  for (uint32_t s = h & (X->slotCount - 1); X->slots[s];
+       s = (s + 1) & (X->slotCount - 1)) {
+    slName *e = &X->table[X->slots[s] - 1];
+    if (e->hash == h && e->scope == scope &&
+        strcmp(X->names + e->name, name) == 0)
+      return e;
+  }
+  return NULL;
+}
+
+static slName *slDefine(slTranslator *X, uint32_t scope, const char *name,
+                        int32_t type) {
+  if (2 * (X->count + 1) >= X->slotCount)
+    slRehash(X);
+  X->table = (slName *)growArray(X->table, &X->capacity, X->count + 1,
+                                 sizeof(slName), "translator names");
+  slName *e = &X->table[X->count];
+  e->name = slAppend(&X->names, &X->namesSize, &X->namesCapacity, name,
+                     "translator names");
+  e->scope = scope;
+  e->type = type;
+  e->hash = slHash(scope, name);
+  uint32_t s = e->hash & (X->slotCount - 1);
+  while (X->slots[s])
+    s = (s + 1) & (X->slotCount - 1);
+  X->slots[s] = ++X->count;
+  return e;
+}
+
+static void slError(slTranslator *X, int line, const char *fmt, ...) {
+  char msg[512];
+  va_list ap;
+  if (line == X->syntaxErrorLine)
+    return;
+  va_start(ap, fmt);
+  vsnprintf(msg, sizeof(msg), fmt, ap);
+  va_end(ap);
+  fprintf(stderr, "Line %d\tError: %s\n", line, msg);
+  X->st->typeErrors++;
+}
+
+static void slSyntaxError(void *ctx, int line, const char *message) {
+  ((slTranslator *)ctx)->syntaxErrorLine = line;
+  fprintf(stderr, "Line %d\tError: %s\n", line, message);
+}
+
+static void slEmit(slTranslator *X, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  fputc('\t', X->out);
+  vfprintf(X->out, fmt, ap);
+  fputc('\n', X->out);
+  va_end(ap);
+  X->st->instructions++;
+}
+
+static int32_t slRecordType(slTranslator *X, const char *ruid) {
+  slName *e = slLookup(X, SCOPE_TYPE, ruid);
+  if (e)
+    return e->type;
+  X->records = (slRecord *)growArray(X->records, &X->recordCapacity,
+                                     X->recordCount + 1, sizeof(slRecord),
+                                     "record types");
+  int32_t type = TY_RECORD + (int32_t)X->recordCount;
+  e = slDefine(X, SCOPE_TYPE, ruid, type);
+  X->records[X->recordCount].name = e->name;
+  X->records[X->recordCount].fields = 0;
+  X->recordCount++;
+  return type;
+}
+
+static const char *slTypeName(const slTranslator *X, int32_t type) {
+  switch (type) {
+  case TY_INT:
+    return "int";
+  case TY_REAL:
+    return "real";
+  case TY_BOOL:
+    return "boolean";
+  case TY_NONE:
+    return "?";
+  default:
+    return X->names + X->records[type - TY_RECORD].name;
+  }
+}
+
+static const char *slOpName(int32_t op) {
+  switch (op) {
+  case TK_PLUS:
+    return "+";
+  case TK_MINUS:
+    return "-";
+  case TK_MUL:
+    return "*";
+  case TK_DIV:
+    return "/";
+  case TK_LT:
+    return "<";
+  case TK_LE:
+    return "<=";
+  case TK_EQ:
+    return "==";
+  case TK_GT:
+    return ">";
+  case TK_GE:
+    return ">=";
+  case TK_NE:
+    return "!=";
+  case TK_AND:
+    return "&&";
+  case TK_OR:
+    return "||";
+  default:
+    return "?";
+  }
+}
+
+static sdtAttr slTemp(slTranslator *X, int32_t type, int32_t line) {
+  char name[16];
+  snprintf(name, sizeof(name), "t%u", ++X->temps);
+  X->st->temporaries++;
+  sdtAttr t = {type, slText(X, name), line};
+  return t;
+}
+
+static sdtAttr slVariable(slTranslator *X, const char *name, int line) {
+  slName *e = slLookup(X, X->scope, name);
+  if (!e)
+    e = slLookup(X, SCOPE_GLOBAL, name);
+  if (!e)
+    slError(X, line, "Variable %s is not declared", name);
+  sdtAttr a = {e ? e->type : TY_NONE, slText(X, name), line};
+  return a;
+}
+
+static void slDeclare(slTranslator *X, uint32_t scope, const char *name,
+                      int32_t type, int line) {
+  if (slLookup(X, scope, name) ||
+      (scope != SCOPE_GLOBAL && slLookup(X, SCOPE_GLOBAL, name)))
+    slError(X, line, "Variable %s is declared more than once", name);
+  else
+    slDefine(X, scope, name, type);
+}
+
+/* Operands: op attributes carry the operator's TokenType in place. */
+static sdtAttr slArith(slTranslator *X, sdtAttr a, sdtAttr op, sdtAttr b) {
+  int32_t type = TY_NONE;
+  int scalarA = a.type == TY_INT || a.type == TY_REAL;
+  int scalarB = b.type == TY_INT || b.type == TY_REAL;
+  int scaling = op.place == TK_MUL || op.place == TK_DIV;
+  if (a.type == TY_NONE || b.type == TY_NONE)
+    type = TY_NONE;
+  else if (a.type == b.type && a.type != TY_BOOL && (scalarA || !scaling))
+    type = a.type;
+  else if (a.type >= TY_RECORD && scalarB && scaling)
+    type = a.type;
+  else if (scalarA && b.type >= TY_RECORD && op.place == TK_MUL)
+    type = b.type;
+  else
+    slError(X, op.line, "Type mismatch: %s %s %s", slTypeName(X, a.type),
+            slOpName(op.place), slTypeName(X, b.type));
+  sdtAttr t = slTemp(X, type, op.line);
+  slEmit(X, "%s = %s %s %s", slOperand(X, t), slOperand(X, a),
+         slOpName(op.place), slOperand(X, b));
+  return t;
+}
+
+static sdtAttr slCompare(slTranslator *X, sdtAttr a, sdtAttr op, sdtAttr b) {
+  if (a.type != TY_NONE && b.type != TY_NONE &&
+      (a.type != b.type || (a.type != TY_INT && a.type != TY_REAL)))
+    slError(X, op.line, "Type mismatch: %s %s %s", slTypeName(X, a.type),
+            slOpName(op.place), slTypeName(X, b.type));
+  sdtAttr t = slTemp(X, TY_BOOL, op.line);
+  slEmit(X, "%s = %s %s %s", slOperand(X, t), slOperand(X, a),
+         slOpName(op.place), slOperand(X, b));
+  return t;
+}
+
+static uint32_t slLabels(slTranslator *X, uint32_t n) {
+  uint32_t first = X->st->labels;
+  X->st->labels += n;
+  return first;
+}
+
+static void slLabel(slTranslator *X, int32_t label) {
+  fprintf(X->out, "L%d:\n", label);
+}
+
+static void slBeginFunction(slTranslator *X, const char *name) {
+  X->scope++;
+  X->temps = 0;
+  X->textSize = 0;
+  X->st->functions++;
+  fprintf(X->out, "%s%s:\n", X->scope > 1 ? "\n" : "", name);
+}
+
+static void functionTerminal(void *ctx, sdtFrame *f, int pos,
+                             const tokenInfo *tk) {
+  (void)f;
+  if (pos == 0)
+    slBeginFunction((slTranslator *)ctx, tk->lexeme);
+}
+
+static void primitiveTerminal(void *ctx, sdtFrame *f, int pos,
+                              const tokenInfo *tk) {
+  (void)ctx;
+  f->kids[pos].type = tk->tokenType == TK_INT ? TY_INT : TY_REAL;
+}
+
+static void recordNameTerminal(void *ctx, sdtFrame *f, int pos,
+                               const tokenInfo *tk) {
+  if (tk->tokenType == TK_RUID)
+    f->kids[pos].type = slRecordType((slTranslator *)ctx, tk->lexeme);
+}
+
+static void lastSynthesize(void *ctx, sdtFrame *f) {
+  (void)ctx;
+  f->syn = f->kids[f->rule->rhsCount - 1];
+}
+
+static void parameterTerminal(void *ctx, sdtFrame *f, int pos,
+                              const tokenInfo *tk) {
+  slTranslator *X = (slTranslator *)ctx;
+  if (pos == 1)
+    slDeclare(X, X->scope, tk->lexeme, f->kids[0].type, tk->lineNumber);
+}
+
+static void typeDefinitionInherit(void *ctx, sdtFrame *f, int pos,
+                                  sdtFrame *child) {
+  (void)ctx;
+  if (pos == 2)
+    child->inh.type = f->kids[1].type;
+}
+
+static void fieldTerminal(void *ctx, sdtFrame *f, int pos,
+                          const tokenInfo *tk) {
+  slTranslator *X = (slTranslator *)ctx;
+  if (pos != 3 || f->inh.type < TY_RECORD)
+    return;
+  uint32_t record = (uint32_t)(f->inh.type - TY_RECORD);
+  if (slLookup(X, SCOPE_FIELD | record, tk->lexeme)) {
+    slError(X, tk->lineNumber, "Field %s is defined more than once in %s",
+            tk->lexeme, slTypeName(X, f->inh.type));
+    return;
+  }
+  slDefine(X, SCOPE_FIELD | record, tk->lexeme, f->kids[1].type);
+  X->records[record].fields++;
+}
+
+static void definetypeTerminal(void *ctx, sdtFrame *f, int pos,
+                               const tokenInfo *tk) {
+  slTranslator *X = (slTranslator *)ctx;
+  if (pos == 2)
+    f->kids[2].type = slRecordType(X, tk->lexeme);
+  else if (pos == 4 && !slLookup(X, SCOPE_TYPE, tk->lexeme))
+    slDefine(X, SCOPE_TYPE, tk->lexeme, f->kids[2].type);
+}
+
+static void declarationTerminal(void *ctx, sdtFrame *f, int pos,
+                                const tokenInfo *tk) {
+  slTranslator *X = (slTranslator *)ctx;
+  if (pos == 3)
+    f->kids[3].place = slText(X, tk->lexeme);
+  else if (pos == 5 && f->kids[3].place >= 0)
+    slDeclare(X, f->kids[4].type ? SCOPE_GLOBAL : X->scope,
+              X->text + f->kids[3].place, f->kids[1].type, f->kids[3].line);
+}
+
+static void globalSynthesize(void *ctx, sdtFrame *f) {
+  (void)ctx;
+  f->syn.type = f->rule->rhsCount == 2;
+}
+
+static void idTerminal(void *ctx, sdtFrame *f, int pos, const tokenInfo *tk) {
+  if (tk->tokenType == TK_ID)
+    f->kids[pos] = slVariable((slTranslator *)ctx, tk->lexeme, tk->lineNumber);
+}
+
+/* <A> ===> <x> <rest>: rest inherits x's attribute and the result is
+   rest's (or A's own inh when A derives eps). */
+static void chainInherit(void *ctx, sdtFrame *f, int pos, sdtFrame *child) {
+  (void)ctx;
+  if (pos == 1)
+    child->inh = f->kids[0];
+}
+
+static void chainSynthesize(void *ctx, sdtFrame *f) {
+  (void)ctx;
+  f->syn = isEpsilonRule(f->rule) ? f->inh : f->kids[1];
+}
+
+static void expansionTerminal(void *ctx, sdtFrame *f, int pos,
+                              const tokenInfo *tk) {
+  slTranslator *X = (slTranslator *)ctx;
+  if (pos != 1)
+    return;
+  sdtAttr base = f->inh;
+  int32_t type = TY_NONE;
+  if (base.type >= TY_RECORD) {
+    uint32_t record = (uint32_t)(base.type - TY_RECORD);
+    slName *e = slLookup(X, SCOPE_FIELD | record, tk->lexeme);
+    if (e)
+      type = e->type;
+    else if (X->records[record].fields)
+      slError(X, tk->lineNumber, "%s has no field %s",
+              slTypeName(X, base.type), tk->lexeme);
+  } else if (base.type != TY_NONE) {
+    slError(X, tk->lineNumber, "%s of type %s is not a record or union",
+            slOperand(X, base), slTypeName(X, base.type));
+  }
+  sdtAttr field = {TY_NONE, slText(X, tk->lexeme), tk->lineNumber};
+  f->kids[1].place = slConcat(X, base, ".", field);
+  f->kids[1].type = type;
+}
+
+static void secondSynthesize(void *ctx, sdtFrame *f) {
+  (void)ctx;
+  f->syn = f->kids[1];
+}
+
+/* <expPrime> ===> <op> <term> <expPrime>: the left operand comes in as
+   inh, so each operator is emitted as soon as its right operand is done. */
+static void primeInherit(void *ctx, sdtFrame *f, int pos, sdtFrame *child) {
+  if (pos == 2)
+    child->inh = slArith((slTranslator *)ctx, f->inh, f->kids[0], f->kids[1]);
+}
+
+static void primeSynthesize(void *ctx, sdtFrame *f) {
+  (void)ctx;
+  f->syn = isEpsilonRule(f->rule) ? f->inh : f->kids[2];
+}
+
+static void operatorTerminal(void *ctx, sdtFrame *f, int pos,
+                             const tokenInfo *tk) {
+  (void)ctx;
+  f->kids[pos].place = (int32_t)tk->tokenType;
+}
+
+static void factorSynthesize(void *ctx, sdtFrame *f) {
+  (void)ctx;
+  f->syn = f->kids[f->rule->rhsCount == 3 ? 1 : 0];
+}
+
+static void varTerminal(void *ctx, sdtFrame *f, int pos, const tokenInfo *tk) {
+  f->kids[pos].type = tk->tokenType == TK_NUM ? TY_INT : TY_REAL;
+  f->kids[pos].place = slText((slTranslator *)ctx, tk->lexeme);
+}
+
+static void booleanSynthesize(void *ctx, sdtFrame *f) {
+  slTranslator *X = (slTranslator *)ctx;
+  sdtAttr *k = f->kids;
+  const GrammarSymbol *first = &f->rule->rhs[0];
+  if (first->type == SYMBOL_NON_TERMINAL) {
+    f->syn = slCompare(X, k[0], k[1], k[2]);
+  } else if (first->symbol.terminal == TK_NOT) {
+    f->syn = slTemp(X, TY_BOOL, k[0].line);
+    slEmit(X, "%s = ! %s", slOperand(X, f->syn), slOperand(X, k[2]));
+  } else {
+    f->syn = slTemp(X, TY_BOOL, k[3].line);
+    slEmit(X, "%s = %s %s %s", slOperand(X, f->syn), slOperand(X, k[1]),
+           slOpName(k[3].place), slOperand(X, k[5]));
+  }
+}
+
+static void assignmentTerminal(void *ctx, sdtFrame *f, int pos,
+                               const tokenInfo *tk) {
+  slTranslator *X = (slTranslator *)ctx;
+  (void)tk;
+  if (pos != 3)
+    return;
+  sdtAttr lhs = f->kids[0], rhs = f->kids[2];
+  if (lhs.type != TY_NONE && rhs.type != TY_NONE && lhs.type != rhs.type)
+    slError(X, f->kids[1].line, "Type mismatch: assigning %s to %s of type %s",
+            slTypeName(X, rhs.type), slOperand(X, lhs),
+            slTypeName(X, lhs.type));
+  slEmit(X, "%s = %s", slOperand(X, lhs), slOperand(X, rhs));
+  X->st->statements++;
+}
+
+static void ioTerminal(void *ctx, sdtFrame *f, int pos, const tokenInfo *tk) {
+  slTranslator *X = (slTranslator *)ctx;
+  (void)tk;
+  if (pos != 4)
+    return;
+  int isRead = f->rule->rhs[0].symbol.terminal == TK_READ;
+  slEmit(X, "%s %s", isRead ? "read" : "write", slOperand(X, f->kids[2]));
+  X->st->statements++;
+}
+
+static void iterativeTerminal(void *ctx, sdtFrame *f, int pos,
+                              const tokenInfo *tk) {
+  slTranslator *X = (slTranslator *)ctx;
+  (void)tk;
+  if (pos == 0) {
+    f->kids[0].place = (int32_t)slLabels(X, 2);
+    slLabel(X, f->kids[0].place);
+  } else if (pos == 3) {
+    slEmit(X, "ifFalse %s goto L%d", slOperand(X, f->kids[2]),
+           f->kids[0].place + 1);
+  } else if (pos == 6) {
+    slEmit(X, "goto L%d", f->kids[0].place);
+    slLabel(X, f->kids[0].place + 1);
+    X->st->statements++;
+  }
+}
+
+static void conditionalTerminal(void *ctx, sdtFrame *f, int pos,
+                                const tokenInfo *tk) {
+  slTranslator *X = (slTranslator *)ctx;
+  (void)tk;
+  if (pos == 0)
+    f->kids[0].place = (int32_t)slLabels(X, 2);
+  else if (pos == 3)
+    slEmit(X, "ifFalse %s goto L%d", slOperand(X, f->kids[2]),
+           f->kids[0].place);
+}
+
+static void conditionalInherit(void *ctx, sdtFrame *f, int pos,
+                               sdtFrame *child) {
+  (void)ctx;
+  if (pos == 7)
+    child->inh.place = f->kids[0].place;
+}
+
+/* inh.place: the else label; the end label follows it. */
+static void elseTerminal(void *ctx, sdtFrame *f, int pos,
+                         const tokenInfo *tk) {
+  slTranslator *X = (slTranslator *)ctx;
+  (void)pos;
+  if (tk->tokenType == TK_ELSE) {
+    slEmit(X, "goto L%d", f->inh.place + 1);
+    slLabel(X, f->inh.place);
+  } else if (tk->tokenType == TK_ENDIF) {
+    slLabel(X, f->inh.place + (f->rule->rhsCount > 1));
+    X->st->statements++;
+  }
+}
+
+static void funCallTerminal(void *ctx, sdtFrame *f, int pos,
+                            const tokenInfo *tk) {
+  slTranslator *X = (slTranslator *)ctx;
+  if (pos == 2) {
+    f->kids[2].place = slText(X, tk->lexeme);
+  } else if (pos == 6) {
+    if (f->kids[0].place >= 0)
+      slEmit(X, "[%s] = call %s(%s)", slOperand(X, f->kids[0]),
+             slOperand(X, f->kids[2]), slOperand(X, f->kids[5]));
+    else
+      slEmit(X, "call %s(%s)", slOperand(X, f->kids[2]),
+             slOperand(X, f->kids[5]));
+    X->st->statements++;
+  }
+}
+
+/* Optional lists: the <idList> inside, or nothing. */
+static void listSynthesize(void *ctx, sdtFrame *f) {
+  (void)ctx;
+  if (!isEpsilonRule(f->rule))
+    f->syn = f->kids[1];
+}
+
+static void idListSynthesize(void *ctx, sdtFrame *f) {
+  slTranslator *X = (slTranslator *)ctx;
+  f->syn = f->kids[0];
+  if (f->kids[1].place >= 0)
+    f->syn.place = slConcat(X, f->kids[0], ", ", f->kids[1]);
+}
+
+static void returnTerminal(void *ctx, sdtFrame *f, int pos,
+                           const tokenInfo *tk) {
+  slTranslator *X = (slTranslator *)ctx;
+  (void)tk;
+  if (pos != 2)
+    return;
+  if (f->kids[1].place >= 0)
+    slEmit(X, "return %s", slOperand(X, f->kids[1]));
+  else
+    slEmit(X, "return");
+  X->st->statements++;
+}
+
+int translateStraightLine(char *testcaseFile, table *T, grammar *G, FILE *out,
+                          sdtStats *st) {
+  sdtStats local;
+  if (!st)
+    st = &local;
+  slTranslator X;
+  memset(&X, 0, sizeof(X));
+  X.out = out;
+  X.st = st;
+  X.syntaxErrorLine = -1;
+
+  sdtScheme S;
+  memset(&S, 0, sizeof(S));
+  S.ctx = &X;
+  S.error = slSyntaxError;
+  S.terminal[NT_MAINFUNCTION] = functionTerminal;
+  S.terminal[NT_FUNCTION] = functionTerminal;
+  S.terminal[NT_PRIMITIVEDATATYPE] = primitiveTerminal;
+  S.terminal[NT_CONSTRUCTEDDATATYPE] = recordNameTerminal;
+  S.synthesize[NT_CONSTRUCTEDDATATYPE] = lastSynthesize;
+  S.terminal[NT_PARAMETER_LIST] = parameterTerminal;
+  S.terminal[NT_TYPEDEFINITION] = recordNameTerminal;
+  S.inherit[NT_TYPEDEFINITION] = typeDefinitionInherit;
+  S.terminal[NT_FIELDTYPE] = recordNameTerminal;
+  S.terminal[NT_FIELDDEFINITION] = fieldTerminal;
+  S.terminal[NT_DEFINETYPESTMT] = definetypeTerminal;
+  S.terminal[NT_DECLARATION] = declarationTerminal;
+  S.synthesize[NT_GLOBAL_OR_NOT] = globalSynthesize;
+  S.terminal[NT_SINGLEORRECID] = idTerminal;
+  S.inherit[NT_SINGLEORRECID] = chainInherit;
+  S.synthesize[NT_SINGLEORRECID] = chainSynthesize;
+  S.inherit[NT_OPTION_SINGLE_CONSTRUCTED] = chainInherit;
+  S.synthesize[NT_OPTION_SINGLE_CONSTRUCTED] = chainSynthesize;
+  S.inherit[NT_MOREEXPANSIONS] = chainInherit;
+  S.synthesize[NT_MOREEXPANSIONS] = chainSynthesize;
+  S.terminal[NT_ONEEXPANSION] = expansionTerminal;
+  S.synthesize[NT_ONEEXPANSION] = secondSynthesize;
+  S.inherit[NT_ARITHMETICEXPRESSION] = chainInherit;
+  S.synthesize[NT_ARITHMETICEXPRESSION] = chainSynthesize;
+  S.inherit[NT_TERM] = chainInherit;
+  S.synthesize[NT_TERM] = chainSynthesize;
+  S.inherit[NT_EXPPRIME] = primeInherit;
+  S.synthesize[NT_EXPPRIME] = primeSynthesize;
+  S.inherit[NT_TERMPRIME] = primeInherit;
+  S.synthesize[NT_TERMPRIME] = primeSynthesize;
+  S.terminal[NT_LOWPRECEDENCEOP] = operatorTerminal;
+  S.terminal[NT_HIGHPRECEDENCEOP] = operatorTerminal;
+  S.terminal[NT_RELATIONALOP] = operatorTerminal;
+  S.terminal[NT_LOGICALOP] = operatorTerminal;
+  S.synthesize[NT_FACTOR] = factorSynthesize;
+  S.terminal[NT_VAR] = varTerminal;
+  S.synthesize[NT_BOOLEANEXPRESSION] = booleanSynthesize;
+  S.terminal[NT_ASSIGNMENTSTMT] = assignmentTerminal;
+  S.terminal[NT_IOSTMT] = ioTerminal;
+  S.terminal[NT_ITERATIVESTMT] = iterativeTerminal;
+  S.terminal[NT_CONDITIONALSTMT] = conditionalTerminal;
+  S.inherit[NT_CONDITIONALSTMT] = conditionalInherit;
+  S.terminal[NT_ELSEPART] = elseTerminal;
+  S.terminal[NT_FUNCALLSTMT] = funCallTerminal;
+  S.synthesize[NT_OUTPUTPARAMETERS] = listSynthesize;
+  S.synthesize[NT_INPUTPARAMETERS] = secondSynthesize;
+  S.synthesize[NT_OPTIONALRETURN] = listSynthesize;
+  S.terminal[NT_IDLIST] = idTerminal;
+  S.synthesize[NT_IDLIST] = idListSynthesize;
+  S.synthesize[NT_MORE_IDS] = listSynthesize;
+  S.terminal[NT_RETURNSTMT] = returnTerminal;
+
+  int ok = translateSourceCode(testcaseFile, T, G, &S, st);
+  free(X.text);
+  free(X.names);
+  free(X.table);
+  free(X.slots);
+  free(X.records);
+  if (ok > 0 && st->typeErrors)
+    ok = 0;
+  return ok;
+}
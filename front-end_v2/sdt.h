@@ -0,0 +1,22 @@
+#ifndef SDT_H
+#define SDT_H
+#include "sdtDef.h"
+#include "parser.h"
+#include <stdio.h>
+
+/* Runs the LL(1) driver over testcaseFile and evaluates S's hooks as it
+   expands and matches symbols, without building a tree. Frames mirror the
+   nonterminals on the parser stack, so attributes flow down (inh) and up
+   (syn) in a single left-to-right pass. Returns 1 if the input is
+   syntactically correct, 0 on errors, -1 if the file cannot be opened. */
+int translateSourceCode(char *testcaseFile, table *T, grammar *G,
+                        const sdtScheme *S, sdtStats *st);
+
+/* Built-in scheme: type-checks declarations, assignments, expressions,
+   conditions, I/O, calls and returns and writes three-address code for
+   them to out, all during the parse. Returns 1 if the input has neither
+   syntax nor type errors, 0 otherwise, -1 if it cannot be opened. */
+int translateStraightLine(char *testcaseFile, table *T, grammar *G, FILE *out,
+                          sdtStats *st);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef SDTDEF_H
+#define SDTDEF_H
+#include "parserDef.h"
+
+/* One attribute value. Its meaning is up to the scheme; the straight-line
+   translator keeps a type id in `type` and an operand (offset of its text
+   in the translator's pool, or -1) in `place`. */
+typedef struct {
+  int32_t type;
+  int32_t place;
+  int32_t line;
+} sdtAttr;
+
+/* A nonterminal on the translator's stack, pushed when the parser expands
+   it and popped when its rule is finished. kids[i] is the attribute of RHS
+   symbol i once it is done: set by the terminal hook for terminals, the
+   child's `syn` for nonterminals. `next` is the RHS position being worked
+   on. kids is only valid during a hook. */
+typedef struct {
+  NonTerminal nt;
+  const GrammarRule *rule; /* NULL if error recovery skipped it */
+  int next;
+  sdtAttr inh;
+  sdtAttr syn;
+  sdtAttr *kids;
+  uint32_t base;
+} sdtFrame;
+
+/* Semantic actions, attached to rules through their left-hand side; any
+   may be NULL. inherit[A] sets child->inh for RHS position pos of an A
+   frame (default: the parent's inh). terminal[A] runs when the terminal at
+   position pos of an A frame is matched. synthesize[A] sets frame->syn
+   once all of A's RHS is done (default: kids[0] for single-symbol rules).
+   error receives syntax errors; without it they go to stderr. */
+typedef void (*sdtInheritHook)(void *ctx, sdtFrame *parent, int pos,
+                               sdtFrame *child);
+typedef void (*sdtTerminalHook)(void *ctx, sdtFrame *frame, int pos,
+                                const tokenInfo *tk);
+typedef void (*sdtSynthesizeHook)(void *ctx, sdtFrame *frame);
+
+typedef struct {
+  void *ctx;
+  sdtInheritHook inherit[NT_COUNT];
+  sdtTerminalHook terminal[NT_COUNT];
+  sdtSynthesizeHook synthesize[NT_COUNT];
+  void (*error)(void *ctx, int line, const char *message);
+} sdtScheme;
+
+typedef struct {
+  uint32_t functions;
+  uint32_t statements;   /* statements translated */
+  uint32_t instructions; /* three-address instructions written */
+  uint32_t temporaries;
+  uint32_t labels;
+  uint32_t typeErrors;
+  uint32_t syntaxErrors;
+  uint32_t maxFrames; /* deepest translator stack */
+} sdtStats;
+
+#endif
@@ -0,0 +1,354 @@
+#define _POSIX_C_SOURCE 200809L
+#include "server.h"
+#include "parserContext.h"
+#include "resultCache.h"
+#include "treeFile.h"
+#include "util.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+static double serverClock(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int readFull(int fd, void *buf, size_t n) {
+  char *p = (char *)buf;
+  while (n > 0) {
+    ssize_t got = read(fd, p, n);
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got <= 0)
+      return -1;
+    p += got;
+    n -= (size_t)got;
+  }
+  return 0;
+}
+
+static int writeFull(int fd, const void *buf, size_t n) {
+  const char *p = (const char *)buf;
+  while (n > 0) {
+    ssize_t put = send(fd, p, n, MSG_NOSIGNAL);
+    if (put < 0 && errno == EINTR)
+      continue;
+    if (put <= 0)
+      return -1;
+    p += put;
+    n -= (size_t)put;
+  }
+  return 0;
+}
+
+/* ---- server ---- */
+
+typedef struct {
+  compileServer *srv;
+  int fd;
+  int slot;
+  parserContext *C;
+  char *source;
+  uint32_t sourceCapacity;
+  char *diag;
+  uint32_t diagSize;
+  uint32_t diagCapacity;
+} serverConn;
+
+static void appendDiag(serverConn *c, int line, const char *message) {
+  int n = snprintf(NULL, 0, "Line %d\tError: %s\n", line, message);
+  c->diag = (char *)growArray(c->diag, &c->diagCapacity,
+                              c->diagSize + (uint32_t)n + 1, 1,
+                              "server diagnostics");
+  snprintf(c->diag + c->diagSize, (size_t)n + 1, "Line %d\tError: %s\n", line,
+           message);
+  c->diagSize += (uint32_t)n;
+}
+
+static char *serverStats(compileServer *srv, size_t *size) {
+  char *text = (char *)malloc(512);
+  if (!text) {
+    fprintf(stderr, "malloc failed for server stats\n");
+    exit(1);
+  }
+  pthread_mutex_lock(&srv->lock);
+  int clients = srv->clients;
+  pthread_mutex_unlock(&srv->lock);
+  int n = snprintf(text, 512,
+                   "uptime %.3f s\nclients %d\nconnections %lu\n"
+                   "requests %lu\nbytes %lu\n",
+                   serverClock() - srv->started, clients,
+                   atomic_load(&srv->connections),
+                   atomic_load(&srv->requests), atomic_load(&srv->bytes));
+  if (srv->RC)
+    n += snprintf(text + n, 512 - (size_t)n,
+                  "cache hits %lu\ncache misses %lu\n",
+                  atomic_load(&srv->RC->hits), atomic_load(&srv->RC->misses));
+  *size = (size_t)n;
+  return text;
+}
+
+static int answer(serverConn *c, const serverRequest *rq) {
+  compileServer *srv = c->srv;
+  parserContext *C = c->C;
+  resetParserContext(C);
+  c->diagSize = 0;
+  char *data = NULL;
+  size_t dataSize = 0;
+  int status = 1;
+
+  switch (rq->op) {
+  case SERVER_LEX:
+    status = cachedResult(srv->RC, RESULT_LEX, C, c->source, rq->length);
+    data = (char *)serializeTree(&C->tree, &dataSize);
+    break;
+  case SERVER_CHECK:
+    status = cachedResult(srv->RC, RESULT_CHECK, C, c->source, rq->length);
+    break;
+  case SERVER_PARSE:
+    status = cachedResult(srv->RC, RESULT_PARSE, C, c->source, rq->length);
+    data = (char *)serializeTree(&C->tree, &dataSize);
+    break;
+  case SERVER_STATS:
+    data = serverStats(srv, &dataSize);
+    break;
+  case SERVER_SHUTDOWN:
+    atomic_store(&srv->stop, 1);
+    shutdown(srv->listenFd, SHUT_RDWR);
+    break;
+  default:
+    status = -1;
+    appendDiag(c, 0, "unknown request");
+    break;
+  }
+  for (int k = 0; k < C->diag.count; k++)
+    appendDiag(c, C->diag.items[k].lineNumber, C->diag.items[k].message);
+  atomic_fetch_add(&srv->requests, 1);
+  atomic_fetch_add(&srv->bytes, rq->length);
+
+  serverReply R;
+  R.magic = SERVER_MAGIC;
+  R.status = status;
+  R.errors = (uint32_t)C->diag.count;
+  R.diagLength = c->diagSize;
+  R.dataLength = dataSize;
+  int rc = writeFull(c->fd, &R, sizeof(R));
+  if (rc == 0 && c->diagSize)
+    rc = writeFull(c->fd, c->diag, c->diagSize);
+  if (rc == 0 && dataSize)
+    rc = writeFull(c->fd, data, dataSize);
+  free(data);
+  return rc;
+}
+
+static void *serveClient(void *arg) {
+  serverConn *c = (serverConn *)arg;
+  compileServer *srv = c->srv;
+  c->C = createParserContext(srv->S);
+
+  serverRequest rq;
+  while (readFull(c->fd, &rq, sizeof(rq)) == 0) {
+    if (rq.magic != SERVER_MAGIC || rq.length > SERVER_MAX_SOURCE)
+      break;
+    c->source = (char *)growArray(c->source, &c->sourceCapacity,
+                                  rq.length + 1, 1, "server source");
+    if (readFull(c->fd, c->source, rq.length) != 0)
+      break;
+    c->source[rq.length] = '\0';
+    if (answer(c, &rq) != 0)
+      break;
+  }
+
+  /* Give up the slot before closing, so that runServer never shuts down
+     a descriptor number that has been reused. */
+  pthread_mutex_lock(&srv->lock);
+  srv->clientFds[c->slot] = -1;
+  pthread_mutex_unlock(&srv->lock);
+  close(c->fd);
+  freeParserContext(c->C);
+  free(c->source);
+  free(c->diag);
+  pthread_mutex_lock(&srv->lock);
+  if (--srv->clients == 0)
+    pthread_cond_signal(&srv->idle);
+  pthread_mutex_unlock(&srv->lock);
+  free(c);
+  return NULL;
+}
+
+static void acceptClient(compileServer *srv, int fd) {
+  pthread_mutex_lock(&srv->lock);
+  int slot = -1;
+  for (int i = 0; i < SERVER_MAX_CLIENTS && slot < 0; i++)
+    if (srv->clientFds[i] < 0)
+      slot = i;
+  if (slot >= 0) {
+    srv->clientFds[slot] = fd;
+    srv->clients++;
+  }
+  pthread_mutex_unlock(&srv->lock);
+  if (slot < 0) {
+    close(fd);
+    return;
+  }
+
+  serverConn *c = (serverConn *)calloc(1, sizeof(serverConn));
+  if (!c) {
+    fprintf(stderr, "calloc failed for server connection\n");
+    exit(1);
+  }
+  c->srv = srv;
+  c->fd = fd;
+  c->slot = slot;
+  atomic_fetch_add(&srv->connections, 1);
+
+  pthread_t tid;
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  if (pthread_create(&tid, &attr, serveClient, c) != 0)
+    serveClient(c);
+  pthread_attr_destroy(&attr);
+}
+
+/* Removes a stale socket at path; anything else there is left alone.
+   Returns -1 if path exists and is not a socket. */
+static int removeSocket(const char *path) {
+  struct stat st;
+  if (lstat(path, &st) != 0)
+    return errno == ENOENT ? 0 : -1;
+  if (!S_ISSOCK(st.st_mode))
+    return -1;
+  unlink(path);
+  return 0;
+}
+
+int runServer(const char *socketPath, const parserShared *S,
+              resultCache *RC) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(socketPath) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Error: socket path %s is too long\n", socketPath);
+    return -1;
+  }
+  strcpy(addr.sun_path, socketPath);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    fprintf(stderr, "Error: Cannot create socket\n");
+    return -1;
+  }
+  if (removeSocket(socketPath) != 0) {
+    fprintf(stderr, "Error: %s exists and is not a socket\n", socketPath);
+    close(fd);
+    return -1;
+  }
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(fd, SERVER_MAX_CLIENTS) != 0) {
+    fprintf(stderr, "Error: Cannot listen on %s\n", socketPath);
+    close(fd);
+    return -1;
+  }
+
+  compileServer srv;
+  srv.S = S;
+  srv.RC = RC;
+  srv.listenFd = fd;
+  atomic_init(&srv.stop, 0);
+  pthread_mutex_init(&srv.lock, NULL);
+  pthread_cond_init(&srv.idle, NULL);
+  for (int i = 0; i < SERVER_MAX_CLIENTS; i++)
+    srv.clientFds[i] = -1;
+  srv.clients = 0;
+  atomic_init(&srv.connections, 0);
+  atomic_init(&srv.requests, 0);
+  atomic_init(&srv.bytes, 0);
+  srv.started = serverClock();
+
+  while (!atomic_load(&srv.stop)) {
+    int client = accept(fd, NULL, NULL);
+    if (client >= 0)
+      acceptClient(&srv, client);
+    else if (errno != EINTR && errno != ECONNABORTED)
+      break;
+  }
+
+  /* Wake clients blocked in read so their threads can finish. */
+  pthread_mutex_lock(&srv.lock);
+  for (int i = 0; i < SERVER_MAX_CLIENTS; i++)
+    if (srv.clientFds[i] >= 0)
+      shutdown(srv.clientFds[i], SHUT_RD);
+  while (srv.clients > 0)
+    pthread_cond_wait(&srv.idle, &srv.lock);
+  pthread_mutex_unlock(&srv.lock);
+
+  close(fd);
+  removeSocket(socketPath);
+  pthread_cond_destroy(&srv.idle);
+  pthread_mutex_destroy(&srv.lock);
+  return 0;
+}
+
+/* ---- client ---- */
+
+int connectServer(const char *socketPath) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(socketPath) >= sizeof(addr.sun_path))
+    return -1;
+  strcpy(addr.sun_path, socketPath);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int callServer(int fd, serverOp op, const char *text, size_t length,
+               serverResponse *R) {
+  memset(R, 0, sizeof(*R));
+  if (length > SERVER_MAX_SOURCE)
+    return -1;
+  serverRequest rq = {SERVER_MAGIC, (uint32_t)op, (uint32_t)length, 0};
+  double start = serverClock();
+  if (writeFull(fd, &rq, sizeof(rq)) != 0 ||
+      (length && writeFull(fd, text, length) != 0) ||
+      readFull(fd, &R->header, sizeof(R->header)) != 0 ||
+      R->header.magic != SERVER_MAGIC)
+    return -1;
+
+  R->diag = (char *)malloc((size_t)R->header.diagLength + 1);
+  R->data = (char *)malloc(R->header.dataLength ? R->header.dataLength : 1);
+  if (!R->diag || !R->data) {
+    fprintf(stderr, "malloc failed for server response\n");
+    exit(1);
+  }
+  if (readFull(fd, R->diag, R->header.diagLength) != 0 ||
+      readFull(fd, R->data, R->header.dataLength) != 0) {
+    freeServerResponse(R);
+    return -1;
+  }
+  R->diag[R->header.diagLength] = '\0';
+  R->seconds = serverClock() - start;
+  return 0;
+}
+
+void disconnectServer(int fd) { close(fd); }
+
+void freeServerResponse(serverResponse *R) {
+  free(R->diag);
+  free(R->data);
+  R->diag = R->data = NULL;
+}
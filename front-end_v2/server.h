@@ -0,0 +1,27 @@
+#ifndef SERVER_H
+#define SERVER_H
+#include "serverDef.h"
+#include <stddef.h>
+
+/* Listens on the Unix socket socketPath (replacing a stale one) and
+   answers requests with the tables of S until a SERVER_SHUTDOWN request.
+   Each client gets a thread and a parserContext of its own and may send
+   any number of requests over one connection. LEX, CHECK and PARSE
+   results go through the cache RC when it is not NULL. Returns 0, or -1
+   if the socket cannot be set up. */
+int runServer(const char *socketPath, const parserShared *S,
+              resultCache *RC);
+
+/* Client side. Returns the connected socket or -1. */
+int connectServer(const char *socketPath);
+
+/* Sends one request and waits for its reply. Returns 0 or -1 if the
+   connection failed. */
+int callServer(int fd, serverOp op, const char *text, size_t length,
+               serverResponse *R);
+
+void disconnectServer(int fd);
+
+void freeServerResponse(serverResponse *R);
+
+#endif
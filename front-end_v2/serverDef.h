@@ -0,0 +1,64 @@
+#ifndef SERVERDEF_H
+#define SERVERDEF_H
+#include "parserContextDef.h"
+#include "resultCacheDef.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define SERVER_MAGIC 0x31565350u /* "PSV1" */
+#define SERVER_MAX_SOURCE (64u << 20)
+#define SERVER_MAX_CLIENTS 64
+
+typedef enum {
+  SERVER_LEX = 1,
+  SERVER_CHECK,
+  SERVER_PARSE,
+  SERVER_STATS,
+  SERVER_SHUTDOWN
+} serverOp;
+
+/* A request is this header followed by `length` bytes of source text.
+   Fields are in host byte order: the socket never leaves the machine. */
+typedef struct {
+  uint32_t magic;
+  uint32_t op;
+  uint32_t length;
+  uint32_t reserved;
+} serverRequest;
+
+/* A reply is this header, diagLength bytes of diagnostics (the lines
+   printDiagnostics writes) and dataLength bytes of data: for PARSE the
+   tree and for LEX the token stream (no nodes), both as a treeFile image;
+   for STATS text. status is 1 for correct input, 0 on errors, -1 for a
+   bad request. */
+typedef struct {
+  uint32_t magic;
+  int32_t status;
+  uint32_t errors;
+  uint32_t diagLength;
+  uint64_t dataLength;
+} serverReply;
+
+typedef struct {
+  serverReply header;
+  char *diag; /* NUL-terminated */
+  char *data; /* 8-byte aligned, for openTreeImage */
+  double seconds; /* round trip, as seen by the client */
+} serverResponse;
+
+typedef struct {
+  const parserShared *S;
+  resultCache *RC; /* may be NULL */
+  int listenFd;
+  atomic_int stop;
+  pthread_mutex_t lock;
+  pthread_cond_t idle;
+  int clientFds[SERVER_MAX_CLIENTS]; /* -1 = free slot */
+  int clients;
+  atomic_ulong connections;
+  atomic_ulong requests;
+  atomic_ulong bytes;
+  double started;
+} compileServer;
+
+#endif
@@ -0,0 +1,118 @@
+#define _POSIX_C_SOURCE 200809L
+#include "tokenPipe.h"
+#include "lexer.h"
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Space a single token may need in a batch's string pool. */
+#define PIPE_TOKEN_BYTES (MAX_LEXEME_LENGTH + 256)
+
+static void addBatchToken(tokenBatch *B, const tokenInfo *tk) {
+  const char *text = tk->lexeme;
+  if (tk->tokenType == TK_ERROR && tk->errorMsg[0])
+    text = tk->errorMsg;
+  size_t len = strlen(text) + 1;
+
+  parseToken *t = &B->tokens[B->count++];
+  memset(t, 0, sizeof(*t));
+  t->tokenType = tk->tokenType;
+  t->lineNumber = tk->lineNumber;
+  t->hasValue = tk->hasValue;
+  if (tk->tokenType == TK_RNUM)
+    t->value.realValue = tk->value.realValue;
+  else
+    t->value.intValue = tk->value.intValue;
+  t->lexeme = B->lexemeSize;
+  memcpy(B->lexemes + B->lexemeSize, text, len);
+  B->lexemeSize += (uint32_t)len;
+}
+
+/* Waits for a free slot; returns NULL once the consumer has stopped. */
+static tokenBatch *claimBatch(tokenPipe *P, uint32_t head) {
+  for (;;) {
+    if (atomic_load_explicit(&P->stop, memory_order_relaxed))
+      return NULL;
+    if (head - atomic_load_explicit(&P->tail, memory_order_acquire) <
+        PIPE_RING_BATCHES)
+      break;
+    sched_yield();
+  }
+  tokenBatch *B = &P->ring[head % PIPE_RING_BATCHES];
+  B->count = 0;
+  B->lexemeSize = 0;
+  return B;
+}
+
+static void *lexerThread(void *arg) {
+  tokenPipe *P = (tokenPipe *)arg;
+  uint32_t head = atomic_load_explicit(&P->head, memory_order_relaxed);
+  tokenBatch *B = claimBatch(P, head);
+  tokenInfo tk;
+  while (B) {
+    scanNextToken(P->tb, &tk);
+    if (tk.tokenType == TK_COMMENT)
+      continue;
+    addBatchToken(B, &tk);
+    int last = tk.tokenType == TK_EOF;
+    if (last || B->count == PIPE_BATCH_TOKENS ||
+        B->lexemeSize + PIPE_TOKEN_BYTES > PIPE_BATCH_BYTES) {
+      atomic_store_explicit(&P->head, ++head, memory_order_release);
+      if (last)
+        break;
+      B = claimBatch(P, head);
+    }
+  }
+  return NULL;
+}
+
+tokenPipe *startTokenPipe(FILE *fp) {
+  tokenPipe *P = (tokenPipe *)malloc(sizeof(tokenPipe));
+  if (!P) {
+    fprintf(stderr, "malloc failed for token pipe\n");
+    exit(1);
+  }
+  atomic_init(&P->head, 0);
+  atomic_init(&P->tail, 0);
+  atomic_init(&P->stop, 0);
+  P->current = NULL;
+  P->pos = 0;
+  P->tb = initializeTwinBuffer(fp);
+  if (pthread_create(&P->thread, NULL, lexerThread, P) != 0) {
+    fprintf(stderr, "pthread_create failed for lexer thread\n");
+    exit(1);
+  }
+  return P;
+}
+
+const parseToken *tokenPipeNext(tokenPipe *P, const char **lexeme) {
+  tokenBatch *B = P->current;
+  if (B && P->pos == B->count) {
+    if (B->tokens[B->count - 1].tokenType == TK_EOF) {
+      *lexeme = B->lexemes + B->tokens[B->count - 1].lexeme;
+      return &B->tokens[B->count - 1];
+    }
+    atomic_fetch_add_explicit(&P->tail, 1, memory_order_release);
+    B = NULL;
+  }
+  if (!B) {
+    uint32_t tail = atomic_load_explicit(&P->tail, memory_order_relaxed);
+    while (atomic_load_explicit(&P->head, memory_order_acquire) == tail)
+      sched_yield();
+    B = P->current = &P->ring[tail % PIPE_RING_BATCHES];
+    P->pos = 0;
+  }
+  const parseToken *t = &B->tokens[P->pos++];
+  *lexeme = B->lexemes + t->lexeme;
+  return t;
+}
+
+void stopTokenPipe(tokenPipe *P) {
+  if (!P)
+    return;
+  atomic_store_explicit(&P->stop, 1, memory_order_relaxed);
+  pthread_join(P->thread, NULL);
+  freeTwinBuffer(P->tb);
+  free(P);
+}
@@ -0,0 +1,16 @@
+#ifndef TOKENPIPE_H
+#define TOKENPIPE_H
+#include "tokenPipeDef.h"
+
+/* Starts a lexer thread over fp (which the pipe then owns). */
+tokenPipe *startTokenPipe(FILE *fp);
+
+/* Next non-comment token, TK_EOF repeatedly at the end. The token and
+   *lexeme stay valid until the call that moves past the token's batch. */
+const parseToken *tokenPipeNext(tokenPipe *P, const char **lexeme);
+
+/* Stops the lexer thread (it may still be running if the parser finished
+   early), closes the input and frees the pipe. */
+void stopTokenPipe(tokenPipe *P);
+
+#endif
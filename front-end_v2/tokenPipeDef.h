@@ -0,0 +1,37 @@
+#ifndef TOKENPIPEDEF_H
+#define TOKENPIPEDEF_H
+#include "parserDef.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define PIPE_BATCH_TOKENS 512
+#define PIPE_BATCH_BYTES (PIPE_BATCH_TOKENS * 16)
+#define PIPE_RING_BATCHES 8
+
+/* A batch of non-comment tokens; lexeme offsets point into `lexemes`. For
+   TK_ERROR tokens the string is the message to report. */
+typedef struct {
+  uint32_t count;
+  uint32_t lexemeSize;
+  parseToken tokens[PIPE_BATCH_TOKENS];
+  char lexemes[PIPE_BATCH_BYTES];
+} tokenBatch;
+
+/* Single-producer/single-consumer ring of batches. The lexer thread fills
+   ring[head % PIPE_RING_BATCHES] and publishes it by advancing head; the
+   parser consumes ring[tail % ...] and hands it back by advancing tail. At
+   most PIPE_RING_BATCHES batches are ever allocated, so a lexer running
+   ahead waits instead of growing memory. */
+typedef struct tokenPipe {
+  tokenBatch ring[PIPE_RING_BATCHES];
+  _Atomic uint32_t head;
+  _Atomic uint32_t tail;
+  atomic_int stop;
+  twinBuffer *tb;
+  pthread_t thread;
+  /* consumer side */
+  tokenBatch *current;
+  uint32_t pos;
+} tokenPipe;
+
+#endif
@@ -0,0 +1,250 @@
+#include "treeDag.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  parseDag *D;
+  uint32_t *values; /* ids of the completed subtrees awaiting their parent */
+  uint32_t valueCount;
+  uint32_t valueCapacity;
+} dagBuilder;
+
+static void dagRehash(parseDag *D) {
+  uint32_t cap = 64;
+  while (cap < 2 * D->nodeCount + 2)
+    cap *= 2;
+  free(D->slots);
+  D->slots = (uint32_t *)calloc(cap, sizeof(uint32_t));
+  if (!D->slots) {
+    fprintf(stderr, "calloc failed for DAG slots\n");
+    exit(1);
+  }
+  D->slotCount = cap;
+  for (uint32_t i = 0; i < D->nodeCount; i++) {
+    uint32_t s = D->nodes[i].hash & (cap - 1);
+    while (D->slots[s])
+      s = (s + 1) & (cap - 1);
+    D->slots[s] = i + 1;
+  }
+}
+
+static int dagNodeMatches(const parseDag *D, const dagNode *n, uint32_t hash,
+                          SymbolType type, int id, const char *lexeme,
+                          const uint32_t *kids, uint32_t count) {
+  if (n->hash != hash || n->symbolType != (uint8_t)type ||
+      n->symbolId != (uint8_t)id || n->childCount != count)
+    return 0;
+  if ((n->lexeme == DAG_NONE) != (lexeme == NULL))
+    return 0;
+  if (lexeme && strcmp(D->lexemes + n->lexeme, lexeme) != 0)
+    return 0;
+  return count == 0 ||
+         memcmp(D->kids + n->kids, kids, count * sizeof(uint32_t)) == 0;
+}
+
+/* Returns the id of the subtree (type, id, lexeme, kids), adding it if it
+   has not been seen before. */
+static uint32_t dagIntern(parseDag *D, SymbolType type, int id,
+                          const char *lexeme, const uint32_t *kids,
+                          uint32_t count) {
+  uint8_t symbol[2] = {(uint8_t)type, (uint8_t)id};
+  uint64_t h = fnv1a(symbol, sizeof(symbol), FNV1A_BASIS);
+  h = fnv1a(kids, count * sizeof(uint32_t), h);
+  if (lexeme)
+    h = fnv1a(lexeme, strlen(lexeme), h);
+  uint32_t hash = (uint32_t)(h ^ (h >> 32));
+
+  D->treeNodes++;
+  if (2 * (D->nodeCount + 1) > D->slotCount)
+    dagRehash(D);
+  uint32_t s = hash & (D->slotCount - 1);
+  for (; D->slots[s]; s = (s + 1) & (D->slotCount - 1)) {
+    dagNode *n = &D->nodes[D->slots[s] - 1];
+    if (dagNodeMatches(D, n, hash, type, id, lexeme, kids, count)) {
+      n->uses++;
+      return D->slots[s] - 1;
+    }
+  }
+
+  D->nodes = growArray(D->nodes, &D->nodeCapacity, D->nodeCount + 1,
+                       sizeof(dagNode), "DAG nodes");
+  uint32_t idx = D->nodeCount++;
+  dagNode *n = &D->nodes[idx];
+  n->symbolType = (uint8_t)type;
+  n->symbolId = (uint8_t)id;
+  n->childCount = (uint16_t)count;
+  n->kids = D->kidCount;
+  n->lexeme = DAG_NONE;
+  n->uses = 1;
+  n->size = 1;
+  n->hash = hash;
+  if (count) {
+    D->kids = growArray(D->kids, &D->kidCapacity, D->kidCount + count,
+                        sizeof(uint32_t), "DAG child lists");
+    memcpy(D->kids + D->kidCount, kids, count * sizeof(uint32_t));
+    D->kidCount += count;
+    for (uint32_t i = 0; i < count; i++)
+      n->size += D->nodes[kids[i]].size;
+  }
+  if (lexeme) {
+    uint32_t len = (uint32_t)strlen(lexeme) + 1;
+    D->lexemes = growArray(D->lexemes, &D->lexemeCapacity, D->lexemeSize + len,
+                           1, "DAG lexeme pool");
+    memcpy(D->lexemes + D->lexemeSize, lexeme, len);
+    n->lexeme = D->lexemeSize;
+    D->lexemeSize += len;
+  }
+  D->slots[s] = idx + 1;
+  return idx;
+}
+
+static void pushValue(dagBuilder *b, uint32_t id) {
+  b->values = growArray(b->values, &b->valueCapacity, b->valueCount + 1,
+                        sizeof(uint32_t), "DAG value stack");
+  b->values[b->valueCount++] = id;
+}
+
+static void onMatch(void *ctx, TokenType expected, const tokenInfo *tk) {
+  dagBuilder *b = (dagBuilder *)ctx;
+  pushValue(b, dagIntern(b->D, SYMBOL_TERMINAL, expected,
+                         tk ? tk->lexeme : NULL, NULL, 0));
+}
+
+static void onExit(void *ctx, NonTerminal nt, const GrammarRule *rule) {
+  dagBuilder *b = (dagBuilder *)ctx;
+  if (!rule) {
+    pushValue(b, dagIntern(b->D, SYMBOL_NON_TERMINAL, nt, NULL, NULL, 0));
+    return;
+  }
+  uint32_t n = 0;
+  for (int i = 0; i < rule->rhsCount; i++)
+    if (!(rule->rhs[i].type == SYMBOL_TERMINAL &&
+          rule->rhs[i].symbol.terminal == TK_EPSILON))
+      n++;
+  if (n == 0) {
+    uint32_t eps =
+        dagIntern(b->D, SYMBOL_TERMINAL, TK_EPSILON, NULL, NULL, 0);
+    pushValue(b, dagIntern(b->D, SYMBOL_NON_TERMINAL, nt, NULL, &eps, 1));
+    return;
+  }
+  b->valueCount -= n;
+  uint32_t id = dagIntern(b->D, SYMBOL_NON_TERMINAL, nt, NULL,
+                          b->values + b->valueCount, n);
+  pushValue(b, id);
+}
+
+parseDag *buildParseDag(char *testcaseFile, table *T, grammar *G) {
+  parseDag *D = (parseDag *)calloc(1, sizeof(parseDag));
+  if (!D) {
+    fprintf(stderr, "calloc failed for parseDag\n");
+    exit(1);
+  }
+  D->root = DAG_NONE;
+
+  dagBuilder b = {D, NULL, 0, 0};
+  parseListener listener = {&b, NULL, onExit, onMatch, NULL};
+  if (parseInputSourceCodeStreaming(testcaseFile, T, G, &listener) < 0) {
+    free(b.values);
+    freeParseDag(D);
+    return NULL;
+  }
+  if (b.valueCount > 0)
+    D->root = b.values[b.valueCount - 1];
+  free(b.values);
+  return D;
+}
+
+dagStats getDagStats(const parseDag *D) {
+  dagStats S;
+  memset(&S, 0, sizeof(S));
+  S.treeNodes = D->treeNodes;
+  S.dagNodes = D->nodeCount;
+  for (uint32_t i = 0; i < D->nodeCount; i++)
+    if (D->nodes[i].uses > 1)
+      S.sharedNodes++;
+  S.ratio = D->nodeCount ? (double)D->treeNodes / D->nodeCount : 0;
+  S.dagBytes = (size_t)D->nodeCount * sizeof(dagNode) +
+               (size_t)D->kidCount * sizeof(uint32_t) + D->lexemeSize +
+               (size_t)D->slotCount * sizeof(uint32_t);
+  return S;
+}
+
+static const char *dagSymbolName(const dagNode *n) {
+  return n->symbolType == SYMBOL_TERMINAL
+             ? getTokenName((TokenType)n->symbolId)
+             : getNonTerminalName((NonTerminal)n->symbolId);
+}
+
+/* Nodes a repeated subtree would cost as separate copies. */
+static uint64_t dagSavings(const dagNode *n) {
+  return (uint64_t)(n->uses - 1) * n->size;
+}
+
+void printParseDag(const parseDag *D, char *outfile, int top) {
+  if (!D || D->root == DAG_NONE) {
+    fprintf(stderr, "Warning: empty DAG, nothing to print\n");
+    return;
+  }
+
+  FILE *fp = fopen(outfile, "w");
+  if (!fp) {
+    fprintf(stderr, "Error: Cannot open output file %s\n", outfile);
+    return;
+  }
+
+  fprintf(fp, "%-8s  %-30s  %-20s  %-8s  %-8s  %s\n", "id", "symbol",
+          "lexeme", "uses", "size", "children");
+  for (uint32_t i = 0; i < D->nodeCount; i++) {
+    const dagNode *n = &D->nodes[i];
+    fprintf(fp, "%-8u  %-30s  %-20s  %-8u  %-8u ", i, dagSymbolName(n),
+            n->lexeme != DAG_NONE ? D->lexemes + n->lexeme : "----", n->uses,
+            n->size);
+    for (uint32_t k = 0; k < n->childCount; k++)
+      fprintf(fp, " %u", D->kids[n->kids + k]);
+    fputc('\n', fp);
+  }
+  fprintf(fp, "root %u\n", D->root);
+
+  uint32_t *best = top > 0 ? (uint32_t *)malloc(top * sizeof(uint32_t)) : NULL;
+  if (top > 0 && !best) {
+    fprintf(stderr, "malloc failed in printParseDag\n");
+    exit(1);
+  }
+  int found = 0;
+  for (uint32_t i = 0; i < D->nodeCount && top > 0; i++) {
+    const dagNode *n = &D->nodes[i];
+    if (n->symbolType != SYMBOL_NON_TERMINAL || n->uses < 2 || n->size < 2)
+      continue;
+    int j = found < top ? found++ : top;
+    while (j > 0 && dagSavings(&D->nodes[best[j - 1]]) < dagSavings(n)) {
+      if (j < top)
+        best[j] = best[j - 1];
+      j--;
+    }
+    if (j < top)
+      best[j] = i;
+  }
+  if (found > 0) {
+    fprintf(fp, "\nMost repeated subtrees:\n");
+    for (int j = 0; j < found; j++) {
+      const dagNode *n = &D->nodes[best[j]];
+      fprintf(fp, "%-8u  %-30s  %u uses of %u nodes\n", best[j],
+              dagSymbolName(n), n->uses, n->size);
+    }
+  }
+  free(best);
+  fclose(fp);
+  printf("Parse DAG written to %s\n", outfile);
+}
+
+void freeParseDag(parseDag *D) {
+  if (!D)
+    return;
+  free(D->nodes);
+  free(D->kids);
+  free(D->lexemes);
+  free(D->slots);
+  free(D);
+}
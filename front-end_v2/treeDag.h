@@ -0,0 +1,19 @@
+#ifndef TREEDAG_H
+#define TREEDAG_H
+#include "treeDagDef.h"
+#include "parser.h"
+
+/* Parses testcaseFile and hash-conses the parse tree as it is built:
+   every completed subtree is looked up by symbol, child ids and lexeme and
+   stored once. Returns NULL if the file cannot be opened. */
+parseDag *buildParseDag(char *testcaseFile, table *T, grammar *G);
+
+dagStats getDagStats(const parseDag *D);
+
+/* Writes each distinct subtree once, children before parents, followed
+   by the `top` repeated subtrees that would save the most nodes. */
+void printParseDag(const parseDag *D, char *outfile, int top);
+
+void freeParseDag(parseDag *D);
+
+#endif
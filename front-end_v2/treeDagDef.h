@@ -0,0 +1,45 @@
+#ifndef TREEDAGDEF_H
+#define TREEDAGDEF_H
+#include "parserDef.h"
+
+#define DAG_NONE UINT32_MAX
+
+/* One distinct subtree. Nodes are interned bottom-up, so every child id is
+   below its parent's; equal ids mean structurally equal subtrees. Line
+   numbers are not part of a node, only token types and lexemes. */
+typedef struct {
+  uint8_t symbolType;
+  uint8_t symbolId;
+  uint16_t childCount;
+  uint32_t kids;   /* offset of the child ids in parseDag.kids */
+  uint32_t lexeme; /* terminals: offset in the lexeme pool, or DAG_NONE */
+  uint32_t uses;   /* occurrences in the parse tree */
+  uint32_t size;   /* nodes in the tree form of this subtree */
+  uint32_t hash;
+} dagNode;
+
+typedef struct {
+  dagNode *nodes;
+  uint32_t nodeCount;
+  uint32_t nodeCapacity;
+  uint32_t *kids;
+  uint32_t kidCount;
+  uint32_t kidCapacity;
+  char *lexemes;
+  uint32_t lexemeSize;
+  uint32_t lexemeCapacity;
+  uint32_t *slots; /* open addressing, node index + 1, 0 = empty */
+  uint32_t slotCount;
+  uint32_t root;
+  uint64_t treeNodes; /* nodes the parse tree would have */
+} parseDag;
+
+typedef struct {
+  uint64_t treeNodes;
+  uint32_t dagNodes;
+  uint32_t sharedNodes; /* distinct subtrees that occur more than once */
+  double ratio;         /* treeNodes / dagNodes */
+  size_t dagBytes;
+} dagStats;
+
+#endif
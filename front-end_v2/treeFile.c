@@ -0,0 +1,156 @@
+#include "treeFile.h"
+#include "mappedFile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TREE_SECTIONS 3
+
+/* The section table, read from H when PT is NULL. */
+static void treeSections(const parseTree *PT, const treeFileHeader *H,
+                         mappedSection *S) {
+  if (PT) {
+    S[0] = (mappedSection){PT->nodes, 0, PT->nodeCount, sizeof(parseTreeNode)};
+    S[1] = (mappedSection){PT->tokens, 0, PT->tokenCount, sizeof(parseToken)};
+    S[2] = (mappedSection){PT->lexemes, 0, PT->lexemeSize, 1};
+    return;
+  }
+  S[0] = (mappedSection){NULL, H->nodeOffset, H->nodeCount,
+                         sizeof(parseTreeNode)};
+  S[1] = (mappedSection){NULL, H->tokenOffset, H->tokenCount,
+                         sizeof(parseToken)};
+  S[2] = (mappedSection){NULL, H->lexemeOffset, H->lexemeSize, 1};
+}
+
+static void layoutTree(const parseTree *PT, treeFileHeader *H,
+                       mappedSection *S) {
+  memset(H, 0, sizeof(*H));
+  initMappedTag(&H->tag, TREE_FILE_MAGIC, TREE_FILE_VERSION);
+  H->nodeSize = sizeof(parseTreeNode);
+  H->tokenSize = sizeof(parseToken);
+  H->nodeCount = PT->nodeCount;
+  H->tokenCount = PT->tokenCount;
+  H->lexemeSize = PT->lexemeSize;
+  treeSections(PT, NULL, S);
+  H->fileSize = layoutSections(sizeof(*H), S, TREE_SECTIONS);
+  H->nodeOffset = S[0].offset;
+  H->tokenOffset = S[1].offset;
+  H->lexemeOffset = S[2].offset;
+}
+
+int writeTreeFile(const parseTree *PT, const char *outfile) {
+  treeFileHeader H;
+  mappedSection S[TREE_SECTIONS];
+  layoutTree(PT, &H, S);
+  return writeMappedFile(outfile, &H, sizeof(H), S, TREE_SECTIONS);
+}
+
+void *serializeTree(const parseTree *PT, size_t *size) {
+  treeFileHeader H;
+  mappedSection S[TREE_SECTIONS];
+  layoutTree(PT, &H, S);
+  *size = (size_t)H.fileSize;
+  return mappedImage(&H, sizeof(H), S, TREE_SECTIONS, H.fileSize);
+}
+
+static const char *checkHeader(const treeFileHeader *H, size_t mapSize) {
+  if (mapSize < sizeof(*H) || memcmp(H->tag.magic, TREE_FILE_MAGIC, 8) != 0)
+    return "not a parse tree file";
+  const char *problem = checkMappedTag(&H->tag, TREE_FILE_VERSION);
+  if (problem)
+    return problem;
+  if (H->nodeSize != sizeof(parseTreeNode) ||
+      H->tokenSize != sizeof(parseToken))
+    return "written on an incompatible platform";
+  mappedSection S[TREE_SECTIONS];
+  treeSections(NULL, H, S);
+  return checkSections(H, mapSize, H->fileSize, S, TREE_SECTIONS);
+}
+
+static treeFile *viewTree(void *map, size_t size, int heap,
+                          const char *name) {
+  const treeFileHeader *H = (const treeFileHeader *)map;
+  const char *problem = checkHeader(H, size);
+  if (problem) {
+    fprintf(stderr, "Error: %s: %s\n", name, problem);
+    return NULL;
+  }
+
+  treeFile *TF = (treeFile *)calloc(1, sizeof(treeFile));
+  if (!TF) {
+    fprintf(stderr, "calloc failed for treeFile\n");
+    exit(1);
+  }
+  char *base = (char *)map;
+  TF->map = map;
+  TF->mapSize = size;
+  TF->heap = heap;
+  TF->header = H;
+  TF->view.nodes = (parseTreeNode *)(base + H->nodeOffset);
+  TF->view.nodeCount = TF->view.nodeCapacity = H->nodeCount;
+  TF->view.tokens = (parseToken *)(base + H->tokenOffset);
+  TF->view.tokenCount = TF->view.tokenCapacity = H->tokenCount;
+  TF->view.lexemes = base + H->lexemeOffset;
+  TF->view.lexemeSize = TF->view.lexemeCapacity = H->lexemeSize;
+  return TF;
+}
+
+treeFile *openTreeImage(void *image, size_t size) {
+  if (size < sizeof(treeFileHeader) || (uintptr_t)image % 8 != 0) {
+    fprintf(stderr, "Error: tree image: not a parse tree file\n");
+    free(image);
+    return NULL;
+  }
+  treeFile *TF = viewTree(image, size, 1, "tree image");
+  if (!TF)
+    free(image);
+  return TF;
+}
+
+treeFile *openTreeFile(const char *infile) {
+  size_t size;
+  void *map = mapFile(infile, &size);
+  if (!map)
+    return NULL;
+  treeFile *TF = viewTree(map, size, 0, infile);
+  if (!TF)
+    unmapFile(map, size);
+  return TF;
+}
+
+const parseTree *treeFileTree(const treeFile *TF) { return &TF->view; }
+
+const char *verifyTreeFile(const treeFile *TF) {
+  const treeFileHeader *H = TF->header;
+  const char *base = (const char *)H;
+  const parseTreeNode *nodes = (const parseTreeNode *)(base + H->nodeOffset);
+  const parseToken *tokens = (const parseToken *)(base + H->tokenOffset);
+  for (uint32_t i = 0; i < H->nodeCount; i++) {
+    const parseTreeNode *n = &nodes[i];
+    int symbolOK = n->symbolType == SYMBOL_TERMINAL
+                       ? n->symbolId <= TK_EPSILON
+                       : n->symbolType == SYMBOL_NON_TERMINAL &&
+                             n->symbolId < NT_COUNT;
+    if (!symbolOK)
+      return "bad node symbol";
+    if ((n->parent != PT_NONE && n->parent >= i) || n->subtreeEnd <= i ||
+        n->subtreeEnd > H->nodeCount ||
+        (n->token != PT_NONE && n->token >= H->tokenCount))
+      return "node index out of range";
+  }
+  for (uint32_t i = 0; i < H->tokenCount; i++)
+    if ((unsigned)tokens[i].tokenType > TK_EPSILON ||
+        tokens[i].lexeme >= H->lexemeSize)
+      return "token index out of range";
+  return NULL;
+}
+
+void closeTreeFile(treeFile *TF) {
+  if (!TF)
+    return;
+  if (TF->heap)
+    free(TF->map);
+  else
+    unmapFile(TF->map, TF->mapSize);
+  free(TF);
+}
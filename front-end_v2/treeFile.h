@@ -0,0 +1,30 @@
+#ifndef TREEFILE_H
+#define TREEFILE_H
+#include "treeFileDef.h"
+
+/* Writes PT in the mmap-able binary format. Returns 0 on success. */
+int writeTreeFile(const parseTree *PT, const char *outfile);
+
+/* The bytes writeTreeFile would write, in one malloc'd block. */
+void *serializeTree(const parseTree *PT, size_t *size);
+
+/* Maps a file written by writeTreeFile. Only the header and section
+   bounds are checked, so the load takes constant time; the node and token
+   indices are trusted until verifyTreeFile has checked them. */
+treeFile *openTreeFile(const char *infile);
+
+/* Same as openTreeFile for an image from serializeTree (or read off a
+   socket) in 8-byte aligned malloc'd memory; takes ownership of it. */
+treeFile *openTreeImage(void *image, size_t size);
+
+/* The mapped tree, usable with parseTreeFirstChild/NextSibling/Lexeme and
+   printParseTree. It must not be modified or freed. */
+const parseTree *treeFileTree(const treeFile *TF);
+
+/* One pass over every node and token: each index a walker follows must
+   land inside the file. Returns NULL if so, else what is wrong. */
+const char *verifyTreeFile(const treeFile *TF);
+
+void closeTreeFile(treeFile *TF);
+
+#endif
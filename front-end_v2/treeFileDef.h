@@ -0,0 +1,35 @@
+#ifndef TREEFILEDEF_H
+#define TREEFILEDEF_H
+#include "mappedFileDef.h"
+#include "parserDef.h"
+
+#define TREE_FILE_MAGIC "PTREE\0\0\1"
+#define TREE_FILE_VERSION 1
+
+/* On-disk layout: header, node array, token array, lexeme pool. Nodes and
+   tokens are stored exactly as parseTreeNode / parseToken, each section is
+   8-byte aligned (mappedFile.h), and offsets are from the start of the
+   file. */
+typedef struct {
+  mappedFileTag tag;
+  uint32_t nodeSize;
+  uint32_t tokenSize;
+  uint32_t nodeCount;
+  uint32_t tokenCount;
+  uint32_t lexemeSize;
+  uint32_t reserved;
+  uint64_t nodeOffset;
+  uint64_t tokenOffset;
+  uint64_t lexemeOffset;
+  uint64_t fileSize;
+} treeFileHeader;
+
+typedef struct {
+  void *map;
+  size_t mapSize;
+  int heap; /* map came from openTreeImage and is freed, not unmapped */
+  const treeFileHeader *header;
+  parseTree view; /* points into map; read-only */
+} treeFile;
+
+#endif
@@ -0,0 +1,120 @@
+#include "treeWalk.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+uint32_t parseTreeEnter(const parseTree *PT, uint32_t node) {
+  (void)PT;
+  return node;
+}
+
+uint32_t parseTreeExit(const parseTree *PT, uint32_t node) {
+  return PT->nodes[node].subtreeEnd - 1;
+}
+
+uint32_t parseTreeSubtreeSize(const parseTree *PT, uint32_t node) {
+  return PT->nodes[node].subtreeEnd - node;
+}
+
+int parseTreeIsAncestor(const parseTree *PT, uint32_t ancestor,
+                        uint32_t node) {
+  return ancestor <= node && node < PT->nodes[ancestor].subtreeEnd;
+}
+
+/* Parents precede children, so one forward pass sees every parent's depth
+   first. A node finishes after the (node - depth) non-ancestors before it
+   and the rest of its own subtree. */
+treeIndex *indexParseTree(const parseTree *PT) {
+  treeIndex *I = (treeIndex *)malloc(sizeof(treeIndex));
+  uint32_t n = PT->nodeCount;
+  if (I) {
+    I->depth = (uint32_t *)malloc((size_t)(n ? n : 1) * sizeof(uint32_t));
+    I->post = (uint32_t *)malloc((size_t)(n ? n : 1) * sizeof(uint32_t));
+  }
+  if (!I || !I->depth || !I->post) {
+    fprintf(stderr, "malloc failed for tree index\n");
+    exit(1);
+  }
+  I->count = n;
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t parent = PT->nodes[i].parent;
+    I->depth[i] = parent == PT_NONE ? 0 : I->depth[parent] + 1;
+    I->post[i] = i - I->depth[i] + parseTreeSubtreeSize(PT, i) - 1;
+  }
+  return I;
+}
+
+void freeTreeIndex(treeIndex *I) {
+  if (!I)
+    return;
+  free(I->depth);
+  free(I->post);
+  free(I);
+}
+
+static int isLeaf(const treeWalker *W, uint32_t n) {
+  const parseTreeNode *node = &W->PT->nodes[n];
+  return node->childCount == 0 || (W->prune && n != W->root && W->prune[n]);
+}
+
+/* First node of n's subtree in postorder/inorder: follow first children. */
+static uint32_t descend(const treeWalker *W, uint32_t n) {
+  while (!isLeaf(W, n))
+    n++;
+  return n;
+}
+
+static uint32_t nextSibling(const parseTree *PT, uint32_t n) {
+  uint32_t parent = PT->nodes[n].parent;
+  uint32_t next = PT->nodes[n].subtreeEnd;
+  return next < PT->nodes[parent].subtreeEnd ? next : PT_NONE;
+}
+
+void treeWalkBegin(treeWalker *W, const parseTree *PT, uint32_t root,
+                   walkOrder order, const uint8_t *prune) {
+  W->PT = PT;
+  W->prune = prune;
+  W->root = root;
+  W->order = order;
+  if (root == PT_NONE || root >= PT->nodeCount)
+    W->next = PT_NONE;
+  else
+    W->next = order == WALK_PREORDER ? root : descend(W, root);
+}
+
+/* After the whole subtree of n has been visited. */
+static uint32_t afterSubtree(const treeWalker *W, uint32_t n) {
+  const parseTree *PT = W->PT;
+  while (n != W->root) {
+    uint32_t parent = PT->nodes[n].parent;
+    if (W->order == WALK_INORDER && n == parent + 1)
+      return parent;
+    uint32_t sib = nextSibling(PT, n);
+    if (sib != PT_NONE)
+      return descend(W, sib);
+    if (W->order == WALK_POSTORDER)
+      return parent;
+    n = parent;
+  }
+  return PT_NONE;
+}
+
+uint32_t treeWalkNext(treeWalker *W) {
+  uint32_t n = W->next;
+  if (n == PT_NONE)
+    return n;
+  const parseTree *PT = W->PT;
+
+  if (W->order == WALK_PREORDER) {
+    uint32_t next = isLeaf(W, n) ? PT->nodes[n].subtreeEnd : n + 1;
+    W->next = next < PT->nodes[W->root].subtreeEnd ? next : PT_NONE;
+  } else if (W->order == WALK_POSTORDER) {
+    W->next = afterSubtree(W, n);
+  } else if (!isLeaf(W, n)) {
+    /* Inorder visits an inner node right after its first child. */
+    uint32_t second = nextSibling(PT, n + 1);
+    W->next = second != PT_NONE ? descend(W, second) : afterSubtree(W, n);
+  } else {
+    W->next = afterSubtree(W, n);
+  }
+  return n;
+}
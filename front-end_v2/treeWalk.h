@@ -0,0 +1,26 @@
+#ifndef TREEWALK_H
+#define TREEWALK_H
+#include "treeWalkDef.h"
+
+/* O(1) structural queries from the preorder layout. */
+uint32_t parseTreeEnter(const parseTree *PT, uint32_t node);
+
+uint32_t parseTreeExit(const parseTree *PT, uint32_t node);
+
+uint32_t parseTreeSubtreeSize(const parseTree *PT, uint32_t node);
+
+/* Nonzero if `ancestor` is `node` or one of its ancestors. */
+int parseTreeIsAncestor(const parseTree *PT, uint32_t ancestor, uint32_t node);
+
+treeIndex *indexParseTree(const parseTree *PT);
+
+void freeTreeIndex(treeIndex *I);
+
+/* prune may be NULL; see treeWalker. */
+void treeWalkBegin(treeWalker *W, const parseTree *PT, uint32_t root,
+                   walkOrder order, const uint8_t *prune);
+
+/* Next node, or PT_NONE when the walk is done. */
+uint32_t treeWalkNext(treeWalker *W);
+
+#endif
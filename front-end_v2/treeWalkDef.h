@@ -0,0 +1,28 @@
+#ifndef TREEWALKDEF_H
+#define TREEWALKDEF_H
+#include "parserDef.h"
+
+typedef enum { WALK_PREORDER, WALK_POSTORDER, WALK_INORDER } walkOrder;
+
+/* Stackless iterator over the subtree at `root`. Inorder is the order of
+   printParseTree: first child's subtree, the node, then the remaining
+   children. Nodes with prune[n] set (other than root) are visited once in
+   place of their subtree. */
+typedef struct {
+  const parseTree *PT;
+  const uint8_t *prune;
+  uint32_t root;
+  uint32_t next;
+  walkOrder order;
+} treeWalker;
+
+/* Euler-tour numbering. The preorder layout already gives enter(n) = n and
+   exit(n) = subtreeEnd - 1; the index adds what needs a pass over the
+   tree: depth and postorder rank. */
+typedef struct {
+  uint32_t *depth;
+  uint32_t *post;
+  uint32_t count;
+} treeIndex;
+
+#endif
@@ -0,0 +1,42 @@
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+void *growArray(void *arr, uint32_t *capacity, uint32_t needed,
+                size_t elemSize, const char *what) {
+  if (needed <= *capacity)
+    return arr;
+  uint32_t cap = *capacity ? *capacity : 256;
+  while (cap < needed)
+    cap *= 2;
+  void *p = realloc(arr, (size_t)cap * elemSize);
+  if (!p) {
+    fprintf(stderr, "realloc failed for %s\n", what);
+    exit(1);
+  }
+  *capacity = cap;
+  return p;
+}
+
+char *readWholeFile(const char *path, size_t *size) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp)
+    return NULL;
+  fseek(fp, 0, SEEK_END);
+  long n = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  if (n < 0) {
+    fclose(fp);
+    return NULL;
+  }
+  char *buf = (char *)malloc((size_t)n + 1);
+  if (!buf) {
+    fprintf(stderr, "malloc failed reading %s\n", path);
+    exit(1);
+  }
+  size_t got = fread(buf, 1, (size_t)n, fp);
+  fclose(fp);
+  buf[got] = '\0';
+  *size = got;
+  return buf;
+}
@@ -0,0 +1,27 @@
+#ifndef UTIL_H
+#define UTIL_H
+#include <stddef.h>
+#include <stdint.h>
+
+/* Returns arr grown (by doubling) to hold at least `needed` elements of
+   elemSize bytes, updating *capacity; exits with a message naming `what`
+   if realloc fails. */
+void *growArray(void *arr, uint32_t *capacity, uint32_t needed,
+                size_t elemSize, const char *what);
+
+/* Reads the whole file into a malloc'd, NUL-terminated buffer and sets
+   *size to its length. Returns NULL if it cannot be opened or sized. */
+char *readWholeFile(const char *path, size_t *size);
+
+#define FNV1A_BASIS 14695981039346656037ULL
+
+/* 64-bit FNV-1a over size bytes, continuing from seed (FNV1A_BASIS for a
+   fresh hash). */
+static inline uint64_t fnv1a(const void *data, size_t size, uint64_t seed) {
+  const unsigned char *p = (const unsigned char *)data;
+  for (size_t i = 0; i < size; i++)
+    seed = (seed ^ p[i]) * 1099511628211ULL;
+  return seed;
+}
+
+#endif
@@ -0,0 +1,314 @@
+#include "xrefIndex.h"
+#include "mappedFile.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define XREF_SECTIONS 4
+
+static uint32_t addString(xrefBuilder *B, const char *s) {
+  uint32_t len = (uint32_t)strlen(s) + 1;
+  B->strings = growArray(B->strings, &B->stringCapacity, B->stringSize + len, 1,
+                         "xref string pool");
+  memcpy(B->strings + B->stringSize, s, len);
+  B->stringSize += len;
+  return B->stringSize - len;
+}
+
+static uint32_t nameHash(const char *s, int type) {
+  uint8_t t = (uint8_t)type;
+  uint64_t h = fnv1a(s, strlen(s), fnv1a(&t, 1, FNV1A_BASIS));
+  return (uint32_t)(h ^ (h >> 32));
+}
+
+static void rehashNames(xrefBuilder *B) {
+  uint32_t cap = 64;
+  while (cap < 2 * B->nameCount + 2)
+    cap *= 2;
+  free(B->slots);
+  B->slots = (uint32_t *)calloc(cap, sizeof(uint32_t));
+  if (!B->slots) {
+    fprintf(stderr, "calloc failed for xref name table\n");
+    exit(1);
+  }
+  B->slotCount = cap;
+  for (uint32_t i = 0; i < B->nameCount; i++) {
+    uint32_t s =
+        nameHash(B->strings + B->names[i].lexeme, B->names[i].tokenType) &
+        (cap - 1);
+    while (B->slots[s])
+      s = (s + 1) & (cap - 1);
+    B->slots[s] = i + 1;
+  }
+}
+
+static uint32_t internName(xrefBuilder *B, const char *s, int type) {
+  if (2 * (B->nameCount + 1) > B->slotCount)
+    rehashNames(B);
+  uint32_t slot = nameHash(s, type) & (B->slotCount - 1);
+  for (; B->slots[slot]; slot = (slot + 1) & (B->slotCount - 1)) {
+    uint32_t id = B->slots[slot] - 1;
+    if (B->names[id].tokenType == (uint32_t)type &&
+        strcmp(B->strings + B->names[id].lexeme, s) == 0)
+      return id;
+  }
+  B->names = growArray(B->names, &B->nameCapacity, B->nameCount + 1,
+                       sizeof(xrefName), "xref names");
+  xrefName *n = &B->names[B->nameCount];
+  memset(n, 0, sizeof(*n));
+  n->lexeme = addString(B, s);
+  n->tokenType = (uint32_t)type;
+  B->slots[slot] = B->nameCount + 1;
+  return B->nameCount++;
+}
+
+xrefBuilder *createXrefBuilder(void) {
+  xrefBuilder *B = (xrefBuilder *)calloc(1, sizeof(xrefBuilder));
+  if (!B) {
+    fprintf(stderr, "calloc failed for xrefBuilder\n");
+    exit(1);
+  }
+  return B;
+}
+
+/* Definitions are the names introduced by a function header, parameter,
+   declaration, record/union or field definition, and the new name of a
+   definetype; everything else is a use. */
+static int isDefinition(const parseTree *PT, uint32_t node) {
+  uint32_t p = PT->nodes[node].parent;
+  if (p == PT_NONE || PT->nodes[p].symbolType != SYMBOL_NON_TERMINAL)
+    return 0;
+  switch (PT->nodes[p].symbolId) {
+  case NT_FUNCTION:
+  case NT_PARAMETER_LIST:
+  case NT_DECLARATION:
+  case NT_TYPEDEFINITION:
+  case NT_FIELDDEFINITION:
+    return 1;
+  case NT_DEFINETYPESTMT:
+    return node + 1 == PT->nodes[p].subtreeEnd;
+  default:
+    return 0;
+  }
+}
+
+void xrefAddTree(xrefBuilder *B, const char *file, const parseTree *PT) {
+  B->files = growArray(B->files, &B->fileCapacity, B->fileCount + 1,
+                       sizeof(uint32_t), "xref files");
+  uint32_t fileId = B->fileCount++;
+  B->files[fileId] = addString(B, file);
+
+  for (uint32_t i = 0; i < PT->nodeCount; i++) {
+    const parseTreeNode *n = &PT->nodes[i];
+    if (n->symbolType != SYMBOL_TERMINAL || n->token == PT_NONE)
+      continue;
+    if (n->symbolId != TK_ID && n->symbolId != TK_FIELDID &&
+        n->symbolId != TK_FUNID && n->symbolId != TK_RUID)
+      continue;
+    const parseToken *tk = &PT->tokens[n->token];
+    B->records = growArray(B->records, &B->recordCapacity, B->recordCount + 1,
+                           sizeof(xrefRecord), "xref records");
+    xrefRecord *r = &B->records[B->recordCount++];
+    memset(r, 0, sizeof(*r));
+    r->name = internName(B, PT->lexemes + tk->lexeme, n->symbolId);
+    r->entry.file = fileId;
+    r->entry.line = (uint32_t)tk->lineNumber;
+    r->entry.node = i;
+    r->entry.kind = isDefinition(PT, i) ? XREF_DEF : XREF_USE;
+    r->entry.tokenType = n->symbolId;
+  }
+}
+
+typedef struct {
+  const char *text;
+  uint32_t type;
+  uint32_t id;
+} xrefSortName;
+
+static int compareNames(const void *a, const void *b) {
+  const xrefSortName *x = (const xrefSortName *)a;
+  const xrefSortName *y = (const xrefSortName *)b;
+  int c = strcmp(x->text, y->text);
+  if (c)
+    return c;
+  return x->type < y->type ? -1 : x->type > y->type;
+}
+
+/* Records are compared after their name id has been replaced by the
+   name's sorted rank. */
+static int compareRecords(const void *a, const void *b) {
+  const xrefRecord *x = (const xrefRecord *)a;
+  const xrefRecord *y = (const xrefRecord *)b;
+  if (x->name != y->name)
+    return x->name < y->name ? -1 : 1;
+  if (x->entry.file != y->entry.file)
+    return x->entry.file < y->entry.file ? -1 : 1;
+  if (x->entry.line != y->entry.line)
+    return x->entry.line < y->entry.line ? -1 : 1;
+  return x->entry.node < y->entry.node ? -1 : x->entry.node > y->entry.node;
+}
+
+int writeXrefIndex(xrefBuilder *B, const char *outfile) {
+  xrefSortName *order =
+      (xrefSortName *)malloc((B->nameCount + 1) * sizeof(xrefSortName));
+  uint32_t *rank = (uint32_t *)malloc((B->nameCount + 1) * sizeof(uint32_t));
+  xrefName *names = (xrefName *)calloc(B->nameCount + 1, sizeof(xrefName));
+  xrefEntry *entries =
+      (xrefEntry *)malloc((B->recordCount + 1) * sizeof(xrefEntry));
+  if (!order || !rank || !names || !entries) {
+    fprintf(stderr, "malloc failed in writeXrefIndex\n");
+    exit(1);
+  }
+
+  for (uint32_t i = 0; i < B->nameCount; i++) {
+    order[i].text = B->strings + B->names[i].lexeme;
+    order[i].type = B->names[i].tokenType;
+    order[i].id = i;
+  }
+  qsort(order, B->nameCount, sizeof(xrefSortName), compareNames);
+  for (uint32_t i = 0; i < B->nameCount; i++) {
+    rank[order[i].id] = i;
+    names[i].lexeme = B->names[order[i].id].lexeme;
+    names[i].tokenType = order[i].type;
+  }
+  for (uint32_t i = 0; i < B->recordCount; i++)
+    B->records[i].name = rank[B->records[i].name];
+  qsort(B->records, B->recordCount, sizeof(xrefRecord), compareRecords);
+  for (uint32_t i = 0; i < B->recordCount; i++) {
+    xrefName *n = &names[B->records[i].name];
+    if (n->count++ == 0)
+      n->first = i;
+    entries[i] = B->records[i].entry;
+  }
+  /* Records now hold ranks; map them back so the builder stays usable. */
+  for (uint32_t i = 0; i < B->recordCount; i++)
+    B->records[i].name = order[B->records[i].name].id;
+
+  xrefFileHeader H;
+  memset(&H, 0, sizeof(H));
+  initMappedTag(&H.tag, XREF_FILE_MAGIC, XREF_FILE_VERSION);
+  H.nameSize = sizeof(xrefName);
+  H.entrySize = sizeof(xrefEntry);
+  H.nameCount = B->nameCount;
+  H.entryCount = B->recordCount;
+  H.fileCount = B->fileCount;
+  H.stringSize = B->stringSize;
+
+  mappedSection S[XREF_SECTIONS] = {
+      {names, 0, B->nameCount, sizeof(xrefName)},
+      {entries, 0, B->recordCount, sizeof(xrefEntry)},
+      {B->files, 0, B->fileCount, sizeof(uint32_t)},
+      {B->strings, 0, B->stringSize, 1}};
+  H.fileSize = layoutSections(sizeof(H), S, XREF_SECTIONS);
+  H.nameOffset = S[0].offset;
+  H.entryOffset = S[1].offset;
+  H.fileOffset = S[2].offset;
+  H.stringOffset = S[3].offset;
+  int rc = writeMappedFile(outfile, &H, sizeof(H), S, XREF_SECTIONS);
+  free(order);
+  free(rank);
+  free(names);
+  free(entries);
+  return rc;
+}
+
+void freeXrefBuilder(xrefBuilder *B) {
+  if (!B)
+    return;
+  free(B->records);
+  free(B->names);
+  free(B->slots);
+  free(B->files);
+  free(B->strings);
+  free(B);
+}
+
+static const char *checkHeader(const xrefFileHeader *H, size_t mapSize) {
+  if (mapSize < sizeof(*H) || memcmp(H->tag.magic, XREF_FILE_MAGIC, 8) != 0)
+    return "not a cross-reference index";
+  const char *problem = checkMappedTag(&H->tag, XREF_FILE_VERSION);
+  if (problem)
+    return problem;
+  if (H->nameSize != sizeof(xrefName) || H->entrySize != sizeof(xrefEntry))
+    return "written on an incompatible platform";
+  mappedSection S[XREF_SECTIONS] = {
+      {NULL, H->nameOffset, H->nameCount, sizeof(xrefName)},
+      {NULL, H->entryOffset, H->entryCount, sizeof(xrefEntry)},
+      {NULL, H->fileOffset, H->fileCount, sizeof(uint32_t)},
+      {NULL, H->stringOffset, H->stringSize, 1}};
+  return checkSections(H, mapSize, H->fileSize, S, XREF_SECTIONS);
+}
+
+xrefIndex *openXrefIndex(const char *infile) {
+  size_t size;
+  void *map = mapFile(infile, &size);
+  if (!map)
+    return NULL;
+
+  const xrefFileHeader *H = (const xrefFileHeader *)map;
+  const char *problem = checkHeader(H, size);
+  if (problem) {
+    fprintf(stderr, "Error: %s: %s\n", infile, problem);
+    unmapFile(map, size);
+    return NULL;
+  }
+
+  xrefIndex *X = (xrefIndex *)calloc(1, sizeof(xrefIndex));
+  if (!X) {
+    fprintf(stderr, "calloc failed for xrefIndex\n");
+    exit(1);
+  }
+  const char *base = (const char *)map;
+  X->map = map;
+  X->mapSize = size;
+  X->header = H;
+  X->names = (const xrefName *)(base + H->nameOffset);
+  X->entries = (const xrefEntry *)(base + H->entryOffset);
+  X->files = (const uint32_t *)(base + H->fileOffset);
+  X->strings = base + H->stringOffset;
+  return X;
+}
+
+static const char *nameText(const xrefIndex *X, const xrefName *n) {
+  return n->lexeme < X->header->stringSize ? X->strings + n->lexeme : "";
+}
+
+uint32_t xrefLookup(const xrefIndex *X, const char *name,
+                    const xrefEntry **entries) {
+  uint32_t lo = 0, hi = X->header->nameCount;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (strcmp(nameText(X, &X->names[mid]), name) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  uint32_t end = lo;
+  while (end < X->header->nameCount &&
+         strcmp(nameText(X, &X->names[end]), name) == 0)
+    end++;
+  *entries = NULL;
+  if (lo == end)
+    return 0;
+  uint64_t first = X->names[lo].first;
+  uint64_t last = (uint64_t)X->names[end - 1].first + X->names[end - 1].count;
+  if (first > last || last > X->header->entryCount)
+    return 0;
+  *entries = X->entries + first;
+  return (uint32_t)(last - first);
+}
+
+const char *xrefFileName(const xrefIndex *X, uint32_t file) {
+  if (file >= X->header->fileCount ||
+      X->files[file] >= X->header->stringSize)
+    return "";
+  return X->strings + X->files[file];
+}
+
+void closeXrefIndex(xrefIndex *X) {
+  if (!X)
+    return;
+  unmapFile(X->map, X->mapSize);
+  free(X);
+}
@@ -0,0 +1,29 @@
+#ifndef XREFINDEX_H
+#define XREFINDEX_H
+#include "xrefIndexDef.h"
+
+xrefBuilder *createXrefBuilder(void);
+
+/* Records every TK_ID, TK_FIELDID, TK_FUNID and TK_RUID of PT (parsed from
+   `file`) as a definition or a use, decided by the enclosing production. */
+void xrefAddTree(xrefBuilder *B, const char *file, const parseTree *PT);
+
+/* Sorts the collected occurrences and writes the mmap-able index.
+   Returns 0 on success. */
+int writeXrefIndex(xrefBuilder *B, const char *outfile);
+
+void freeXrefBuilder(xrefBuilder *B);
+
+/* Maps an index written by writeXrefIndex, checking only the header. */
+xrefIndex *openXrefIndex(const char *infile);
+
+/* Binary search for `name` (any token type). Sets *entries to its first
+   occurrence and returns the number of occurrences, 0 if absent. */
+uint32_t xrefLookup(const xrefIndex *X, const char *name,
+                    const xrefEntry **entries);
+
+const char *xrefFileName(const xrefIndex *X, uint32_t file);
+
+void closeXrefIndex(xrefIndex *X);
+
+#endif
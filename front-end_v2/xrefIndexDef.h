@@ -0,0 +1,83 @@
+#ifndef XREFINDEXDEF_H
+#define XREFINDEXDEF_H
+#include "mappedFileDef.h"
+#include "parserDef.h"
+
+#define XREF_FILE_MAGIC "PXREF\0\0\1"
+#define XREF_FILE_VERSION 1
+
+#define XREF_USE 0
+#define XREF_DEF 1
+
+/* One occurrence of an identifier: file index, line and preorder node
+   index in that file's parse tree. */
+typedef struct {
+  uint32_t file;
+  uint32_t line;
+  uint32_t node;
+  uint8_t kind; /* XREF_DEF or XREF_USE */
+  uint8_t tokenType;
+  uint16_t reserved;
+} xrefEntry;
+
+/* Names are sorted by lexeme (strcmp) and then token type; the entries of
+   a name are [first, first + count), sorted by file, line and node. */
+typedef struct {
+  uint32_t lexeme; /* offset in the string pool */
+  uint32_t tokenType;
+  uint32_t first;
+  uint32_t count;
+} xrefName;
+
+/* On-disk layout, following treeFileDef.h: header, names, entries, file
+   name offsets, string pool, each section 8-byte aligned. */
+typedef struct {
+  mappedFileTag tag;
+  uint32_t nameSize;
+  uint32_t entrySize;
+  uint32_t nameCount;
+  uint32_t entryCount;
+  uint32_t fileCount;
+  uint32_t stringSize;
+  uint64_t nameOffset;
+  uint64_t entryOffset;
+  uint64_t fileOffset;
+  uint64_t stringOffset;
+  uint64_t fileSize;
+} xrefFileHeader;
+
+/* Occurrences collected before the index is sorted and written. `name`
+   is an id into the builder's interned strings. */
+typedef struct {
+  uint32_t name;
+  xrefEntry entry;
+} xrefRecord;
+
+typedef struct {
+  xrefRecord *records;
+  uint32_t recordCount;
+  uint32_t recordCapacity;
+  xrefName *names; /* interned, in first-seen order; first/count unused */
+  uint32_t nameCount;
+  uint32_t nameCapacity;
+  uint32_t *slots; /* open addressing, name id + 1, 0 = empty */
+  uint32_t slotCount;
+  uint32_t *files; /* string pool offset of each file name */
+  uint32_t fileCount;
+  uint32_t fileCapacity;
+  char *strings;
+  uint32_t stringSize;
+  uint32_t stringCapacity;
+} xrefBuilder;
+
+typedef struct {
+  void *map;
+  size_t mapSize;
+  const xrefFileHeader *header;
+  const xrefName *names;
+  const xrefEntry *entries;
+  const uint32_t *files;
+  const char *strings;
+} xrefIndex;
+
+#endif